@@ -81,6 +81,11 @@ const char *ldflags_win_release_subsystem[] = {"-Wl,/subsystem:windows"};
 size_t ldflags_win_release_subsystem_count =
     NOB_ARRAY_LEN(ldflags_win_release_subsystem);
 
+// LDFLAGS for Linux native builds (after objects - libraries). The server runs
+// its worker threads on pthreads and loads compiled native kernels with dlopen.
+const char *ldflags_linux_common[] = {"-lm", "-ldl", "-lpthread"};
+size_t ldflags_linux_common_count = NOB_ARRAY_LEN(ldflags_linux_common);
+
 // --- Build Functions ---
 
 Proc spawn_compile(const char *src_file, const char *obj_file,
@@ -343,6 +348,10 @@ int main(int argc, char **argv) {
     cmd_append(&cmd, "-WL,/subsystem:console");
     #endif // WIN32
 
+    #ifdef __linux__
+    nob_da_append_many(&cmd, ldflags_linux_common, ldflags_linux_common_count);
+    #endif // __linux__
+
   } else {
 
     // TODO: clean
@@ -32,12 +32,14 @@ static const int maxActionsPerTurn = 3;
 
 static Rectangle GetUIButtonBarRect(float screenWidth, float screenHeight);
 static bool DrawUIButton(Rectangle rect, const char *label, Color bg, Color fg);
-static void DrawTouchUIAndHandle(SimulatorState *simulatorState);
+static void DrawTouchUIAndHandle(ServerThread *serverThread,
+                                 const SimulatorState *simulatorState);
 static void DrawGameplayGrid(void);
 static void DrawComponentsOnGrid(const SimulatorState *simulatorState);
 static void DrawConnections(const SimulatorState *simulatorState);
 static void DrawScenarioDetailsScreen(const SimulatorState *simulatorState);
-static void HandleGameplayInput(SimulatorState *simulatorState);
+static void HandleGameplayInput(ServerThread *serverThread,
+                                const SimulatorState *simulatorState);
 
 static Vector2 GetWorldPositionForGrid(Vector2 gridPos) {
   return (Vector2){gridPos.x * GRID_CELL_SIZE + GRID_CELL_SIZE / 2.0f,
@@ -174,8 +176,8 @@ static void DrawComponentsOnGrid(const SimulatorState *simulatorState) {
     return;
 
   for (int i = 0; i < simulatorState->elementCount; ++i) {
-    if (simulatorState->elementsOnCanvas[i].isActive) {
-      CircuitElement element = simulatorState->elementsOnCanvas[i];
+    if (Server_IsElementActive(simulatorState, i)) {
+      CircuitElement element = Server_GetElement(simulatorState, i);
       Vector2 worldPos = GetWorldPositionForGrid(element.canvasPosition);
 
       Rectangle compRec = {worldPos.x - GRID_CELL_SIZE / 3.0f,
@@ -210,6 +212,10 @@ static void DrawComponentsOnGrid(const SimulatorState *simulatorState) {
         compColor = DARKBROWN;
         compText = "SNK";
         break;
+      case ELEMENT_MODULE:
+        compColor = element.outputState ? ORANGE : BROWN;
+        compText = "MOD";
+        break;
       default:
         compText = "???";
         break;
@@ -237,23 +243,14 @@ static void DrawConnections(const SimulatorState *simulatorState) {
   for (int i = 0; i < simulatorState->connectionCount; ++i) {
     if (simulatorState->connections[i].isActive) {
       Connection conn = simulatorState->connections[i];
-      const CircuitElement *fromElement = NULL;
-      const CircuitElement *toElement = NULL;
-
-      for (int j = 0; j < simulatorState->elementCount; ++j) {
-        if (simulatorState->elementsOnCanvas[j].isActive) {
-          if (simulatorState->elementsOnCanvas[j].id == conn.fromElementId) {
-            fromElement = &simulatorState->elementsOnCanvas[j];
-          }
-          if (simulatorState->elementsOnCanvas[j].id == conn.toElementId) {
-            toElement = &simulatorState->elementsOnCanvas[j];
-          }
-        }
-      }
-
-      if (fromElement && toElement) {
-        Vector2 startPos = GetWorldPositionForGrid(fromElement->canvasPosition);
-        Vector2 endPos = GetWorldPositionForGrid(toElement->canvasPosition);
+      int fromSlot = Server_FindElementSlot(simulatorState, conn.fromElementId);
+      int toSlot = Server_FindElementSlot(simulatorState, conn.toElementId);
+
+      if (fromSlot != -1 && toSlot != -1) {
+        Vector2 startPos = GetWorldPositionForGrid(
+            Server_GetElementPosition(simulatorState, fromSlot));
+        Vector2 endPos = GetWorldPositionForGrid(
+            Server_GetElementPosition(simulatorState, toSlot));
         STUB("For elements with multiple inputs/outputs, adjust start/end "
              "points. For now, connect centers.");
         DrawLineEx(startPos, endPos, 2.0f, COLOR_TEXT_PRIMARY);
@@ -334,6 +331,24 @@ static void DrawScenarioDetailsScreen(const SimulatorState *simulatorState) {
              (Vector2){truthTableRect.x + 20, truthTableRect.y + 90}, 16, 1,
              COLOR_TEXT_SECONDARY);
 
+  const StateWitness *witness = &simulatorState->stateWitness;
+  if (witness->isValid && witness->isSatisfiable) {
+    float witnessY = truthTableRect.y + 130;
+    DrawTextEx(clientFont, "Required inputs:",
+               (Vector2){truthTableRect.x + 20, witnessY}, 16, 1,
+               COLOR_TEXT_PRIMARY);
+    for (int o = 0; o < witness->originCount; ++o) {
+      witnessY += 18;
+      if (witnessY + 16 > truthTableRect.y + truthTableRect.height - 10)
+        break;
+      DrawTextEx(clientFont,
+                 TextFormat("ID %d: %s", witness->originIds[o],
+                            witness->originValues[o] ? "ON" : "OFF"),
+                 (Vector2){truthTableRect.x + 20, witnessY}, 16, 1,
+                 witness->originValues[o] ? GREEN : COLOR_TEXT_SECONDARY);
+    }
+  }
+
   Rectangle circuitRect = {sectionPadding * 3 + sectionWidth * 2, sectionY,
                            sectionWidth, sectionHeight};
   DrawRectangleLinesEx(circuitRect, 2, DARKGRAY);
@@ -376,15 +391,10 @@ static void DrawGameplayScreen(const SimulatorState *simulatorState) {
   DrawConnections(simulatorState);
   if (interactionMode == INTERACTION_MODE_WIRING_SELECT_INPUT &&
       wiringFromElementId != -1) {
-    const CircuitElement *fromElement = NULL;
-    for (int i = 0; i < simulatorState->elementCount; ++i) {
-      if (simulatorState->elementsOnCanvas[i].id == wiringFromElementId) {
-        fromElement = &simulatorState->elementsOnCanvas[i];
-        break;
-      }
-    }
-    if (fromElement) {
-      Vector2 startPos = GetWorldPositionForGrid(fromElement->canvasPosition);
+    int fromSlot = Server_FindElementSlot(simulatorState, wiringFromElementId);
+    if (fromSlot != -1) {
+      Vector2 startPos = GetWorldPositionForGrid(
+          Server_GetElementPosition(simulatorState, fromSlot));
       Vector2 mouseWorldPos =
           GetScreenToWorld2D(GetMousePosition(), gameCamera);
       DrawLineEx(startPos, mouseWorldPos, 2.0f,
@@ -618,9 +628,19 @@ static void DrawGameplayScreen(const SimulatorState *simulatorState) {
                  gameCamera.target.y),
       (Vector2){scoreZoomTargetX, UI_HEADER_HEIGHT + UI_PADDING + (20 + 5) * 2},
       20, 1, COLOR_TEXT_SECONDARY);
+  const CapabilityReport *capability = &simulatorState->capability;
+  DrawTextEx(
+      clientFont,
+      capability->isExact
+          ? TextFormat("Capability: %d | Efficiency: %.2f",
+                       capability->uniqueStateCount, capability->efficiency)
+          : "Capability: --",
+      (Vector2){scoreZoomTargetX, UI_HEADER_HEIGHT + UI_PADDING + (20 + 5) * 3},
+      20, 1, COLOR_TEXT_SECONDARY);
 }
 
-static void HandleGameplayInput(SimulatorState *simulatorState) {
+static void HandleGameplayInput(ServerThread *serverThread,
+                                const SimulatorState *simulatorState) {
   if (IsKeyPressed(KEY_ESCAPE)) {
     currentClientScreen = CLIENT_SCREEN_TITLE;
     interactionMode = INTERACTION_MODE_NORMAL;
@@ -643,13 +663,16 @@ static void HandleGameplayInput(SimulatorState *simulatorState) {
   }
 
   if (IsKeyPressed(KEY_D)) {
-    if (Server_UserDrawCard(simulatorState)) {
-      TraceLog(LOG_INFO,
-               "CLIENT: User attempted to draw a card. Hand size now: %d",
-               simulatorState->handCardCount);
-    } else {
+    if (simulatorState->handCardCount >= MAX_CARDS_IN_HAND ||
+        simulatorState->currentDeckIndex >= simulatorState->deckCardCount) {
       TraceLog(LOG_INFO, "CLIENT: User tried to draw, but couldn't (hand full "
                          "or no cards left).");
+    } else if (Server_SubmitCommand(
+                   serverThread,
+                   &(ServerCommand){.type = SERVER_COMMAND_DRAW_CARD})) {
+      TraceLog(LOG_INFO, "CLIENT: User attempted to draw a card. Hand size "
+                         "was: %d",
+               simulatorState->handCardCount);
     }
   }
   if (IsKeyPressed(KEY_W)) {
@@ -779,7 +802,10 @@ static void HandleGameplayInput(SimulatorState *simulatorState) {
                        "CLIENT: Cannot play action cards outside of turn");
             } else if (actionsThisTurn >= maxActionsPerTurn) {
               TraceLog(LOG_INFO, "CLIENT: Maximum actions per turn reached");
-            } else if (Server_UseCardFromHand(simulatorState, i)) {
+            } else if (Server_SubmitCommand(
+                           serverThread,
+                           &(ServerCommand){.type = SERVER_COMMAND_USE_CARD,
+                                            .handIndex = i})) {
               actionsThisTurn++;
               TraceLog(LOG_INFO,
                        "CLIENT: Played action card '%s' (%d/%d actions)",
@@ -805,12 +831,11 @@ static void HandleGameplayInput(SimulatorState *simulatorState) {
                          floorf(worldInputPos.y / GRID_CELL_SIZE)};
       if (interactionMode == INTERACTION_MODE_WIRING_SELECT_OUTPUT) {
         for (int i = 0; i < simulatorState->elementCount; ++i) {
-          if (simulatorState->elementsOnCanvas[i].isActive &&
-              (int)simulatorState->elementsOnCanvas[i].canvasPosition.x ==
-                  (int)gridPos.x &&
-              (int)simulatorState->elementsOnCanvas[i].canvasPosition.y ==
-                  (int)gridPos.y) {
-            wiringFromElementId = simulatorState->elementsOnCanvas[i].id;
+          Vector2 position = Server_GetElementPosition(simulatorState, i);
+          if (Server_IsElementActive(simulatorState, i) &&
+              (int)position.x == (int)gridPos.x &&
+              (int)position.y == (int)gridPos.y) {
+            wiringFromElementId = Server_GetElement(simulatorState, i).id;
             interactionMode = INTERACTION_MODE_WIRING_SELECT_INPUT;
             TraceLog(LOG_INFO,
                      "CLIENT: Wiring - Output selected from element ID %d",
@@ -819,17 +844,16 @@ static void HandleGameplayInput(SimulatorState *simulatorState) {
           }
         }
       } else if (interactionMode == INTERACTION_MODE_WIRING_SELECT_INPUT) {
-        CircuitElement *targetElement = NULL;
+        CircuitElement targetElement;
         int clickedElementId = -1;
 
         for (int i = 0; i < simulatorState->elementCount; ++i) {
-          if (simulatorState->elementsOnCanvas[i].isActive &&
-              (int)simulatorState->elementsOnCanvas[i].canvasPosition.x ==
-                  (int)gridPos.x &&
-              (int)simulatorState->elementsOnCanvas[i].canvasPosition.y ==
-                  (int)gridPos.y) {
-            clickedElementId = simulatorState->elementsOnCanvas[i].id;
-            targetElement = &simulatorState->elementsOnCanvas[i];
+          Vector2 position = Server_GetElementPosition(simulatorState, i);
+          if (Server_IsElementActive(simulatorState, i) &&
+              (int)position.x == (int)gridPos.x &&
+              (int)position.y == (int)gridPos.y) {
+            targetElement = Server_GetElement(simulatorState, i);
+            clickedElementId = targetElement.id;
             break;
           }
         }
@@ -837,10 +861,10 @@ static void HandleGameplayInput(SimulatorState *simulatorState) {
         if (clickedElementId != -1 && clickedElementId != wiringFromElementId) {
           int targetInputSlot = -1;
 
-          if (targetElement->type == ELEMENT_AND ||
-              targetElement->type == ELEMENT_OR) {
+          if (targetElement.type == ELEMENT_AND ||
+              targetElement.type == ELEMENT_OR) {
             for (int s = 0; s < MAX_INPUTS_PER_LOGIC_GATE; ++s) {
-              if (targetElement->inputElementIDs[s] == -1) {
+              if (targetElement.inputElementIDs[s] == -1) {
                 targetInputSlot = s;
                 break;
               }
@@ -848,9 +872,13 @@ static void HandleGameplayInput(SimulatorState *simulatorState) {
           }
 
           if (targetInputSlot != -1) {
-            if (Server_CreateConnection(simulatorState, wiringFromElementId,
-                                        clickedElementId, targetInputSlot)) {
-              TraceLog(LOG_INFO, "CLIENT: Connection created");
+            if (Server_SubmitCommand(
+                    serverThread,
+                    &(ServerCommand){.type = SERVER_COMMAND_CONNECT,
+                                     .elementId = wiringFromElementId,
+                                     .targetElementId = clickedElementId,
+                                     .inputSlot = targetInputSlot})) {
+              TraceLog(LOG_INFO, "CLIENT: Connection requested");
             }
           } else {
             TraceLog(LOG_INFO,
@@ -876,11 +904,10 @@ static void HandleGameplayInput(SimulatorState *simulatorState) {
               // Check if cell is occupied
               bool cellOccupied = false;
               for (int k = 0; k < simulatorState->elementCount; ++k) {
-                if (simulatorState->elementsOnCanvas[k].isActive &&
-                    (int)simulatorState->elementsOnCanvas[k].canvasPosition.x ==
-                        (int)gridPos.x &&
-                    (int)simulatorState->elementsOnCanvas[k].canvasPosition.y ==
-                        (int)gridPos.y) {
+                Vector2 position = Server_GetElementPosition(simulatorState, k);
+                if (Server_IsElementActive(simulatorState, k) &&
+                    (int)position.x == (int)gridPos.x &&
+                    (int)position.y == (int)gridPos.y) {
                   cellOccupied = true;
                   TraceLog(
                       LOG_WARNING,
@@ -890,66 +917,52 @@ static void HandleGameplayInput(SimulatorState *simulatorState) {
                 }
               }
 
-              if (!cellOccupied &&
-                  simulatorState->elementCount < MAX_ELEMENTS_ON_CANVAS) {
-                Card cardToPlace = simulatorState->userHand[selectedCardIndex];
-                CircuitElement *newElement =
-                    &simulatorState
-                         ->elementsOnCanvas[simulatorState->elementCount];
-                newElement->isActive = true;
-                newElement->id = simulatorState->nextElementId++;
-                newElement->type = cardToPlace.elementToPlace;
-                newElement->canvasPosition = gridPos;
-                newElement->outputState = false;
-                newElement->defaultOutputState = false;
-                newElement->connectedInputCount = 0;
-
-                for (int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k) {
-                  newElement->inputElementIDs[k] = -1;
-                  newElement->actualInputStates[k] = false;
+              Card cardToPlace = simulatorState->userHand[selectedCardIndex];
+              bool placeRequested =
+                  !cellOccupied &&
+                  Server_SubmitCommand(
+                      serverThread,
+                      &(ServerCommand){.type = SERVER_COMMAND_PLACE_CARD,
+                                       .handIndex = selectedCardIndex,
+                                       .position = gridPos});
+
+              if (placeRequested) {
+                TraceLog(LOG_INFO, "CLIENT: Placing %s at canvas (%.0f, %.0f)",
+                         cardToPlace.name, gridPos.x, gridPos.y);
+
+                actionsThisTurn++;
+                const char *elementName = "Unknown Element";
+                switch (cardToPlace.elementToPlace) {
+                case ELEMENT_BUTTON:
+                  elementName = "Button";
+                  break;
+                case ELEMENT_SWITCH:
+                  elementName = "Switch";
+                  break;
+                case ELEMENT_AND:
+                  elementName = "AND Gate";
+                  break;
+                case ELEMENT_OR:
+                  elementName = "OR Gate";
+                  break;
+                case ELEMENT_SOURCE:
+                  elementName = "Source";
+                  break;
+                case ELEMENT_SENSOR:
+                  elementName = "Sensor";
+                  break;
+                default:
+                  break;
                 }
-
                 TraceLog(LOG_INFO,
-                         "CLIENT: Placed %s (ID: %d) at canvas (%.0f, %.0f)",
-                         cardToPlace.name, newElement->id, gridPos.x,
-                         gridPos.y);
-                simulatorState->elementCount++;
-
-                if (Server_UseCardFromHand(simulatorState, selectedCardIndex)) {
-                  actionsThisTurn++;
-                  const char *elementName = "Unknown Element";
-                  switch (newElement->type) {
-                  case ELEMENT_BUTTON:
-                    elementName = "Button";
-                    break;
-                  case ELEMENT_SWITCH:
-                    elementName = "Switch";
-                    break;
-                  case ELEMENT_AND:
-                    elementName = "AND Gate";
-                    break;
-                  case ELEMENT_OR:
-                    elementName = "OR Gate";
-                    break;
-                  case ELEMENT_SOURCE:
-                    elementName = "Source";
-                    break;
-                  case ELEMENT_SENSOR:
-                    elementName = "Sensor";
-                    break;
-                  default:
-                    break;
-                  }
-                  TraceLog(LOG_INFO,
-                           "CLIENT: Placed element '%s' (%d/%d actions)",
-                           elementName, actionsThisTurn, maxActionsPerTurn);
-                }
+                         "CLIENT: Placed element '%s' (%d/%d actions)",
+                         elementName, actionsThisTurn, maxActionsPerTurn);
                 selectedCardIndex = -1;
               } else if (cellOccupied) {
                 selectedCardIndex = -1;
               } else {
                 TraceLog(LOG_WARNING,
-                         "CLIENT: Max elements reached on canvas.");
+                         "CLIENT: Could not queue the placement.");
                 selectedCardIndex = -1;
               }
             }
@@ -963,8 +976,8 @@ static void HandleGameplayInput(SimulatorState *simulatorState) {
           int clickedElementId = -1;
           ElementType clickedElementType = ELEMENT_NONE;
           for (int k = 0; k < simulatorState->elementCount; ++k) {
-            if (simulatorState->elementsOnCanvas[k].isActive) {
-              CircuitElement element = simulatorState->elementsOnCanvas[k];
+            if (Server_IsElementActive(simulatorState, k)) {
+              CircuitElement element = Server_GetElement(simulatorState, k);
               if ((int)element.canvasPosition.x == (int)gridPos.x &&
                   (int)element.canvasPosition.y == (int)gridPos.y) {
                 clickedElementId = element.id;
@@ -975,7 +988,10 @@ static void HandleGameplayInput(SimulatorState *simulatorState) {
           }
 
           if (clickedElementId != -1) {
-            Server_InteractWithElement(simulatorState, clickedElementId);
+            Server_SubmitCommand(
+                serverThread,
+                &(ServerCommand){.type = SERVER_COMMAND_INTERACT,
+                                 .elementId = clickedElementId});
             if (clickedElementType == ELEMENT_BUTTON) {
               heldButtonId = clickedElementId;
               TraceLog(LOG_INFO, "CLIENT: Holding button ID %d", heldButtonId);
@@ -987,13 +1003,17 @@ static void HandleGameplayInput(SimulatorState *simulatorState) {
   }
 
   if (leftInputReleased && heldButtonId != -1) {
-    Server_ReleaseElementInteraction(simulatorState, heldButtonId);
+    Server_SubmitCommand(serverThread,
+                         &(ServerCommand){.type = SERVER_COMMAND_RELEASE,
+                                          .elementId = heldButtonId});
     heldButtonId = -1;
   }
 
   if (heldButtonId != -1 &&
       (IsMouseButtonDown(MOUSE_BUTTON_LEFT) || GetTouchPointCount() > 0)) {
-    Server_InteractWithElement(simulatorState, heldButtonId);
+    Server_SubmitCommand(serverThread,
+                         &(ServerCommand){.type = SERVER_COMMAND_INTERACT,
+                                          .elementId = heldButtonId});
   }
 }
 
@@ -1042,7 +1062,8 @@ static bool DrawUIButton(Rectangle rect, const char *label, Color bg,
   return pressed;
 }
 
-static void DrawTouchUIAndHandle(SimulatorState *simulatorState) {
+static void DrawTouchUIAndHandle(ServerThread *serverThread,
+                                 const SimulatorState *simulatorState) {
   float w = (float)GetScreenWidth();
   float h = (float)GetScreenHeight();
   Rectangle bar = GetUIButtonBarRect(w, h);
@@ -1077,7 +1098,8 @@ static void DrawTouchUIAndHandle(SimulatorState *simulatorState) {
   x += btnW + spacing;
   Rectangle drawBtn = {x, y, btnW, btnH};
   if (DrawUIButton(drawBtn, "Draw Card", LIGHTGRAY, COLOR_TEXT_PRIMARY)) {
-    Server_UserDrawCard(simulatorState);
+    Server_SubmitCommand(serverThread,
+                         &(ServerCommand){.type = SERVER_COMMAND_DRAW_CARD});
   }
 
   // Turn control button
@@ -1115,7 +1137,9 @@ static void DrawTouchUIAndHandle(SimulatorState *simulatorState) {
   }
 }
 
-void Client_UpdateAndDraw(SimulatorState *simulatorState) {
+void Client_UpdateAndDraw(ServerThread *serverThread) {
+  const SimulatorState *simulatorState = Server_AcquireSnapshot(serverThread);
+
   if (currentClientScreen == CLIENT_SCREEN_LOADING) {
     framesCounter++;
     if (framesCounter > 120) {
@@ -1132,7 +1156,7 @@ void Client_UpdateAndDraw(SimulatorState *simulatorState) {
                          "Simulation (Q key).");
     }
   } else if (currentClientScreen == CLIENT_SCREEN_SIMULATION) {
-    HandleGameplayInput(simulatorState);
+    HandleGameplayInput(serverThread, simulatorState);
   }
   BeginDrawing();
   ClearBackground(COLOR_BACKGROUND);
@@ -1150,7 +1174,7 @@ void Client_UpdateAndDraw(SimulatorState *simulatorState) {
   } else if (currentClientScreen == CLIENT_SCREEN_SIMULATION) {
     if (simulatorState != NULL) {
       DrawGameplayScreen(simulatorState);
-      DrawTouchUIAndHandle(simulatorState);
+      DrawTouchUIAndHandle(serverThread, simulatorState);
     } else {
       DrawTextEx(clientFont, "Error: SimulatorState is NULL", (Vector2){20, 20},
                  20, 1, RED);
@@ -5,7 +5,8 @@
  * Handles initialization, main update/draw loop, and shutdown for the client (UI) portion.
  * All rendering and user input is managed here. Uses Raylib/Raygui for all graphics and input.
  *
- * The client interacts with the core logic via the SimulatorState structure defined in server.h.
+ * The client reads the core logic through SimulatorState snapshots published by the server
+ * thread and sends it ServerCommand requests, both defined in server.h.
  *
  * @see server.h
  */
@@ -23,9 +24,9 @@ bool Client_Init(void);
 
 /**
  * @brief Update the client state and render the UI.
- * @param simulatorState Pointer to the current SimulatorState structure.
+ * @param serverThread Server thread to draw snapshots from and send commands to.
  */
-void Client_UpdateAndDraw(SimulatorState *simulatorState);
+void Client_UpdateAndDraw(ServerThread *serverThread);
 
 /**
  * @brief Release all client resources and close the UI.
@@ -12,17 +12,23 @@ int main(void) {
     return 1;
   }
 
-  while (!Client_ShouldClose()) {
-    float deltaTime = GetFrameTime();
-
-    if (Client_GetCurrentScreen() == CLIENT_SCREEN_SIMULATION) {
-      Server_Update(&simulatorState, deltaTime);
-    }
+  ServerThread *serverThread =
+      Server_StartThread(&simulatorState, SERVER_DEFAULT_TICK_RATE);
+  if (serverThread == NULL) {
+    Client_Close();
+    Server_Shutdown(&simulatorState);
+    return 1;
+  }
 
-    Client_UpdateAndDraw(&simulatorState);
+  while (!Client_ShouldClose()) {
+    Server_SetThreadRunning(serverThread, Client_GetCurrentScreen() ==
+                                              CLIENT_SCREEN_SIMULATION);
+    Client_UpdateAndDraw(serverThread);
   }
 
+  Server_StopThread(serverThread);
   Client_Close();
+  Server_Shutdown(&simulatorState);
 
   return 0;
 }
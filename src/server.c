@@ -1,7 +1,14 @@
+#if !defined( _WIN32 ) && !defined( _POSIX_C_SOURCE )
+  #define _POSIX_C_SOURCE 200809L    // mkdtemp, fdopen and process control under -std=c11
+#endif
+
 #include "server.h"
+#define ARENA_IMPLEMENTATION
+#include "arena.h"
 #include "config.h"
 #include "raylib.h"
 #include "raymath.h"
+#include <limits.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -24,9 +31,124 @@ static inline bool Vector2Equals( Vector2 v1, Vector2 v2 ) {
   #include "raymath.h"
 #endif
 
+#if defined( __GNUC__ ) || defined( __clang__ )
+  #define LANE_INLINE static inline __attribute__( ( always_inline ) )
+#else
+  #define LANE_INLINE static inline
+#endif
+
+#if ( defined( __x86_64__ ) || defined( __i386__ ) ) && ( defined( __GNUC__ ) || defined( __clang__ ) ) && \
+  !defined( PLATFORM_WEB ) && !defined( TOOL_WASM_BUILD )
+  #define LANE_X86_DISPATCH 1
+#else
+  #define LANE_X86_DISPATCH 0
+#endif
+
+#if defined( __GNUC__ ) || defined( __clang__ )
+  #define SIGNAL_VM_THREADED 1    // Computed-goto dispatch (labels as values)
+#else
+  #define SIGNAL_VM_THREADED 0
+#endif
+
+#if !defined( PLATFORM_WEB ) && !defined( TOOL_WASM_BUILD ) && ( !defined( _WIN32 ) || defined( __MINGW32__ ) )
+  #define CAPABILITY_THREADED 1
+  #include <pthread.h>
+  #include <stdatomic.h>
+#else
+  #define CAPABILITY_THREADED 0
+#endif
+
+#if CAPABILITY_THREADED && !defined( _WIN32 )
+  #define NATIVE_ENGINE_AVAILABLE 1    // Needs a C compiler at run time, dlopen and threads
+  #include <dirent.h>
+  #include <dlfcn.h>
+  #include <errno.h>
+  #include <fcntl.h>
+  #include <signal.h>
+  #include <sys/wait.h>
+  #include <unistd.h>
+#else
+  #define NATIVE_ENGINE_AVAILABLE 0
+#endif
+
+#if NATIVE_ENGINE_AVAILABLE && ( defined( __GNUC__ ) || defined( __clang__ ) )
+  #define PARALLEL_PROPAGATION_AVAILABLE 1    // Needs sysconf and __atomic builtins on plain words
+#else
+  #define PARALLEL_PROPAGATION_AVAILABLE 0
+#endif
+
 static unsigned int serverUpdateFrameCounter = 0;
 
 static void         PropagateSignals( SimulatorState *simulatorState );
+static void         ScheduleFanout( SimulatorState *simulatorState, int slot, int currentComponent );
+#if NATIVE_ENGINE_AVAILABLE
+static void AbandonNativeKernel( struct NativeKernel *kernel );
+#endif
+#if PARALLEL_PROPAGATION_AVAILABLE
+static void DestroyPropagationPool( struct PropagationPool *pool );
+#endif
+
+/** Kinds of entry in SimulatorState.stateHash other than outputs, which use SignalSlotKey. */
+typedef enum StateHashKind {
+    STATE_HASH_ELEMENT = 1,
+    STATE_HASH_CONNECTION,
+    STATE_HASH_HAND,
+    STATE_HASH_DECK,
+    STATE_HASH_DISCARD,
+} StateHashKind;
+
+static inline uint64_t MixHash64( uint64_t key ) {
+    key = ( key ^ ( key >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+    key = ( key ^ ( key >> 27 ) ) * 0x94D049BB133111EBull;
+    return key ^ ( key >> 31 );
+}
+
+/** Zobrist-style key of a slot's output; a state hash is the XOR of the keys of its high outputs. */
+static inline uint64_t SignalSlotKey( int slot ) {
+    return MixHash64( ( (uint64_t) slot + 1 ) * 0x9E3779B97F4A7C15ull );
+}
+
+static inline uint64_t StateHashKey( StateHashKind kind, uint64_t a, uint64_t b ) {
+    return MixHash64( MixHash64( MixHash64( (uint64_t) kind * 0x9E3779B97F4A7C15ull ) ^ a ) ^ b );
+}
+
+static uint64_t ElementHashKey( const ElementStore *store, int slot ) {
+    uint32_t x, y;
+    memcpy( &x, &store->positions[slot].x, sizeof( x ) );
+    memcpy( &y, &store->positions[slot].y, sizeof( y ) );
+    uint64_t identity = (uint64_t) (uint32_t) store->ids[slot] << 32 | (uint32_t) slot;
+    uint64_t kind     = (uint64_t) store->types[slot] | (uint64_t) store->modules[slot] << 8;
+    uint64_t shape    = ( (uint64_t) x << 32 | y ) ^ ( kind * 0x9E3779B97F4A7C15ull );
+    return StateHashKey( STATE_HASH_ELEMENT, identity, shape );
+}
+
+static uint64_t ConnectionHashKey( const Connection *connection ) {
+    uint64_t ends = (uint64_t) (uint32_t) connection->fromElementId << 32 | (uint32_t) connection->toElementId;
+    return StateHashKey( STATE_HASH_CONNECTION, ends, (uint64_t) connection->toInputSlot );
+}
+
+/** Toggles the keys of cards[first, last) of a pile; cards are keyed by pile position and card id. */
+static void HashCardRange( uint64_t *hash, StateHashKind pile, const Card *cards, int first, int last ) {
+    for ( int i = first; i < last; ++i ) { *hash ^= StateHashKey( pile, (uint64_t) i, (uint64_t) cards[i].id ); }
+}
+
+/** Moves a hand card to the discard pile, closing the gap in the hand. */
+static void DiscardHandCard( SimulatorState *simulatorState, int handIndex ) {
+    uint64_t *hash = &simulatorState->stateHash;
+
+    simulatorState->userDiscard[simulatorState->discardCardCount] = simulatorState->userHand[handIndex];
+    HashCardRange( hash, STATE_HASH_DISCARD, simulatorState->userDiscard, simulatorState->discardCardCount,
+                   simulatorState->discardCardCount + 1 );
+    simulatorState->discardCardCount++;
+
+    HashCardRange( hash, STATE_HASH_HAND, simulatorState->userHand, handIndex, simulatorState->handCardCount );
+    for ( int i = handIndex; i < simulatorState->handCardCount - 1; ++i ) {
+        simulatorState->userHand[i] = simulatorState->userHand[i + 1];
+    }
+    simulatorState->handCardCount--;
+    HashCardRange( hash, STATE_HASH_HAND, simulatorState->userHand, handIndex, simulatorState->handCardCount );
+    simulatorState->changeGeneration++;
+}
 
 static Card         CreateElementCard( int id, const char *name, ElementType elemType ) {
     Card card;
@@ -47,6 +169,10 @@ static bool Server_AttemptDrawAndReshuffle( SimulatorState *simulatorState ) {
               LOG_INFO, "SERVER: Deck empty. Moving discard pile (%d cards) to deck.",
               simulatorState->discardCardCount
             );
+            HashCardRange(
+              &simulatorState->stateHash, STATE_HASH_DISCARD, simulatorState->userDiscard, 0,
+              simulatorState->discardCardCount
+            );
             for ( int i = 0; i < simulatorState->discardCardCount; ++i ) {
                 simulatorState->userDeck[i] = simulatorState->userDiscard[i];
             }            simulatorState->deckCardCount    = simulatorState->discardCardCount;
@@ -61,6 +187,9 @@ static bool Server_AttemptDrawAndReshuffle( SimulatorState *simulatorState ) {
                 }
                 TraceLog( LOG_INFO, "SERVER: Deck reshuffled." );
             }
+            HashCardRange(
+              &simulatorState->stateHash, STATE_HASH_DECK, simulatorState->userDeck, 0, simulatorState->deckCardCount
+            );
         } else {
             TraceLog( LOG_INFO, "SERVER: Deck and discard pile are empty. Cannot draw." );
             return false;
@@ -89,12 +218,21 @@ bool Server_UserDrawCard( SimulatorState *simulatorState ) {
     if ( !Server_AttemptDrawAndReshuffle( simulatorState ) ) { return false; }
     simulatorState->userHand[simulatorState->handCardCount] =
       simulatorState->userDeck[simulatorState->currentDeckIndex];
+    HashCardRange(
+      &simulatorState->stateHash, STATE_HASH_DECK, simulatorState->userDeck, simulatorState->currentDeckIndex,
+      simulatorState->currentDeckIndex + 1
+    );
+    HashCardRange(
+      &simulatorState->stateHash, STATE_HASH_HAND, simulatorState->userHand, simulatorState->handCardCount,
+      simulatorState->handCardCount + 1
+    );
     TraceLog(
       LOG_INFO, "SERVER: User drew card '%s'. Hand size: %d",
       simulatorState->userHand[simulatorState->handCardCount].name, simulatorState->handCardCount + 1
     );
     simulatorState->handCardCount++;
     simulatorState->currentDeckIndex++;
+    simulatorState->changeGeneration++;
     return true;
 }
 
@@ -115,56 +253,301 @@ bool Server_UseCardFromHand( SimulatorState *simulatorState, int handIndex ) {
 
     if ( usedCard.type == CARD_TYPE_ACTION ) {
         if ( Server_ExecuteActionCard( simulatorState, usedCard.actionType ) ) {
-            simulatorState->userDiscard[simulatorState->discardCardCount] = usedCard;
-            simulatorState->discardCardCount++;
-            for ( int i = handIndex; i < simulatorState->handCardCount - 1; ++i ) {
-                simulatorState->userHand[i] = simulatorState->userHand[i + 1];
-            }
-            simulatorState->handCardCount--;
+            DiscardHandCard( simulatorState, handIndex );
             return true;
         }
         return false;
     }
 
-    simulatorState->userDiscard[simulatorState->discardCardCount] = usedCard;
-    simulatorState->discardCardCount++;
-    for ( int i = handIndex; i < simulatorState->handCardCount - 1; ++i ) {
-        simulatorState->userHand[i] = simulatorState->userHand[i + 1];
+    DiscardHandCard( simulatorState, handIndex );
+    return true;
+}
+
+static inline bool TestElementBit( const uint64_t *bits, int slot ) {
+    return ( bits[slot >> 6] >> ( slot & 63 ) ) & 1;
+}
+
+static inline void AssignElementBit( uint64_t *bits, int slot, bool value ) {
+    uint64_t mask    = (uint64_t) 1 << ( slot & 63 );
+    bits[slot >> 6] = value ? ( bits[slot >> 6] | mask ) : ( bits[slot >> 6] & ~mask );
+}
+
+static inline bool IsActiveElementOfType( const ElementStore *store, int slot, ElementType type ) {
+    return store->types[slot] == type && TestElementBit( store->activeBits, slot );
+}
+
+/**
+ * Copies an array into a larger zero-filled block from the arena. The old block is not reclaimed
+ * until the arena is freed; with doubling capacities the waste stays below the live size.
+ */
+static void *GrowStorage( Arena *arena, void *items, size_t usedBytes, size_t newBytes ) {
+    char *grown = arena_alloc( arena, newBytes );
+    if ( usedBytes > 0 ) memcpy( grown, items, usedBytes );
+    memset( grown + usedBytes, 0, newBytes - usedBytes );
+    return grown;
+}
+
+static bool ReserveElementSlots( SimulatorState *simulatorState, int needed ) {
+    ElementStore *store = &simulatorState->elements;
+    if ( needed <= store->capacity ) return true;
+
+    int capacity = store->capacity > 0 ? store->capacity : ELEMENT_STORE_MIN_CAPACITY;
+    while ( capacity < needed ) {
+        if ( capacity > INT_MAX / 2 ) return false;
+        capacity *= 2;
     }
-    simulatorState->handCardCount--;
+
+    Arena *arena    = &simulatorState->storageArena;
+    size_t oldSlots = (size_t) store->capacity;
+    size_t newSlots = (size_t) capacity;
+    size_t oldWords = (size_t) ELEMENT_BIT_WORDS( store->capacity ) * sizeof( uint64_t );
+    size_t newWords = (size_t) ELEMENT_BIT_WORDS( capacity ) * sizeof( uint64_t );
+
+    store->types                = GrowStorage( arena, store->types, oldSlots, newSlots );
+    store->outputBits           = GrowStorage( arena, store->outputBits, oldWords, newWords );
+    store->inputStateBits       = GrowStorage( arena, store->inputStateBits, oldSlots, newSlots );
+    store->connectedInputCounts = GrowStorage( arena, store->connectedInputCounts, oldSlots, newSlots );
+    store->inputIds             = GrowStorage(
+      arena, store->inputIds, oldSlots * sizeof( *store->inputIds ), newSlots * sizeof( *store->inputIds )
+    );
+    store->activeBits         = GrowStorage( arena, store->activeBits, oldWords, newWords );
+    store->oscillationPeriods = GrowStorage( arena, store->oscillationPeriods, oldSlots, newSlots );
+    store->ids                = GrowStorage( arena, store->ids, oldSlots * sizeof( int ), newSlots * sizeof( int ) );
+    store->positions          = GrowStorage(
+      arena, store->positions, oldSlots * sizeof( Vector2 ), newSlots * sizeof( Vector2 )
+    );
+    store->defaultOutputBits  = GrowStorage( arena, store->defaultOutputBits, oldWords, newWords );
+    store->modules            = GrowStorage( arena, store->modules, oldSlots, newSlots );
+    store->firstOutgoing      = GrowStorage(
+      arena, store->firstOutgoing, oldSlots * sizeof( int ), newSlots * sizeof( int )
+    );
+    store->firstIncoming      = GrowStorage(
+      arena, store->firstIncoming, oldSlots * sizeof( int ), newSlots * sizeof( int )
+    );
+    store->freeSlots          = GrowStorage( arena, store->freeSlots, oldSlots * sizeof( int ), newSlots * sizeof( int ) );
+    store->capacity           = capacity;
     return true;
 }
 
+static unsigned int ElementIdBucket( int elementId, int capacity ) {
+    return ( (unsigned int) elementId * 2654435769u ) & (unsigned int) ( capacity - 1 );
+}
+
+static void ElementIdMapClear( ElementIdMap *map ) {
+    if ( map->capacity > 0 ) memset( map->keys, 0, (size_t) map->capacity * sizeof( int ) );
+    map->count = 0;
+}
+
+static void ElementIdMapPut( ElementIdMap *map, int elementId, int slot ) {
+    unsigned int bucket = ElementIdBucket( elementId, map->capacity );
+    while ( map->keys[bucket] != 0 && map->keys[bucket] != elementId ) {
+        bucket = ( bucket + 1 ) & (unsigned int) ( map->capacity - 1 );
+    }
+    if ( map->keys[bucket] == 0 ) map->count++;
+    map->keys[bucket]  = elementId;
+    map->slots[bucket] = slot;
+}
+
+static void ElementIdMapInsert( Arena *arena, ElementIdMap *map, int elementId, int slot ) {
+    if ( ( map->count + 1 ) * 2 > map->capacity ) {
+        ElementIdMap grown = { 0 };
+        grown.capacity     = map->capacity > 0 ? map->capacity * 2 : ELEMENT_ID_MAP_MIN_CAPACITY;
+        grown.keys         = GrowStorage( arena, NULL, 0, (size_t) grown.capacity * sizeof( int ) );
+        grown.slots        = GrowStorage( arena, NULL, 0, (size_t) grown.capacity * sizeof( int ) );
+        for ( int i = 0; i < map->capacity; ++i ) {
+            if ( map->keys[i] != 0 ) ElementIdMapPut( &grown, map->keys[i], map->slots[i] );
+        }
+        *map = grown;
+    }
+    ElementIdMapPut( map, elementId, slot );
+}
+
+/** Deletes a key by shifting later entries of its probe run back, so lookups need no tombstones. */
+static void ElementIdMapRemove( ElementIdMap *map, int elementId ) {
+    if ( map->capacity == 0 ) return;
+
+    unsigned int mask   = (unsigned int) ( map->capacity - 1 );
+    unsigned int bucket = ElementIdBucket( elementId, map->capacity );
+    while ( map->keys[bucket] != elementId ) {
+        if ( map->keys[bucket] == 0 ) return;
+        bucket = ( bucket + 1 ) & mask;
+    }
+    for ( unsigned int next = ( bucket + 1 ) & mask; map->keys[next] != 0; next = ( next + 1 ) & mask ) {
+        unsigned int home = ElementIdBucket( map->keys[next], map->capacity );
+        if ( ( ( next - home ) & mask ) >= ( ( next - bucket ) & mask ) ) {
+            map->keys[bucket]  = map->keys[next];
+            map->slots[bucket] = map->slots[next];
+            bucket             = next;
+        }
+    }
+    map->keys[bucket] = 0;
+    map->count--;
+}
+
+int Server_FindElementSlot( const SimulatorState *simulatorState, int elementId ) {
+    if ( simulatorState == NULL || elementId <= 0 || simulatorState->elementIdMap.capacity == 0 ) return -1;
+
+    const ElementIdMap *map    = &simulatorState->elementIdMap;
+    unsigned int        bucket = ElementIdBucket( elementId, map->capacity );
+    while ( map->keys[bucket] != 0 ) {
+        if ( map->keys[bucket] == elementId ) {
+            int slot = map->slots[bucket];
+            return TestElementBit( simulatorState->elements.activeBits, slot ) ? slot : -1;
+        }
+        bucket = ( bucket + 1 ) & (unsigned int) ( map->capacity - 1 );
+    }
+    return -1;
+}
+
+/** Marks the scenario conditions that depend on the wiring, rather than on element counts, for re-evaluation. */
+static void MarkTopologyConditionsDirty( Scenario *scenario ) {
+    for ( int i = 0; i < scenario->conditionCount; ++i ) {
+        ScenarioConditionType type = scenario->conditions[i].type;
+        if ( type != CONDITION_MIN_ELEMENTS && type != CONDITION_MAX_ELEMENTS ) scenario->dirtyConditions |= 1u << i;
+    }
+}
+
+/** Adjusts the active count of an element type and marks the conditions counting that type. */
+static void CountElementType( SimulatorState *simulatorState, ElementType type, int delta ) {
+    Scenario *scenario = &simulatorState->currentScenario;
+
+    if ( type < 0 || type >= ELEMENT_TYPE_COUNT ) return;
+    simulatorState->elementTypeCounts[type] += delta;
+    for ( int i = 0; i < scenario->conditionCount; ++i ) {
+        const ScenarioCondition *condition = &scenario->conditions[i];
+        if ( ( condition->type == CONDITION_MIN_ELEMENTS || condition->type == CONDITION_MAX_ELEMENTS ) &&
+             condition->elementType == type ) {
+            scenario->dirtyConditions |= 1u << i;
+        }
+    }
+}
+
+static int PlaceElement( SimulatorState *simulatorState, ElementType type, int module, Vector2 canvasPosition ) {
+    if ( simulatorState == NULL ||
+         ( simulatorState->elements.freeSlotCount == 0 &&
+           !ReserveElementSlots( simulatorState, simulatorState->elementCount + 1 ) ) ) {
+        TraceLog( LOG_WARNING, "SERVER: Cannot place element, out of slots or null simulatorState." );
+        return -1;
+    }
+
+    ElementStore *store = &simulatorState->elements;
+    int           slot  = store->freeSlotCount > 0 ? store->freeSlots[--store->freeSlotCount]
+                                                   : simulatorState->elementCount++;
+    int           id    = simulatorState->nextElementId++;
+    store->types[slot]                = (uint8_t) type;
+    store->modules[slot]              = (uint8_t) module;
+    store->inputStateBits[slot]       = 0;
+    store->connectedInputCounts[slot] = 0;
+    store->ids[slot]                  = id;
+    store->positions[slot]            = canvasPosition;
+    store->firstOutgoing[slot]        = -1;
+    store->firstIncoming[slot]        = -1;
+    store->oscillationPeriods[slot]   = 0;
+    AssignElementBit( store->outputBits, slot, false );
+    AssignElementBit( store->defaultOutputBits, slot, false );
+    AssignElementBit( store->activeBits, slot, true );
+    for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) { store->inputIds[slot][k] = -1; }
+    simulatorState->stateHash ^= ElementHashKey( store, slot );
+    CountElementType( simulatorState, type, 1 );
+    simulatorState->changeGeneration++;
+
+    ElementIdMapInsert( &simulatorState->storageArena, &simulatorState->elementIdMap, id, slot );
+    simulatorState->evaluationPlan.isValid = false;
+
+    TraceLog(
+      LOG_INFO, "SERVER: Placed element ID %d (type %d) at (%.0f, %.0f)", id, type, canvasPosition.x,
+      canvasPosition.y
+    );
+    return id;
+}
+
+int Server_PlaceElement( SimulatorState *simulatorState, ElementType type, Vector2 canvasPosition ) {
+    if ( type == ELEMENT_MODULE ) {
+        TraceLog( LOG_WARNING, "SERVER: Modules are placed with Server_PlaceModule." );
+        return -1;
+    }
+    return PlaceElement( simulatorState, type, 0, canvasPosition );
+}
+
+int Server_PlaceModule( SimulatorState *simulatorState, int moduleIndex, Vector2 canvasPosition ) {
+    if ( simulatorState == NULL || moduleIndex < 0 || moduleIndex >= simulatorState->moduleCount ) {
+        TraceLog( LOG_WARNING, "SERVER: Cannot place module %d, no such definition.", moduleIndex );
+        return -1;
+    }
+    return PlaceElement( simulatorState, ELEMENT_MODULE, moduleIndex, canvasPosition );
+}
+
+CircuitElement Server_GetElement( const SimulatorState *simulatorState, int slot ) {
+    const ElementStore *store = &simulatorState->elements;
+    CircuitElement      elem;
+    elem.type                = (ElementType) store->types[slot];
+    elem.canvasPosition      = store->positions[slot];
+    elem.outputState         = TestElementBit( store->outputBits, slot );
+    elem.defaultOutputState  = TestElementBit( store->defaultOutputBits, slot );
+    elem.isActive            = TestElementBit( store->activeBits, slot );
+    elem.id                  = store->ids[slot];
+    elem.connectedInputCount = store->connectedInputCounts[slot];
+    elem.moduleIndex         = elem.type == ELEMENT_MODULE ? store->modules[slot] : -1;
+    for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) {
+        elem.inputElementIDs[k]   = store->inputIds[slot][k];
+        elem.actualInputStates[k] = ( store->inputStateBits[slot] >> k ) & 1;
+    }
+    return elem;
+}
+
+bool Server_IsElementActive( const SimulatorState *simulatorState, int slot ) {
+    return TestElementBit( simulatorState->elements.activeBits, slot );
+}
+
+bool Server_GetElementOutput( const SimulatorState *simulatorState, int slot ) {
+    return TestElementBit( simulatorState->elements.outputBits, slot );
+}
+
+int Server_GetOscillationPeriod( const SimulatorState *simulatorState, int slot ) {
+    if ( simulatorState == NULL || slot < 0 || slot >= simulatorState->elementCount ) return 0;
+    return simulatorState->elements.oscillationPeriods[slot];
+}
+
+Vector2 Server_GetElementPosition( const SimulatorState *simulatorState, int slot ) {
+    return simulatorState->elements.positions[slot];
+}
+
 void Server_InteractWithElement( SimulatorState *simulatorState, int elementId ) {
     if ( simulatorState == NULL ) return;
 
-    for ( int i = 0; i < simulatorState->elementCount; ++i ) {
-        if ( simulatorState->elementsOnCanvas[i].isActive &&
-             simulatorState->elementsOnCanvas[i].id == elementId ) {
-            CircuitElement *elem = &simulatorState->elementsOnCanvas[i];
+    int i = Server_FindElementSlot( simulatorState, elementId );
+    if ( i != -1 ) {
+        ElementStore *store  = &simulatorState->elements;
+        bool          output = TestElementBit( store->outputBits, i );
 
-            switch ( elem->type ) {
-                case ELEMENT_BUTTON:
-                    elem->outputState = true;
-                    break;
+        switch ( store->types[i] ) {
+            case ELEMENT_BUTTON:
+                if ( !output ) {
+                    AssignElementBit( store->outputBits, i, true );
+                    simulatorState->stateHash ^= SignalSlotKey( i );
+                    simulatorState->changeGeneration++;
+                    ScheduleFanout( simulatorState, i, -1 );
+                }
+                break;
 
-                case ELEMENT_SWITCH:
-                    elem->outputState = !elem->outputState;
-                    TraceLog(
-                      LOG_INFO, "SERVER: Switch ID %d toggled to %s", elem->id,
-                      elem->outputState ? "ON" : "OFF"
-                    );
-                    break;
+            case ELEMENT_SWITCH:
+                AssignElementBit( store->outputBits, i, !output );
+                simulatorState->stateHash ^= SignalSlotKey( i );
+                simulatorState->changeGeneration++;
+                ScheduleFanout( simulatorState, i, -1 );
+                TraceLog(
+                  LOG_INFO, "SERVER: Switch ID %d toggled to %s", store->ids[i], !output ? "ON" : "OFF"
+                );
+                break;
 
-                default:
-                    TraceLog(
-                      LOG_INFO, "SERVER: Element ID %d (type %d) has no interaction", elem->id,
-                      elem->type
-                    );
-                    break;
-            }
-            return;
+            default:
+                TraceLog(
+                  LOG_INFO, "SERVER: Element ID %d (type %d) has no interaction", store->ids[i],
+                  store->types[i]
+                );
+                break;
         }
+        return;
     }
     TraceLog( LOG_WARNING, "SERVER: Element ID %d not found for interaction", elementId );
 }
@@ -172,27 +555,46 @@ void Server_InteractWithElement( SimulatorState *simulatorState, int elementId )
 void Server_ReleaseElementInteraction( SimulatorState *simulatorState, int elementId ) {
     if ( simulatorState == NULL ) return;
 
-    for ( int i = 0; i < simulatorState->elementCount; ++i ) {
-        if ( simulatorState->elementsOnCanvas[i].isActive &&
-             simulatorState->elementsOnCanvas[i].id == elementId ) {
-            CircuitElement *elem = &simulatorState->elementsOnCanvas[i];
+    int i = Server_FindElementSlot( simulatorState, elementId );
+    if ( i != -1 ) {
+        ElementStore *store = &simulatorState->elements;
 
-            if ( elem->type == ELEMENT_BUTTON ) {
-                elem->outputState = false;
-                TraceLog( LOG_INFO, "SERVER: Button ID %d released OFF", elem->id );
+        if ( store->types[i] == ELEMENT_BUTTON ) {
+            if ( TestElementBit( store->outputBits, i ) ) {
+                simulatorState->stateHash ^= SignalSlotKey( i );
+                simulatorState->changeGeneration++;
+                ScheduleFanout( simulatorState, i, -1 );
             }
-            return;
+            AssignElementBit( store->outputBits, i, false );
+            TraceLog( LOG_INFO, "SERVER: Button ID %d released OFF", store->ids[i] );
         }
+        return;
     }
     TraceLog(
       LOG_WARNING, "SERVER: Element ID %d not found for release interaction", elementId
     );
 }
 
+/** Pushes a connection onto the outgoing list of its source and the incoming list of its target. */
+static void LinkConnection( SimulatorState *simulatorState, int index, int fromSlot, int toSlot ) {
+    ElementStore *store      = &simulatorState->elements;
+    Connection   *connection = &simulatorState->connections[index];
+
+    connection->previousOutgoing = -1;
+    connection->nextOutgoing     = store->firstOutgoing[fromSlot];
+    if ( connection->nextOutgoing != -1 ) simulatorState->connections[connection->nextOutgoing].previousOutgoing = index;
+    store->firstOutgoing[fromSlot] = index;
+
+    connection->previousIncoming = -1;
+    connection->nextIncoming     = store->firstIncoming[toSlot];
+    if ( connection->nextIncoming != -1 ) simulatorState->connections[connection->nextIncoming].previousIncoming = index;
+    store->firstIncoming[toSlot] = index;
+}
+
 bool Server_CreateConnection(
   SimulatorState *simulatorState, int fromElementId, int toElementId, int toInputSlot
 ) {
-    if ( simulatorState == NULL || simulatorState->connectionCount >= MAX_CONNECTIONS ) {
+    if ( simulatorState == NULL || simulatorState->connectionCount == INT_MAX ) {
         TraceLog(
           LOG_WARNING, "SERVER: Cannot create connection, max connections "
                        "reached or null simulatorState."
@@ -204,15 +606,16 @@ bool Server_CreateConnection(
         return false;
     }
 
-    CircuitElement *toElem = NULL;
-    for ( int i = 0; i < simulatorState->elementCount; ++i ) {
-        if ( simulatorState->elementsOnCanvas[i].id == toElementId &&
-             simulatorState->elementsOnCanvas[i].isActive ) {
-            toElem = &simulatorState->elementsOnCanvas[i];
-            break;
-        }
+    ElementStore *store    = &simulatorState->elements;
+    int           fromSlot = Server_FindElementSlot( simulatorState, fromElementId );
+    int           toSlot   = Server_FindElementSlot( simulatorState, toElementId );
+    if ( fromSlot == -1 ) {
+        TraceLog(
+          LOG_WARNING, "SERVER: Source element for connection not found (ID: %d).", fromElementId
+        );
+        return false;
     }
-    if ( toElem == NULL ) {
+    if ( toSlot == -1 ) {
         TraceLog(
           LOG_WARNING, "SERVER: Target element for connection not found (ID: %d).", toElementId
         );
@@ -225,7 +628,7 @@ bool Server_CreateConnection(
         );
         return false;
     }
-    if ( toElem->inputElementIDs[toInputSlot] != -1 ) {
+    if ( store->inputIds[toSlot][toInputSlot] != -1 ) {
         TraceLog(
           LOG_WARNING, "SERVER: Input slot %d for element ID %d is already connected.",
           toInputSlot, toElementId
@@ -233,207 +636,4677 @@ bool Server_CreateConnection(
         return false;
     }
 
-    Connection *newConnection      = &simulatorState->connections[simulatorState->connectionCount];
+    if ( simulatorState->freeConnection == -1 && simulatorState->connectionCount == simulatorState->connectionCapacity ) {
+        int capacity = simulatorState->connectionCapacity > 0 ? simulatorState->connectionCapacity * 2
+                                                               : CONNECTION_MIN_CAPACITY;
+        simulatorState->connections = GrowStorage(
+          &simulatorState->storageArena, simulatorState->connections,
+          (size_t) simulatorState->connectionCapacity * sizeof( Connection ), (size_t) capacity * sizeof( Connection )
+        );
+        simulatorState->connectionCapacity = capacity;
+    }
+
+    int index = simulatorState->freeConnection;
+    if ( index != -1 ) {
+        simulatorState->freeConnection = simulatorState->connections[index].nextOutgoing;
+    } else {
+        index = simulatorState->connectionCount++;
+    }
+
+    Connection *newConnection      = &simulatorState->connections[index];
     newConnection->fromElementId = fromElementId;
     newConnection->toElementId   = toElementId;
     newConnection->toInputSlot     = toInputSlot;
     newConnection->isActive        = true;
-    simulatorState->connectionCount++;
+    LinkConnection( simulatorState, index, fromSlot, toSlot );
+    simulatorState->stateHash ^= ConnectionHashKey( newConnection );
+    simulatorState->changeGeneration++;
+
+    store->inputIds[toSlot][toInputSlot] = fromElementId;
+    if ( store->connectedInputCounts[toSlot] < MAX_INPUTS_PER_LOGIC_GATE ) {
+        store->connectedInputCounts[toSlot]++;
+    }
+    simulatorState->evaluationPlan.isValid = false;
+
+    TraceLog(
+      LOG_INFO,
+      "SERVER: Created connection from %d to element %d (slot %d). "
+      "Total connections: %d",
+      fromElementId, toElementId, toInputSlot, simulatorState->connectionCount
+    );
+    return true;
+}
+
+/**
+ * Unlinks a connection from both of its endpoints, disconnects the target input and puts the
+ * connection on the free list. Both endpoints must still be active.
+ */
+static void ReleaseConnection( SimulatorState *simulatorState, int index ) {
+    ElementStore *store      = &simulatorState->elements;
+    Connection   *connection = &simulatorState->connections[index];
+    Connection   *all        = simulatorState->connections;
+    int           fromSlot   = Server_FindElementSlot( simulatorState, connection->fromElementId );
+    int           toSlot     = Server_FindElementSlot( simulatorState, connection->toElementId );
+
+    if ( connection->previousOutgoing != -1 ) all[connection->previousOutgoing].nextOutgoing = connection->nextOutgoing;
+    else store->firstOutgoing[fromSlot] = connection->nextOutgoing;
+    if ( connection->nextOutgoing != -1 ) all[connection->nextOutgoing].previousOutgoing = connection->previousOutgoing;
+
+    if ( connection->previousIncoming != -1 ) all[connection->previousIncoming].nextIncoming = connection->nextIncoming;
+    else store->firstIncoming[toSlot] = connection->nextIncoming;
+    if ( connection->nextIncoming != -1 ) all[connection->nextIncoming].previousIncoming = connection->previousIncoming;
+
+    store->inputIds[toSlot][connection->toInputSlot] = -1;
+    store->inputStateBits[toSlot] &= (uint8_t) ~( 1u << connection->toInputSlot );
+    if ( store->connectedInputCounts[toSlot] > 0 ) store->connectedInputCounts[toSlot]--;
+
+    simulatorState->stateHash             ^= ConnectionHashKey( connection );
+    connection->isActive                   = false;
+    connection->nextOutgoing               = simulatorState->freeConnection;
+    simulatorState->freeConnection         = index;
+    simulatorState->evaluationPlan.isValid = false;
+    simulatorState->changeGeneration++;
+}
+
+bool Server_RemoveConnection( SimulatorState *simulatorState, int toElementId, int toInputSlot ) {
+    if ( simulatorState == NULL ) return false;
+
+    int toSlot = Server_FindElementSlot( simulatorState, toElementId );
+    if ( toSlot == -1 ) {
+        TraceLog( LOG_WARNING, "SERVER: Target element for disconnection not found (ID: %d).", toElementId );
+        return false;
+    }
+    for ( int c = simulatorState->elements.firstIncoming[toSlot]; c != -1; c = simulatorState->connections[c].nextIncoming ) {
+        if ( simulatorState->connections[c].toInputSlot == toInputSlot ) {
+            ReleaseConnection( simulatorState, c );
+            TraceLog( LOG_INFO, "SERVER: Removed connection into element %d (slot %d)", toElementId, toInputSlot );
+            return true;
+        }
+    }
+    TraceLog( LOG_WARNING, "SERVER: Input slot %d for element ID %d is not connected.", toInputSlot, toElementId );
+    return false;
+}
+
+bool Server_RemoveElement( SimulatorState *simulatorState, int elementId ) {
+    if ( simulatorState == NULL ) return false;
+
+    int slot = Server_FindElementSlot( simulatorState, elementId );
+    if ( slot == -1 ) {
+        TraceLog( LOG_WARNING, "SERVER: Element ID %d not found for removal", elementId );
+        return false;
+    }
+
+    ElementStore *store       = &simulatorState->elements;
+    int           connections = 0;
+    for ( ; store->firstOutgoing[slot] != -1; ++connections ) { ReleaseConnection( simulatorState, store->firstOutgoing[slot] ); }
+    for ( ; store->firstIncoming[slot] != -1; ++connections ) { ReleaseConnection( simulatorState, store->firstIncoming[slot] ); }
+
+    simulatorState->stateHash ^= ElementHashKey( store, slot );
+    if ( TestElementBit( store->outputBits, slot ) ) simulatorState->stateHash ^= SignalSlotKey( slot );
+    CountElementType( simulatorState, (ElementType) store->types[slot], -1 );
+    ElementIdMapRemove( &simulatorState->elementIdMap, elementId );
+
+    store->types[slot]              = ELEMENT_NONE;
+    store->oscillationPeriods[slot] = 0;
+    AssignElementBit( store->outputBits, slot, false );
+    AssignElementBit( store->defaultOutputBits, slot, false );
+    AssignElementBit( store->activeBits, slot, false );
+    store->freeSlots[store->freeSlotCount++] = slot;
+
+    simulatorState->evaluationPlan.isValid = false;
+    simulatorState->changeGeneration++;
+    TraceLog( LOG_INFO, "SERVER: Removed element ID %d and %d connections", elementId, connections );
+    return true;
+}
+
+void Server_CompactStorage( SimulatorState *simulatorState ) {
+    if ( simulatorState == NULL ) return;
+
+    ElementStore *store = &simulatorState->elements;
+    int           slots = 0;
+    for ( int i = 0; i < simulatorState->elementCount; ++i ) {
+        if ( !TestElementBit( store->activeBits, i ) ) continue;
+        if ( i != slots ) {
+            store->types[slots]                = store->types[i];
+            store->modules[slots]              = store->modules[i];
+            store->inputStateBits[slots]       = store->inputStateBits[i];
+            store->connectedInputCounts[slots] = store->connectedInputCounts[i];
+            memcpy( store->inputIds[slots], store->inputIds[i], sizeof( *store->inputIds ) );
+            store->ids[slots]                  = store->ids[i];
+            store->positions[slots]            = store->positions[i];
+            AssignElementBit( store->outputBits, slots, TestElementBit( store->outputBits, i ) );
+            AssignElementBit( store->defaultOutputBits, slots, TestElementBit( store->defaultOutputBits, i ) );
+            AssignElementBit( store->activeBits, slots, true );
+            ElementIdMapPut( &simulatorState->elementIdMap, store->ids[slots], slots );
+        }
+        store->oscillationPeriods[slots] = 0;
+        store->firstOutgoing[slots]      = -1;
+        store->firstIncoming[slots]      = -1;
+        slots++;
+    }
+    for ( int i = slots; i < simulatorState->elementCount; ++i ) {
+        AssignElementBit( store->outputBits, i, false );
+        AssignElementBit( store->defaultOutputBits, i, false );
+        AssignElementBit( store->activeBits, i, false );
+    }
+
+    int connections = 0;
+    for ( int c = 0; c < simulatorState->connectionCount; ++c ) {
+        if ( !simulatorState->connections[c].isActive ) continue;
+        simulatorState->connections[connections] = simulatorState->connections[c];
+        LinkConnection(
+          simulatorState, connections, Server_FindElementSlot( simulatorState, simulatorState->connections[c].fromElementId ),
+          Server_FindElementSlot( simulatorState, simulatorState->connections[c].toElementId )
+        );
+        connections++;
+    }
+
+    TraceLog(
+      LOG_INFO, "SERVER: Compacted %d element slots to %d and %d connections to %d", simulatorState->elementCount,
+      slots, simulatorState->connectionCount, connections
+    );
+    simulatorState->elementCount           = slots;
+    simulatorState->connectionCount        = connections;
+    simulatorState->freeConnection         = -1;
+    store->freeSlotCount                   = 0;
+    simulatorState->stateHash              = Server_ComputeStateHash( simulatorState );
+    simulatorState->evaluationPlan.isValid = false;
+    simulatorState->changeGeneration++;
+}
+
+void Server_Init( SimulatorState *simulatorState ) {
+    if ( simulatorState == NULL ) return;
+
+    srand( (unsigned int) time( NULL ) );
+
+    simulatorState->elementCount  = 0;
+    simulatorState->nextElementId = 1;
+    simulatorState->connectionCount = 0;
+    simulatorState->changeGeneration   = 1;
+    simulatorState->updatedGeneration  = 0;
+    simulatorState->analyzedGeneration = 0;
+    memset( simulatorState->elementTypeCounts, 0, sizeof( simulatorState->elementTypeCounts ) );
+    simulatorState->moduleCount            = 0;
+    simulatorState->evaluationPlan.isValid = false;
+    simulatorState->propagationMode        = PROPAGATION_EVENT_DRIVEN;
+    simulatorState->capability.isValid     = false;
+    simulatorState->stateWitness           = (StateWitness) { 0 };
+    simulatorState->coneSliceCount         = 0;
+    simulatorState->coneSliceClock         = 0;
+    memset( simulatorState->coneSlices, 0, sizeof( simulatorState->coneSlices ) );
+
+    // Storage starts empty and is allocated on the first placement or connection.
+    simulatorState->storageArena       = (Arena) { 0 };
+    simulatorState->elements           = (ElementStore) { 0 };
+    simulatorState->elementIdMap       = (ElementIdMap) { 0 };
+    simulatorState->connections        = NULL;
+    simulatorState->connectionCapacity = 0;
+    simulatorState->freeConnection     = -1;
+    simulatorState->evaluationPlan     = (EvaluationPlan) { 0 };
+    simulatorState->nativeKernel       = NULL;
+    simulatorState->propagationPool    = NULL;
+    simulatorState->propagationThreads = 0;
+
+    simulatorState->handCardCount    = 0;
+    simulatorState->deckCardCount    = 0;
+    simulatorState->currentDeckIndex = 0;
+    simulatorState->discardCardCount = 0;
+
+    Card buttonCard         = CreateElementCard( 1, "Button", ELEMENT_BUTTON );
+    Card switchCard         = CreateElementCard( 2, "Switch", ELEMENT_SWITCH );
+    Card andGateCard        = CreateElementCard( 3, "AND Gate", ELEMENT_AND );
+    Card orGateCard         = CreateElementCard( 4, "OR Gate", ELEMENT_OR );
+    Card sourceCard         = CreateElementCard( 5, "Source", ELEMENT_SOURCE );
+    Card sensorCard         = CreateElementCard( 6, "Sensor", ELEMENT_SENSOR );
+
+    Card requisitionCard    = Server_CreateActionCard( 7, "Requisition", ACTION_REQUISITION );
+    Card reOrgCard          = Server_CreateActionCard( 8, "Re-Org", ACTION_RE_ORG );
+
+    int  deckIdx            = 0;
+
+    for ( int type = 0; type < 6; ++type ) {
+        int cardCount = ( type < 4 ) ? 4 : 2;
+        for ( int i = 0; i < cardCount; ++i ) {
+            if ( deckIdx >= MAX_CARDS_IN_DECK ) break;
+            switch ( type ) {
+                case 0: simulatorState->userDeck[deckIdx++] = buttonCard; break;
+                case 1: simulatorState->userDeck[deckIdx++] = switchCard; break;
+                case 2: simulatorState->userDeck[deckIdx++] = andGateCard; break;
+                case 3: simulatorState->userDeck[deckIdx++] = orGateCard; break;
+                case 4: simulatorState->userDeck[deckIdx++] = sourceCard; break;
+                case 5: simulatorState->userDeck[deckIdx++] = sensorCard; break;
+            }
+        }
+        if ( deckIdx >= MAX_CARDS_IN_DECK ) break;
+    }
+
+    for ( int i = 0; i < 3 && deckIdx < MAX_CARDS_IN_DECK; ++i ) {
+        simulatorState->userDeck[deckIdx++] = requisitionCard;
+    }
+    for ( int i = 0; i < 2 && deckIdx < MAX_CARDS_IN_DECK; ++i ) {
+        simulatorState->userDeck[deckIdx++] = reOrgCard;
+    }
+
+    simulatorState->deckCardCount = deckIdx;
+    if ( simulatorState->deckCardCount > 1 ) {
+        for ( int i = simulatorState->deckCardCount - 1; i > 0; i-- ) {
+            int  j                         = rand() % ( i + 1 );
+            Card temp                      = simulatorState->userDeck[i];
+            simulatorState->userDeck[i]    = simulatorState->userDeck[j];
+            simulatorState->userDeck[j]    = temp;
+        }
+        TraceLog( LOG_INFO, "SERVER: Initial deck shuffled." );
+    }    for ( int i = 0; i < 5; ++i ) { Server_UserDrawCard( simulatorState ); }
+
+    simulatorState->score               = 0;
+    simulatorState->simulationComplete  = false;
+    simulatorState->stateHash           = Server_ComputeStateHash( simulatorState );
+    Server_LoadStarterScenario( simulatorState );
+
+    TraceLog(
+      LOG_INFO,
+      "SERVER_INIT_END: Score: %d, DeckCount: %d, CurrentDeckIdx: %d, "
+      "HandCount: %d, DiscardCount: %d",
+      simulatorState->score, simulatorState->deckCardCount, simulatorState->currentDeckIndex,
+      simulatorState->handCardCount, simulatorState->discardCardCount
+    );
+}
+
+void Server_Shutdown( SimulatorState *simulatorState ) {
+    if ( simulatorState == NULL ) return;
+
+#if NATIVE_ENGINE_AVAILABLE
+    if ( simulatorState->nativeKernel != NULL ) AbandonNativeKernel( simulatorState->nativeKernel );
+#endif
+#if PARALLEL_PROPAGATION_AVAILABLE
+    if ( simulatorState->propagationPool != NULL ) DestroyPropagationPool( simulatorState->propagationPool );
+#endif
+    arena_free( &simulatorState->storageArena );
+    arena_free( &simulatorState->evaluationPlan.arena );
+    free( simulatorState->stateWitness.originIds );
+    free( simulatorState->stateWitness.originValues );
+    for ( int i = 0; i < MAX_CONE_SLICES; ++i ) { arena_free( &simulatorState->coneSlices[i].arena ); }
+
+    simulatorState->elements           = (ElementStore) { 0 };
+    simulatorState->elementIdMap       = (ElementIdMap) { 0 };
+    simulatorState->connections        = NULL;
+    simulatorState->connectionCapacity = 0;
+    simulatorState->freeConnection     = -1;
+    simulatorState->elementCount       = 0;
+    simulatorState->connectionCount    = 0;
+    simulatorState->evaluationPlan     = (EvaluationPlan) { 0 };
+    simulatorState->nativeKernel       = NULL;
+    simulatorState->propagationPool    = NULL;
+    simulatorState->stateWitness       = (StateWitness) { 0 };
+    simulatorState->coneSliceCount     = 0;
+    memset( simulatorState->coneSlices, 0, sizeof( simulatorState->coneSlices ) );
+}
+
+/**
+ * Signal bytecode. Each instruction is a header word followed by the destination slot and one
+ * operand per connected input. The header packs the opcode (bits 0-7), the operand count (bits
+ * 8-15), the mask of connected input positions (bits 16-23) and, for AND, the input mask that
+ * makes the gate high (bits 24-31, 0xFF when it can never be). An operand is the driver slot
+ * shifted left by 3 with the input position in the low bits. Components are laid out back to
+ * back in plan order, so a run of acyclic components is one straight-line stretch of code.
+ */
+typedef enum SignalOpcode {
+    SIGNAL_OP_SET = 0,     ///< dst = 1; any operands only update the input states.
+    SIGNAL_OP_CLEAR,       ///< dst = 0; any operands only update the input states.
+    SIGNAL_OP_AND,         ///< dst = (input mask == required mask).
+    SIGNAL_OP_OR,          ///< dst = any input high.
+    SIGNAL_OP_NOR,         ///< dst = no input high.
+    SIGNAL_OP_LUT,         ///< dst = bit (input mask) of the table word after the operands.
+    SIGNAL_OP_COUNT
+} SignalOpcode;
+
+#define SIGNAL_HEADER( op, count, connected, required )                                                             \
+    ( (int32_t) ( (uint32_t) ( op ) | ( (uint32_t) ( count ) << 8 ) | ( (uint32_t) ( connected ) << 16 ) |          \
+                  ( (uint32_t) ( required ) << 24 ) ) )
+#define SIGNAL_OPCODE( header )    ( (uint32_t) ( header ) & 0xFF )
+#define SIGNAL_COUNT( header )     ( ( (uint32_t) ( header ) >> 8 ) & 0xFF )
+#define SIGNAL_CONNECTED( header ) ( ( (uint32_t) ( header ) >> 16 ) & 0xFF )
+#define SIGNAL_REQUIRED( header )  ( ( (uint32_t) ( header ) >> 24 ) & 0xFF )
+#define SIGNAL_LENGTH( header )    ( 2 + (int) SIGNAL_COUNT( header ) + ( SIGNAL_OPCODE( header ) == SIGNAL_OP_LUT ) )
+
+/** Mask of an element's inputs driven by constants; the high ones are also set in high. */
+static uint32_t ConstantInputMask( const SimulatorState *simulatorState, int slot, uint32_t *high ) {
+    const EvaluationPlan *plan  = &simulatorState->evaluationPlan;
+    const int            *input = plan->inputSlots[slot];
+    uint32_t              fixed = 0;
+
+    *high = 0;
+    for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) {
+        if ( input[k] < 0 || plan->slotReductions[input[k]] != SLOT_CONSTANT ) continue;
+        fixed |= 1u << k;
+        if ( TestElementBit( simulatorState->elements.outputBits, input[k] ) ) *high |= 1u << k;
+    }
+    return fixed;
+}
+
+static int EmitSignalInstruction( const SimulatorState *simulatorState, int slot, int32_t *code ) {
+    const ElementStore *store      = &simulatorState->elements;
+    const int          *inputSlots = simulatorState->evaluationPlan.inputSlots[slot];
+    bool                constant   = simulatorState->evaluationPlan.slotReductions[slot] == SLOT_CONSTANT;
+    uint32_t            op         = SIGNAL_OP_OR;
+
+    switch ( store->types[slot] ) {
+        case ELEMENT_SOURCE:
+        case ELEMENT_SENSOR:
+            if ( constant ) return 0;    // Written when the plan was compiled.
+            code[0] = SIGNAL_HEADER( store->types[slot] == ELEMENT_SOURCE ? SIGNAL_OP_SET : SIGNAL_OP_CLEAR, 0, 0, 0 );
+            code[1] = slot;
+            return 2;
+
+        case ELEMENT_AND: op = SIGNAL_OP_AND; break;
+
+        case ELEMENT_OR:
+        case ELEMENT_BUS:
+        case ELEMENT_NOT: op = store->types[slot] == ELEMENT_NOT ? SIGNAL_OP_NOR : SIGNAL_OP_OR; break;
+
+        case ELEMENT_MODULE: op = SIGNAL_OP_LUT; break;
+
+        default: return 0;    // Switches, buttons and stateful elements hold their output.
+    }
+
+    // Constant inputs are folded out: their input state bits were written when the plan was
+    // compiled and stay outside the sampled mask. A constant gate with a varying input still
+    // samples everything, since its input states are visible. Cyclic members are never folded,
+    // so a member held by a dominating constant input (low into AND, high into OR or NOT)
+    // becomes SET or CLEAR over its inputs, and any other keeps its constant inputs sampled.
+    uint32_t high  = 0;
+    uint32_t fixed = ConstantInputMask( simulatorState, slot, &high );
+    uint32_t wired = 0;
+    for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) {
+        if ( inputSlots[k] >= 0 ) wired |= 1u << k;
+    }
+    if ( constant ) {
+        if ( fixed == wired ) return 0;
+        fixed = 0;
+        high  = 0;
+    } else if ( simulatorState->evaluationPlan.componentCyclic[simulatorState->evaluationPlan.componentOf[slot]] ) {
+        if ( op == SIGNAL_OP_AND && ( fixed & ~high ) != 0 ) op = SIGNAL_OP_CLEAR;
+        else if ( op == SIGNAL_OP_NOR && high != 0 ) op = SIGNAL_OP_CLEAR;
+        else if ( op == SIGNAL_OP_OR && high != 0 ) op = SIGNAL_OP_SET;
+        fixed = 0;
+        high  = 0;
+    }
+
+    uint32_t connected = 0;
+    int      count     = 0;
+    for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) {
+        if ( inputSlots[k] < 0 || ( fixed >> k ) & 1 ) continue;
+        connected |= 1u << k;
+        code[2 + count++] = (int32_t) ( ( (uint32_t) inputSlots[k] << 3 ) | (uint32_t) k );
+    }
+
+    uint32_t required = 0;
+    if ( op == SIGNAL_OP_AND ) {
+        required = ( wired != 0 && store->connectedInputCounts[slot] >= 2 ) ? connected : 0xFF;
+    } else if ( op == SIGNAL_OP_NOR && wired == 0 ) {
+        op = SIGNAL_OP_CLEAR;    // An unconnected NOT stays low.
+    }
+
+    code[0] = SIGNAL_HEADER( op, count, connected, required );
+    code[1] = slot;
+    if ( op == SIGNAL_OP_LUT ) {
+        uint32_t table  = simulatorState->modules[store->modules[slot]].truthTable;
+        uint32_t folded = 0;
+        for ( uint32_t m = 0; m < 1u << MAX_INPUTS_PER_LOGIC_GATE; ++m ) {
+            folded |= ( ( table >> ( ( m & ~fixed ) | high ) ) & 1 ) << m;
+        }
+        code[2 + count] = (int32_t) folded;
+        return 3 + count;
+    }
+    return 2 + count;
+}
+
+static void CompileSignalProgram( SimulatorState *simulatorState, size_t slots ) {
+    EvaluationPlan *plan  = &simulatorState->evaluationPlan;
+    size_t          words = slots;
+    size_t          bound = 3 * (size_t) plan->compiledElementCount +
+                   (size_t) plan->fanoutStart[plan->compiledElementCount];
+    while ( words < bound ) { words *= 2; }
+
+    plan->componentCode = arena_alloc( &plan->arena, ( slots + 1 ) * sizeof( int ) );
+    plan->code          = arena_alloc( &plan->arena, words * sizeof( int32_t ) );
+
+    int length = 0;
+    for ( int c = 0; c < plan->componentCount; ++c ) {
+        plan->componentCode[c] = length;
+        for ( int j = plan->componentStart[c]; j < plan->componentStart[c + 1]; ++j ) {
+            length += EmitSignalInstruction( simulatorState, plan->order[j], plan->code + length );
+        }
+    }
+    plan->componentCode[plan->componentCount] = length;
+    plan->codeLength                          = length;
+}
+
+static void AssignComponentSlots( EvaluationPlan *plan ) {
+    for ( int c = 0; c < plan->componentCount; ++c ) {
+        for ( int j = plan->componentStart[c]; j < plan->componentStart[c + 1]; ++j ) {
+            plan->componentOf[plan->order[j]] = c;
+        }
+    }
+}
+
+/**
+ * Renumbers the components level by level and groups the levels into phases. Tarjan already
+ * yields a topological order, so each level is found in one pass over the components' inputs.
+ */
+static void OrderComponentsByLevel( EvaluationPlan *plan, size_t slots ) {
+    Arena     *arena      = &plan->arena;
+    Arena_Mark scratch    = arena_snapshot( arena );
+    int       *level      = arena_alloc( arena, slots * sizeof( int ) );
+    int       *levelFill  = arena_alloc( arena, ( slots + 1 ) * sizeof( int ) );
+    int       *position   = arena_alloc( arena, slots * sizeof( int ) );
+    int       *order      = arena_alloc( arena, slots * sizeof( int ) );
+    int       *start      = arena_alloc( arena, ( slots + 1 ) * sizeof( int ) );
+    bool      *cyclic     = arena_alloc( arena, slots * sizeof( bool ) );
+    int        components = plan->componentCount;
+
+    AssignComponentSlots( plan );
+
+    plan->levelCount = 0;
+    for ( int c = 0; c < components; ++c ) {
+        int depth = 0;
+        for ( int j = plan->componentStart[c]; j < plan->componentStart[c + 1]; ++j ) {
+            int member = plan->order[j];
+            for ( int f = plan->faninStart[member]; f < plan->faninStart[member + 1]; ++f ) {
+                int source = plan->faninSources[f];
+                if ( plan->componentOf[source] == c ) continue;
+                if ( level[plan->componentOf[source]] + 1 > depth ) depth = level[plan->componentOf[source]] + 1;
+            }
+        }
+        level[c] = depth;
+        if ( depth + 1 > plan->levelCount ) plan->levelCount = depth + 1;
+    }
+
+    // Counting sort by level; components keep their Tarjan order within a level.
+    for ( int l = 0; l <= plan->levelCount; ++l ) { levelFill[l] = 0; }
+    for ( int c = 0; c < components; ++c ) { levelFill[level[c] + 1]++; }
+    for ( int l = 0; l < plan->levelCount; ++l ) { levelFill[l + 1] += levelFill[l]; }
+
+    plan->phaseCount         = 0;
+    plan->parallelPhaseCount = 0;
+    for ( int l = 0; l < plan->levelCount; ++l ) {
+        bool wide = levelFill[l + 1] - levelFill[l] >= PARALLEL_MIN_LEVEL_WIDTH;
+        if ( wide || plan->phaseCount == 0 || plan->phaseParallel[plan->phaseCount - 1] ) {
+            plan->phaseStart[plan->phaseCount]    = levelFill[l];
+            plan->phaseParallel[plan->phaseCount] = wide;
+            plan->phaseCount++;
+            plan->parallelPhaseCount += wide;
+        }
+    }
+    plan->phaseStart[plan->phaseCount] = components;
+
+    for ( int c = 0; c < components; ++c ) { position[levelFill[level[c]]++] = c; }
+
+    int length = 0;
+    for ( int n = 0; n < components; ++n ) {
+        int c     = position[n];
+        start[n]  = length;
+        cyclic[n] = plan->componentCyclic[c];
+        for ( int j = plan->componentStart[c]; j < plan->componentStart[c + 1]; ++j ) {
+            order[length++] = plan->order[j];
+        }
+    }
+    start[components] = length;
+
+    memcpy( plan->order, order, (size_t) length * sizeof( int ) );
+    memcpy( plan->componentStart, start, (size_t) ( components + 1 ) * sizeof( int ) );
+    memcpy( plan->componentCyclic, cyclic, (size_t) components * sizeof( bool ) );
+    arena_rewind( arena, scratch );
+
+    AssignComponentSlots( plan );
+}
+
+/** Output an acyclic element is held at by its constant inputs, or -1 if it can still change. */
+static int FoldConstantOutput( const SimulatorState *simulatorState, int slot ) {
+    const ElementStore *store = &simulatorState->elements;
+    const int          *input = simulatorState->evaluationPlan.inputSlots[slot];
+    uint32_t            high  = 0;
+    uint32_t            fixed = ConstantInputMask( simulatorState, slot, &high );
+    uint32_t            wired = 0;
+
+    for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) {
+        if ( input[k] >= 0 ) wired |= 1u << k;
+    }
+
+    switch ( store->types[slot] ) {
+        case ELEMENT_SOURCE: return 1;
+        case ELEMENT_SENSOR: return 0;
+        case ELEMENT_AND:
+            if ( wired == 0 || store->connectedInputCounts[slot] < 2 || ( fixed & ~high ) != 0 ) return 0;
+            return fixed == wired ? 1 : -1;
+        case ELEMENT_OR:
+        case ELEMENT_BUS:
+            if ( high != 0 ) return 1;
+            return fixed == wired ? 0 : -1;
+        case ELEMENT_NOT:
+            if ( wired == 0 || high != 0 ) return 0;
+            return fixed == wired ? 1 : -1;
+        case ELEMENT_MODULE:
+            if ( fixed != wired ) return -1;
+            return (int) ( ( simulatorState->modules[store->modules[slot]].truthTable >> high ) & 1 );
+        default: return -1;
+    }
+}
+
+/**
+ * Derives the simulated netlist. In plan order, every producer is classified before its
+ * consumers: an acyclic element whose output FoldConstantOutput fixes becomes a constant and has
+ * its output written now, and a single-input OR or BUS is bypassed by aliasing it to its driver's
+ * alias. A walk back from the sensors over the aliased inputs then marks everything it misses as
+ * dead.
+ */
+static void ReduceNetlist( SimulatorState *simulatorState, size_t slots ) {
+    EvaluationPlan *plan  = &simulatorState->evaluationPlan;
+    ElementStore   *store = &simulatorState->elements;
+    Arena          *arena = &plan->arena;
+    int             count = simulatorState->elementCount;
+
+    plan->slotReductions  = arena_alloc( arena, slots * sizeof( uint8_t ) );
+    plan->simulatedInputs = arena_alloc( arena, slots * sizeof( *plan->simulatedInputs ) );
+    plan->simulatedOrder  = arena_alloc( arena, slots * sizeof( int ) );
+    plan->simulatedStart  = arena_alloc( arena, ( slots + 1 ) * sizeof( int ) );
+
+    Arena_Mark scratch = arena_snapshot( arena );
+    int       *alias   = arena_alloc( arena, slots * sizeof( int ) );
+    int       *stack   = arena_alloc( arena, slots * sizeof( int ) );
+    bool      *reached = arena_alloc( arena, slots * sizeof( bool ) );
+
+    for ( int i = 0; i < count; ++i ) {
+        plan->slotReductions[i] = SLOT_DEAD;
+        alias[i]                = i;
+        reached[i]              = false;
+    }
+    plan->constantCount = 0;
+    plan->bypassedCount = 0;
+    plan->deadCount     = 0;
+
+    for ( int j = 0; j < plan->componentStart[plan->componentCount]; ++j ) {
+        int slot                   = plan->order[j];
+        plan->slotReductions[slot] = SLOT_SIMULATED;
+        if ( plan->componentCyclic[plan->componentOf[slot]] ) continue;
+
+        int value = FoldConstantOutput( simulatorState, slot );
+        if ( value != -1 ) {
+            plan->slotReductions[slot] = SLOT_CONSTANT;
+            plan->constantCount++;
+            if ( TestElementBit( store->outputBits, slot ) != ( value == 1 ) ) {
+                AssignElementBit( store->outputBits, slot, value == 1 );
+                simulatorState->stateHash ^= SignalSlotKey( slot );
+            }
+        } else if ( ( store->types[slot] == ELEMENT_OR || store->types[slot] == ELEMENT_BUS ) &&
+                    plan->faninStart[slot + 1] - plan->faninStart[slot] == 1 ) {
+            plan->slotReductions[slot] = SLOT_BYPASSED;
+            plan->bypassedCount++;
+            alias[slot] = alias[plan->faninSources[plan->faninStart[slot]]];
+        }
+    }
+
+    // Gates keep the states of their constant inputs from here on; instructions no longer sample them.
+    for ( int i = 0; i < count; ++i ) {
+        for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) {
+            int source                  = plan->inputSlots[i][k];
+            plan->simulatedInputs[i][k] = source < 0 ? -1 : alias[source];
+        }
+
+        uint8_t type = store->types[i];
+        if ( type == ELEMENT_AND || type == ELEMENT_OR || type == ELEMENT_BUS || type == ELEMENT_NOT ||
+             type == ELEMENT_MODULE ) {
+            uint32_t high  = 0;
+            uint32_t fixed = ConstantInputMask( simulatorState, i, &high );
+            store->inputStateBits[i] = (uint8_t) ( ( store->inputStateBits[i] & ~fixed ) | high );
+        }
+    }
+
+    int top = 0;
+    for ( int i = 0; i < count; ++i ) {
+        if ( !IsActiveElementOfType( store, i, ELEMENT_SENSOR ) ) continue;
+        reached[i]   = true;
+        stack[top++] = i;
+    }
+    while ( top > 0 ) {
+        int slot = stack[--top];
+        for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) {
+            int source = plan->simulatedInputs[slot][k];
+            if ( source < 0 || reached[source] || plan->slotReductions[source] == SLOT_CONSTANT ) continue;
+            reached[source] = true;
+            stack[top++]    = source;
+        }
+    }
+    for ( int j = 0; j < plan->componentStart[plan->componentCount]; ++j ) {
+        int slot = plan->order[j];
+        if ( plan->slotReductions[slot] != SLOT_SIMULATED || reached[slot] ) continue;
+        plan->slotReductions[slot] = SLOT_DEAD;
+        plan->deadCount++;
+    }
+    arena_rewind( arena, scratch );
+}
+
+/**
+ * Lane pattern of origin o within one 64-lane word: bit b is bit o of the vector index b.
+ * Origins from 6 upward are constant across a word and are derived from the word index. The
+ * first six are also the input columns of a 64-entry truth table.
+ */
+static const uint64_t originLanePatterns[6] = {
+    0xAAAAAAAAAAAAAAAAull, 0xCCCCCCCCCCCCCCCCull, 0xF0F0F0F0F0F0F0F0ull,
+    0xFF00FF00FF00FF00ull, 0xFFFF0000FFFF0000ull, 0xFFFFFFFF00000000ull,
+};
+
+/** Applies a module table to 64 assignments at once; bit m of pins[k] is pin k in assignment m. */
+static uint64_t ApplyModuleTable( uint32_t table, const uint64_t *pins ) {
+    uint64_t result = 0;
+    for ( int m = 0; m < 64; ++m ) {
+        uint32_t index = 0;
+        for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) { index |= (uint32_t) ( ( pins[k] >> m ) & 1 ) << k; }
+        result |= (uint64_t) ( ( table >> index ) & 1 ) << m;
+    }
+    return result;
+}
+
+/**
+ * Evaluates one element over 64 assignments of a truth table's inputs at once, following the
+ * same rules as the signal bytecode; input holds the element's driver slots and values the word
+ * of each element by localOf index. A sensor exported as a module output reports whether it is
+ * triggered rather than its own (always low) output.
+ */
+static uint64_t EvaluateTableElement(
+  const SimulatorState *simulatorState, int slot, const int *input, const int *localOf, const uint64_t *values,
+  bool isOutput
+) {
+    const ElementStore *store = &simulatorState->elements;
+    uint64_t            pins[MAX_INPUTS_PER_LOGIC_GATE];
+    uint64_t            all   = ~(uint64_t) 0;
+    uint64_t            any   = 0;
+    int                 count = 0;
+
+    for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) {
+        pins[k] = input[k] < 0 ? 0 : values[localOf[input[k]]];
+        if ( input[k] < 0 ) continue;
+        all &= pins[k];
+        any |= pins[k];
+        count++;
+    }
+
+    switch ( store->types[slot] ) {
+        case ELEMENT_SOURCE: return ~(uint64_t) 0;
+        case ELEMENT_SENSOR: return isOutput ? any : 0;
+        case ELEMENT_AND: return count > 0 && store->connectedInputCounts[slot] >= 2 ? all : 0;
+        case ELEMENT_OR:
+        case ELEMENT_BUS: return any;
+        case ELEMENT_NOT: return count > 0 ? ~any : 0;
+        case ELEMENT_MODULE: return ApplyModuleTable( simulatorState->modules[store->modules[slot]].truthTable, pins );
+        default: return TestElementBit( store->outputBits, slot ) ? ~(uint64_t) 0 : 0;
+    }
+}
+
+static int FindSlotIndex( const int *list, int count, int slot ) {
+    for ( int i = 0; i < count; ++i ) {
+        if ( list[i] == slot ) return i;
+    }
+    return -1;
+}
+
+static bool IsConeGate( const EvaluationPlan *plan, const ElementStore *store, int slot ) {
+    switch ( store->types[slot] ) {
+        case ELEMENT_AND:
+        case ELEMENT_OR:
+        case ELEMENT_BUS:
+        case ELEMENT_NOT:
+        case ELEMENT_MODULE:
+            return plan->slotReductions[slot] == SLOT_SIMULATED && !plan->componentCyclic[plan->componentOf[slot]];
+        default: return false;
+    }
+}
+
+/**
+ * Partitions the simulated acyclic gates into fan-out-free cones and computes their truth tables.
+ * Slots are visited consumers first, so each unclaimed gate roots a cone; a gate feeding only a
+ * member joins it if the leaves, with the gate's inputs in its place, still number
+ * LUT_CONE_MAX_LEAVES or fewer. Constant inputs are folded into the table rather than taking a
+ * leaf. A cone is a tree, so its members in reverse discovery order are producers first.
+ */
+static void FindLutCones( SimulatorState *simulatorState, size_t slots ) {
+    EvaluationPlan     *plan  = &simulatorState->evaluationPlan;
+    const ElementStore *store = &simulatorState->elements;
+    Arena              *arena = &plan->arena;
+    int                 count = simulatorState->elementCount;
+
+    plan->coneRoot       = arena_alloc( arena, slots * sizeof( int ) );
+    plan->coneLeaves     = arena_alloc( arena, slots * sizeof( *plan->coneLeaves ) );
+    plan->coneLeafCounts = arena_alloc( arena, slots * sizeof( uint8_t ) );
+    plan->coneTables     = arena_alloc( arena, slots * sizeof( uint64_t ) );
+    plan->coneLookup     = arena_alloc( arena, slots * sizeof( bool ) );
+
+    // values holds the two constants, then the leaves, then the members.
+    Arena_Mark scratch = arena_snapshot( arena );
+    int       *members = arena_alloc( arena, slots * sizeof( int ) );
+    int       *localOf = arena_alloc( arena, slots * sizeof( int ) );
+    int       *fanout  = arena_alloc( arena, slots * sizeof( int ) );
+    uint64_t  *values  = arena_alloc( arena, ( slots + 2 + LUT_CONE_MAX_LEAVES ) * sizeof( uint64_t ) );
+
+    for ( int i = 0; i < count; ++i ) {
+        plan->coneRoot[i]       = -1;
+        plan->coneLeafCounts[i] = 0;
+        plan->coneLookup[i]     = false;
+        localOf[i]              = -1;
+        fanout[i]               = 0;
+        if ( plan->slotReductions[i] == SLOT_CONSTANT ) localOf[i] = TestElementBit( store->outputBits, i ) ? 1 : 0;
+    }
+    values[0] = 0;
+    values[1] = ~(uint64_t) 0;
+
+    // Fan-out counts the connections whose consumer still reads the value: simulated elements
+    // and sensors, through bypassed buffers.
+    for ( int i = 0; i < count; ++i ) {
+        if ( plan->slotReductions[i] != SLOT_SIMULATED && !IsActiveElementOfType( store, i, ELEMENT_SENSOR ) ) continue;
+        for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) {
+            if ( plan->simulatedInputs[i][k] >= 0 ) fanout[plan->simulatedInputs[i][k]]++;
+        }
+    }
+    plan->coneCount          = 0;
+    plan->collapsedGateCount = 0;
+
+    for ( int j = plan->componentStart[plan->componentCount] - 1; j >= 0; --j ) {
+        int root = plan->order[j];
+        if ( plan->coneRoot[root] != -1 || !IsConeGate( plan, store, root ) ) continue;
+
+        int *leaves      = plan->coneLeaves[root];
+        int  leafCount   = 0;
+        int  memberCount = 1;
+        members[0]           = root;
+        plan->coneRoot[root] = root;
+        for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) {
+            int input = plan->simulatedInputs[root][k];
+            if ( input >= 0 && plan->slotReductions[input] != SLOT_CONSTANT && FindSlotIndex( leaves, leafCount, input ) == -1 ) {
+                leaves[leafCount++] = input;
+            }
+        }
+
+        for ( int head = 0; head < memberCount; ++head ) {
+            int member = members[head];
+            for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) {
+                int source = plan->simulatedInputs[member][k];
+                if ( source < 0 || plan->coneRoot[source] != -1 || fanout[source] != 1 || !IsConeGate( plan, store, source ) ) {
+                    continue;
+                }
+
+                int added[MAX_INPUTS_PER_LOGIC_GATE];
+                int addedCount = 0;
+                for ( int g = 0; g < MAX_INPUTS_PER_LOGIC_GATE; ++g ) {
+                    int input = plan->simulatedInputs[source][g];
+                    if ( input >= 0 && plan->slotReductions[input] != SLOT_CONSTANT &&
+                         FindSlotIndex( leaves, leafCount, input ) == -1 && FindSlotIndex( added, addedCount, input ) == -1 ) {
+                        added[addedCount++] = input;
+                    }
+                }
+                if ( leafCount - 1 + addedCount > LUT_CONE_MAX_LEAVES ) continue;
+
+                for ( int at = FindSlotIndex( leaves, leafCount, source ); at + 1 < leafCount; ++at ) {
+                    leaves[at] = leaves[at + 1];
+                }
+                leafCount--;
+                for ( int a = 0; a < addedCount; ++a ) { leaves[leafCount++] = added[a]; }
+                plan->coneRoot[source]  = root;
+                members[memberCount++] = source;
+            }
+        }
+
+        for ( int k = 0; k < leafCount; ++k ) {
+            localOf[leaves[k]] = 2 + k;
+            values[2 + k]      = originLanePatterns[k];
+        }
+        for ( int m = memberCount - 1; m >= 0; --m ) {
+            int member                          = members[m];
+            localOf[member]                     = 2 + LUT_CONE_MAX_LEAVES + m;
+            values[2 + LUT_CONE_MAX_LEAVES + m] = EvaluateTableElement(
+              simulatorState, member, plan->simulatedInputs[member], localOf, values, false
+            );
+        }
+        for ( int k = 0; k < leafCount; ++k ) { localOf[leaves[k]] = -1; }
+        for ( int m = 0; m < memberCount; ++m ) { localOf[members[m]] = -1; }
+
+        // A lane sweep spends about one select per table bit pair and one mux per inner node, as
+        // much as 2^(leaves-1) gates cost, so only cones at least that large are looked up.
+        plan->coneLeafCounts[root] = (uint8_t) leafCount;
+        plan->coneTables[root]     = values[2 + LUT_CONE_MAX_LEAVES];
+        plan->coneLookup[root]     = memberCount >= 2 && memberCount >= ( 1 << ( leafCount > 0 ? leafCount - 1 : 0 ) );
+        plan->coneCount++;
+        if ( plan->coneLookup[root] ) plan->collapsedGateCount += memberCount - 1;
+    }
+    arena_rewind( arena, scratch );
+}
+
+/** Lists, component by component, the slots analysis sweeps evaluate: cone roots stand for their cones. */
+static void ListSimulatedSlots( EvaluationPlan *plan ) {
+    int length = 0;
+    for ( int c = 0; c < plan->componentCount; ++c ) {
+        plan->simulatedStart[c] = length;
+        for ( int j = plan->componentStart[c]; j < plan->componentStart[c + 1]; ++j ) {
+            int slot = plan->order[j];
+            int root = plan->coneRoot[slot];
+            if ( plan->slotReductions[slot] != SLOT_SIMULATED || ( root != -1 && root != slot && plan->coneLookup[root] ) ) {
+                continue;
+            }
+            plan->simulatedOrder[length++] = slot;
+        }
+    }
+    plan->simulatedStart[plan->componentCount] = length;
+}
+
+#define AIG_FALSE 0
+#define AIG_TRUE  1
+
+static bool IsAigGateType( uint8_t type ) {
+    return type == ELEMENT_AND || type == ELEMENT_OR || type == ELEMENT_BUS || type == ELEMENT_NOT || type == ELEMENT_MODULE;
+}
+
+static int AigInput( AndInverterGraph *aig, int slot ) {
+    int node             = aig->nodeCount++;
+    aig->fanins[node][0] = -1;
+    aig->fanins[node][1] = -1;
+    aig->nodeSlots[node] = slot;
+    aig->chain[node]     = -1;
+    aig->inputCount++;
+    return 2 * node;
+}
+
+/** AND of two literals, folded when an operand decides it and shared through the hash table. */
+static int AigAnd( AndInverterGraph *aig, int a, int b ) {
+    if ( a > b ) {
+        int swap = a;
+        a        = b;
+        b        = swap;
+    }
+    if ( a == AIG_FALSE || a == ( b ^ 1 ) ) return AIG_FALSE;
+    if ( a == AIG_TRUE || a == b ) return b;
+
+    int bucket = (int) ( MixHash64( (uint64_t) a << 32 | (uint32_t) b ) & (uint64_t) aig->bucketMask );
+    for ( int node = aig->buckets[bucket]; node != -1; node = aig->chain[node] ) {
+        if ( aig->fanins[node][0] == a && aig->fanins[node][1] == b ) {
+            aig->mergedCount++;
+            return 2 * node;
+        }
+    }
+
+    int node             = aig->nodeCount++;
+    aig->fanins[node][0] = a;
+    aig->fanins[node][1] = b;
+    aig->nodeSlots[node] = -1;
+    aig->chain[node]     = aig->buckets[bucket];
+    aig->buckets[bucket] = node;
+    aig->andCount++;
+    return 2 * node;
+}
+
+static int AigOr( AndInverterGraph *aig, int a, int b ) { return AigAnd( aig, a ^ 1, b ^ 1 ) ^ 1; }
+
+/** Most AND nodes lowering the element in slot can create, its sensor trigger included. */
+static int AigNodeBound( const SimulatorState *simulatorState, int slot ) {
+    const int *inputs = simulatorState->evaluationPlan.inputSlots[slot];
+    int        count  = 0;
+    for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) { count += inputs[k] >= 0; }
+
+    switch ( simulatorState->elements.types[slot] ) {
+        case ELEMENT_MODULE: return count > 0 ? 3 * ( ( 1 << MAX_INPUTS_PER_LOGIC_GATE ) - 1 ) : 0;
+        case ELEMENT_AND:
+        case ELEMENT_OR:
+        case ELEMENT_BUS:
+        case ELEMENT_NOT:
+        case ELEMENT_SENSOR: return count > 0 ? count - 1 : 0;
+        default: return 0;
+    }
+}
+
+/**
+ * Literal of the element in slot as a function of the output literals of its inputs. A module's
+ * table becomes a multiplexer tree with one level per pin; an unconnected pin is low.
+ */
+static int LowerElementToAig( AndInverterGraph *aig, const SimulatorState *simulatorState, int slot ) {
+    const int *inputs = simulatorState->evaluationPlan.inputSlots[slot];
+    int        literals[MAX_INPUTS_PER_LOGIC_GATE];
+    int        count  = 0;
+    int        result = AIG_FALSE;
+    for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) {
+        if ( inputs[k] >= 0 ) literals[count++] = aig->outputLiterals[inputs[k]];
+    }
+
+    switch ( simulatorState->elements.types[slot] ) {
+        case ELEMENT_SOURCE: return AIG_TRUE;
+
+        case ELEMENT_AND:
+            if ( count < 2 ) return AIG_FALSE;
+            result = AIG_TRUE;
+            for ( int i = 0; i < count; ++i ) { result = AigAnd( aig, result, literals[i] ); }
+            return result;
+
+        case ELEMENT_OR:
+        case ELEMENT_BUS:
+        case ELEMENT_NOT:
+            for ( int i = 0; i < count; ++i ) { result = AigOr( aig, result, literals[i] ); }
+            return simulatorState->elements.types[slot] == ELEMENT_NOT && count > 0 ? result ^ 1 : result;
+
+        case ELEMENT_MODULE:
+            {
+                uint32_t table = simulatorState->modules[simulatorState->elements.modules[slot]].truthTable;
+                int      node[1 << MAX_INPUTS_PER_LOGIC_GATE];
+                for ( int m = 0; m < 1 << MAX_INPUTS_PER_LOGIC_GATE; ++m ) { node[m] = ( table >> m ) & 1 ? AIG_TRUE : AIG_FALSE; }
+                for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) {
+                    int pin = inputs[k] >= 0 ? aig->outputLiterals[inputs[k]] : AIG_FALSE;
+                    for ( int i = 0; i < 1 << ( MAX_INPUTS_PER_LOGIC_GATE - 1 - k ); ++i ) {
+                        node[i] = AigOr( aig, AigAnd( aig, pin, node[2 * i + 1] ), AigAnd( aig, pin ^ 1, node[2 * i] ) );
+                    }
+                }
+                return node[0];
+            }
+
+        default: return AIG_FALSE;
+    }
+}
+
+/**
+ * Lowers the plan to an And-Inverter Graph component by component. A feedback loop is lowered by
+ * a depth-first walk over its gates: a gate reached again while still on the walk's stack closes
+ * a cycle and becomes an input node, which the gates lowered after it read, and once the whole
+ * loop is lowered its function over those inputs is kept as its next-state literal.
+ */
+static void BuildAndInverterGraph( SimulatorState *simulatorState, size_t slots ) {
+    EvaluationPlan     *plan  = &simulatorState->evaluationPlan;
+    AndInverterGraph   *aig   = &plan->aig;
+    const ElementStore *store = &simulatorState->elements;
+    Arena              *arena = &plan->arena;
+    int                 count = simulatorState->elementCount;
+
+    size_t bound = 1 + (size_t) count;
+    for ( int i = 0; i < plan->componentStart[plan->componentCount]; ++i ) {
+        bound += (size_t) AigNodeBound( simulatorState, plan->order[i] );
+    }
+    size_t nodes   = slots;
+    size_t buckets = slots;
+    while ( nodes < bound ) { nodes *= 2; }
+    while ( buckets < 2 * bound ) { buckets *= 2; }
+
+    aig->fanins          = arena_alloc( arena, nodes * sizeof( *aig->fanins ) );
+    aig->nodeSlots       = arena_alloc( arena, nodes * sizeof( int ) );
+    aig->chain           = arena_alloc( arena, nodes * sizeof( int ) );
+    aig->buckets         = arena_alloc( arena, buckets * sizeof( int ) );
+    aig->outputLiterals  = arena_alloc( arena, slots * sizeof( int ) );
+    aig->triggerLiterals = arena_alloc( arena, slots * sizeof( int ) );
+    aig->nextLiterals    = arena_alloc( arena, slots * sizeof( int ) );
+    aig->bucketMask      = (int) buckets - 1;
+    aig->inputCount      = 0;
+    aig->andCount        = 0;
+    aig->mergedCount     = 0;
+    aig->stateCount      = 0;
+    for ( size_t b = 0; b < buckets; ++b ) { aig->buckets[b] = -1; }
+    for ( int i = 0; i < count; ++i ) {
+        aig->outputLiterals[i]  = -1;
+        aig->triggerLiterals[i] = -1;
+        aig->nextLiterals[i]    = -1;
+    }
+
+    aig->fanins[0][0] = -1;
+    aig->fanins[0][1] = -1;
+    aig->nodeSlots[0] = -1;
+    aig->chain[0]     = -1;
+    aig->nodeCount    = 1;
+
+    Arena_Mark scratch   = arena_snapshot( arena );
+    int       *walkSlot  = arena_alloc( arena, slots * sizeof( int ) );
+    int       *walkPin   = arena_alloc( arena, slots * sizeof( int ) );
+    bool      *onWalk    = arena_alloc( arena, slots * sizeof( bool ) );
+    int       *stateList = arena_alloc( arena, slots * sizeof( int ) );
+    if ( count > 0 ) memset( onWalk, 0, (size_t) count * sizeof( bool ) );
+
+    for ( int c = 0; c < plan->componentCount; ++c ) {
+        int  first      = plan->componentStart[c];
+        int  last       = plan->componentStart[c + 1];
+        bool cyclic     = plan->componentCyclic[c];
+        int  stateCount = 0;
+
+        for ( int j = first; j < last; ++j ) {
+            int     slot = plan->order[j];
+            uint8_t type = store->types[slot];
+            if ( type == ELEMENT_SOURCE || type == ELEMENT_SENSOR ) {
+                aig->outputLiterals[slot] = type == ELEMENT_SOURCE ? AIG_TRUE : AIG_FALSE;
+            } else if ( !IsAigGateType( type ) ) {
+                aig->outputLiterals[slot] = AigInput( aig, slot );
+            }
+        }
+        for ( int j = first; j < last; ++j ) {
+            int slot = plan->order[j];
+            if ( aig->outputLiterals[slot] != -1 ) continue;
+            if ( !cyclic ) {
+                aig->outputLiterals[slot] = LowerElementToAig( aig, simulatorState, slot );
+                continue;
+            }
+
+            int depth    = 0;
+            walkSlot[0]  = slot;
+            walkPin[0]   = 0;
+            onWalk[slot] = true;
+            while ( depth >= 0 ) {
+                int node = walkSlot[depth];
+                if ( walkPin[depth] < MAX_INPUTS_PER_LOGIC_GATE ) {
+                    int input = plan->inputSlots[node][walkPin[depth]++];
+                    if ( input < 0 || plan->componentOf[input] != c || aig->outputLiterals[input] != -1 ) continue;
+                    if ( onWalk[input] ) {
+                        aig->outputLiterals[input] = AigInput( aig, input );
+                        stateList[stateCount++]    = input;
+                        continue;
+                    }
+                    depth++;
+                    walkSlot[depth] = input;
+                    walkPin[depth]  = 0;
+                    onWalk[input]   = true;
+                    continue;
+                }
+                if ( aig->outputLiterals[node] == -1 ) {
+                    aig->outputLiterals[node] = LowerElementToAig( aig, simulatorState, node );
+                }
+                onWalk[node] = false;
+                depth--;
+            }
+        }
+        for ( int i = 0; i < stateCount; ++i ) {
+            aig->nextLiterals[stateList[i]] = LowerElementToAig( aig, simulatorState, stateList[i] );
+        }
+        aig->stateCount += stateCount;
+
+        for ( int j = first; j < last; ++j ) {
+            int slot = plan->order[j];
+            if ( store->types[slot] != ELEMENT_SENSOR ) continue;
+            int trigger = AIG_FALSE;
+            for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) {
+                int input = plan->inputSlots[slot][k];
+                if ( input >= 0 ) trigger = AigOr( aig, trigger, aig->outputLiterals[input] );
+            }
+            aig->triggerLiterals[slot] = trigger;
+        }
+    }
+    arena_rewind( arena, scratch );
+}
+
+/**
+ * The nodes of the And-Inverter Graph that some root literals depend on, renumbered to dense rows:
+ * row 0 is the constant, then come the input nodes and then the AND nodes in node order, so every
+ * row still follows its fan-ins. A row literal is twice the row plus one if complemented. A state
+ * input brings in the cone of its next-state literal.
+ */
+typedef struct AigCone {
+    int *rowOfNode;        ///< Row of each graph node, -1 outside the cone.
+    int *nodes;            ///< Graph node of each row.
+    int ( *fanins )[2];    ///< Fan-in row literals of each AND row.
+    int  inputCount;       ///< Input rows, rows 1 to inputCount.
+    int  stateCount;       ///< Input rows that are state inputs.
+    int  rowCount;
+} AigCone;
+
+static void AigConeFree( AigCone *cone ) {
+    free( cone->rowOfNode );
+    free( cone->nodes );
+    free( cone->fanins );
+}
+
+static int AigConeLiteral( const AigCone *cone, int literal ) { return 2 * cone->rowOfNode[literal >> 1] | ( literal & 1 ); }
+
+/** Collects the cone of rootCount literals; returns false if memory ran out. The caller frees cone. */
+static bool CollectAigCone( const AndInverterGraph *aig, const int *roots, int rootCount, AigCone *cone ) {
+    size_t nodes   = (size_t) aig->nodeCount;
+    int   *stack   = malloc( nodes * sizeof( int ) );
+    int    pending = 0;
+
+    *cone           = (AigCone) { 0 };
+    cone->rowOfNode = malloc( nodes * sizeof( int ) );
+    cone->nodes     = malloc( nodes * sizeof( int ) );
+    cone->fanins    = malloc( nodes * sizeof( *cone->fanins ) );
+    if ( stack == NULL || cone->rowOfNode == NULL || cone->nodes == NULL || cone->fanins == NULL ) {
+        free( stack );
+        return false;
+    }
+
+    for ( int n = 0; n < aig->nodeCount; ++n ) { cone->rowOfNode[n] = -1; }
+    cone->rowOfNode[0] = 0;
+    for ( int r = 0; r < rootCount; ++r ) {
+        int node = roots[r] >> 1;
+        if ( cone->rowOfNode[node] != -1 ) continue;
+        cone->rowOfNode[node] = 0;
+        stack[pending++]      = node;
+    }
+    while ( pending > 0 ) {
+        int node  = stack[--pending];
+        int slot  = aig->nodeSlots[node];
+        int links = 2;
+        int next[2];
+        if ( slot >= 0 ) {
+            links = 0;
+            if ( aig->nextLiterals[slot] != -1 ) next[links++] = aig->nextLiterals[slot] >> 1;
+        } else {
+            next[0] = aig->fanins[node][0] >> 1;
+            next[1] = aig->fanins[node][1] >> 1;
+        }
+        for ( int i = 0; i < links; ++i ) {
+            if ( cone->rowOfNode[next[i]] != -1 ) continue;
+            cone->rowOfNode[next[i]] = 0;
+            stack[pending++]         = next[i];
+        }
+    }
+    free( stack );
+
+    cone->nodes[0] = 0;
+    cone->rowCount = 1;
+    for ( int pass = 0; pass < 2; ++pass ) {
+        for ( int n = 1; n < aig->nodeCount; ++n ) {
+            if ( cone->rowOfNode[n] == -1 || ( aig->nodeSlots[n] >= 0 ) != ( pass == 0 ) ) continue;
+            int row              = cone->rowCount++;
+            cone->rowOfNode[n]   = row;
+            cone->nodes[row]     = n;
+            cone->fanins[row][0] = -1;
+            cone->fanins[row][1] = -1;
+            if ( pass == 0 ) {
+                cone->inputCount++;
+                cone->stateCount += aig->nextLiterals[aig->nodeSlots[n]] != -1;
+            } else {
+                cone->fanins[row][0] = AigConeLiteral( cone, aig->fanins[n][0] );
+                cone->fanins[row][1] = AigConeLiteral( cone, aig->fanins[n][1] );
+            }
+        }
+    }
+    return true;
+}
+
+static void CompileEvaluationPlan( SimulatorState *simulatorState ) {
+    EvaluationPlan *plan  = &simulatorState->evaluationPlan;
+    int             count = simulatorState->elementCount;
+
+    // Sizes are rounded up to powers of two so that recompiling a similar canvas replays the
+    // same allocations and reuses the regions the arena already holds.
+    int capacity = ELEMENT_STORE_MIN_CAPACITY;
+    while ( capacity < count ) { capacity *= 2; }
+    size_t slots = (size_t) capacity;
+
+    Arena *arena = &plan->arena;
+    arena_reset( arena );
+    plan->order           = arena_alloc( arena, slots * sizeof( int ) );
+    plan->componentStart  = arena_alloc( arena, ( slots + 1 ) * sizeof( int ) );
+    plan->componentCyclic = arena_alloc( arena, slots * sizeof( bool ) );
+    plan->inputSlots      = arena_alloc( arena, slots * sizeof( *plan->inputSlots ) );
+    plan->componentOf     = arena_alloc( arena, slots * sizeof( int ) );
+    plan->faninStart      = arena_alloc( arena, ( slots + 1 ) * sizeof( int ) );
+    plan->fanoutStart     = arena_alloc( arena, ( slots + 1 ) * sizeof( int ) );
+    plan->worklist        = arena_alloc( arena, slots * sizeof( int ) );
+    plan->componentQueued = arena_alloc( arena, slots * sizeof( bool ) );
+    plan->phaseStart      = arena_alloc( arena, ( slots + 1 ) * sizeof( int ) );
+    plan->phaseParallel   = arena_alloc( arena, slots * sizeof( bool ) );
+    plan->componentPeriod    = arena_alloc( arena, slots * sizeof( int ) );
+    plan->componentInputHash = arena_alloc( arena, slots * sizeof( uint64_t ) );
+    plan->sweepOutputBits    = arena_alloc( arena, ELEMENT_BIT_WORDS( slots ) * sizeof( uint64_t ) );
+    plan->sliceRows          = arena_alloc( arena, slots * sizeof( int ) );
+    plan->sliceQueue         = arena_alloc( arena, slots * sizeof( int ) );
+
+    // Both adjacency directions are built from the connection list: one pass resolves each
+    // connection and counts degrees, prefix sums give the offsets, and a second pass in slot
+    // order fills the neighbor arrays, so fan-in lists come out ordered by input pin.
+    const ElementStore *store = &simulatorState->elements;
+    for ( int i = 0; i < count; ++i ) {
+        for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) { plan->inputSlots[i][k] = -1; }
+        plan->sliceRows[i] = -1;
+    }
+    for ( int i = 0; i <= count; ++i ) {
+        plan->faninStart[i]  = 0;
+        plan->fanoutStart[i] = 0;
+    }
+    for ( int c = 0; c < simulatorState->connectionCount; ++c ) {
+        const Connection *connection = &simulatorState->connections[c];
+        if ( !connection->isActive ) continue;
+        int fromSlot = Server_FindElementSlot( simulatorState, connection->fromElementId );
+        int toSlot   = Server_FindElementSlot( simulatorState, connection->toElementId );
+        if ( fromSlot < 0 || toSlot < 0 ) continue;
+        plan->inputSlots[toSlot][connection->toInputSlot] = fromSlot;
+        plan->faninStart[toSlot + 1]++;
+        plan->fanoutStart[fromSlot + 1]++;
+    }
+    for ( int i = 0; i < count; ++i ) {
+        plan->faninStart[i + 1]  += plan->faninStart[i];
+        plan->fanoutStart[i + 1] += plan->fanoutStart[i];
+    }
+
+    size_t edges = slots;
+    while ( edges < (size_t) plan->fanoutStart[count] ) { edges *= 2; }
+    plan->faninSources  = arena_alloc( arena, edges * sizeof( int ) );
+    plan->fanoutTargets = arena_alloc( arena, edges * sizeof( int ) );
+
+    Arena_Mark scratch = arena_snapshot( arena );
+    int       *fill    = arena_alloc( arena, slots * sizeof( int ) );
+    int        fanin   = 0;
+    for ( int i = 0; i < count; ++i ) { fill[i] = plan->fanoutStart[i]; }
+    for ( int i = 0; i < count; ++i ) {
+        for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) {
+            int source = plan->inputSlots[i][k];
+            if ( source < 0 ) continue;
+            plan->faninSources[fanin++]         = source;
+            plan->fanoutTargets[fill[source]++] = i;
+        }
+    }
+    arena_rewind( arena, scratch );
+
+    int  *visitIndex  = arena_alloc( arena, slots * sizeof( int ) );
+    int  *lowLink     = arena_alloc( arena, slots * sizeof( int ) );
+    bool *onStack     = arena_alloc( arena, slots * sizeof( bool ) );
+    int  *tarjanStack = arena_alloc( arena, slots * sizeof( int ) );
+    int  *callNode    = arena_alloc( arena, slots * sizeof( int ) );
+    int  *callEdge    = arena_alloc( arena, slots * sizeof( int ) );
+
+    for ( int i = 0; i < count; ++i ) {
+        visitIndex[i] = -1;
+        onStack[i]    = false;
+    }
+
+    int nextIndex         = 0;
+    int stackTop          = 0;
+    int orderCount        = 0;
+    plan->componentCount  = 0;
+
+    for ( int root = 0; root < count; ++root ) {
+        if ( !TestElementBit( store->activeBits, root ) || visitIndex[root] != -1 ) continue;
+
+        int callTop            = 0;
+        callNode[0]            = root;
+        callEdge[0]            = plan->faninStart[root];
+        visitIndex[root]       = nextIndex;
+        lowLink[root]          = nextIndex++;
+        tarjanStack[stackTop++] = root;
+        onStack[root]          = true;
+
+        while ( callTop >= 0 ) {
+            int node = callNode[callTop];
+
+            if ( callEdge[callTop] < plan->faninStart[node + 1] ) {
+                int next = plan->faninSources[callEdge[callTop]++];
+                if ( visitIndex[next] == -1 ) {
+                    visitIndex[next]        = nextIndex;
+                    lowLink[next]           = nextIndex++;
+                    tarjanStack[stackTop++] = next;
+                    onStack[next]           = true;
+                    callTop++;
+                    callNode[callTop] = next;
+                    callEdge[callTop] = plan->faninStart[next];
+                } else if ( onStack[next] && visitIndex[next] < lowLink[node] ) {
+                    lowLink[node] = visitIndex[next];
+                }
+                continue;
+            }
+
+            if ( lowLink[node] == visitIndex[node] ) {
+                int  start  = orderCount;
+                int  member = -1;
+                do {
+                    member                     = tarjanStack[--stackTop];
+                    onStack[member]            = false;
+                    plan->order[orderCount++]  = member;
+                } while ( member != node );
+
+                bool cyclic = ( orderCount - start ) > 1;
+                for ( int f = plan->faninStart[node]; f < plan->faninStart[node + 1] && !cyclic; ++f ) {
+                    if ( plan->faninSources[f] == node ) cyclic = true;
+                }
+                plan->componentStart[plan->componentCount]  = start;
+                plan->componentCyclic[plan->componentCount] = cyclic;
+                plan->componentCount++;
+            }
+
+            callTop--;
+            if ( callTop >= 0 && lowLink[node] < lowLink[callNode[callTop]] ) {
+                lowLink[callNode[callTop]] = lowLink[node];
+            }
+        }
+    }
+
+    plan->componentStart[plan->componentCount] = orderCount;
+    arena_rewind( arena, scratch );
+
+    OrderComponentsByLevel( plan, slots );
+    ReduceNetlist( simulatorState, slots );
+    FindLutCones( simulatorState, slots );
+    ListSimulatedSlots( plan );
+    BuildAndInverterGraph( simulatorState, slots );
+
+    for ( int c = 0; c < plan->componentCount; ++c ) {
+        plan->worklist[c]        = c;
+        plan->componentQueued[c] = true;
+        plan->componentPeriod[c] = 0;
+    }
+    if ( count > 0 ) memset( simulatorState->elements.oscillationPeriods, 0, (size_t) count );
+    plan->worklistCount = plan->componentCount;
+
+    plan->compiledElementCount                 = simulatorState->elementCount;
+    plan->compiledConnectionCount              = simulatorState->connectionCount;
+    plan->generation++;
+    CompileSignalProgram( simulatorState, slots );
+    plan->isValid                              = true;
+    simulatorState->capability.isValid         = false;
+    simulatorState->stateWitness.isValid       = false;
+    simulatorState->coneSliceCount             = 0;
+    MarkTopologyConditionsDirty( &simulatorState->currentScenario );
+}
+
+static inline uint32_t SampleSignalInputs( ElementStore *store, const int32_t *instruction ) {
+    uint32_t header = (uint32_t) instruction[0];
+    int      dst    = instruction[1];
+    uint32_t high   = 0;
+
+    for ( uint32_t i = 0; i < SIGNAL_COUNT( header ); ++i ) {
+        uint32_t operand = (uint32_t) instruction[2 + i];
+        high            |= (uint32_t) TestElementBit( store->outputBits, (int) ( operand >> 3 ) ) << ( operand & 7 );
+    }
+    store->inputStateBits[dst] = (uint8_t) ( ( store->inputStateBits[dst] & ~SIGNAL_CONNECTED( header ) ) | high );
+    return high;
+}
+
+/**
+ * Executes the signal bytecode in [pc, end). Returns true if any output changed; with
+ * scheduleFanout, consumers outside the component are queued as outputs change. If stateHash
+ * is not NULL, the key of every output that flips is XORed into it.
+ */
+static bool RunSignalCode(
+  SimulatorState *simulatorState, int pc, int end, int component, bool scheduleFanout, uint64_t *stateHash
+) {
+    ElementStore  *store   = &simulatorState->elements;
+    const int32_t *code    = simulatorState->evaluationPlan.code;
+    bool           changed = false;
+    bool           next    = false;
+    int            dst     = 0;
+
+#if SIGNAL_VM_THREADED
+    static const void *const handlers[SIGNAL_OP_COUNT] = {
+        &&op_set, &&op_clear, &&op_and, &&op_or, &&op_nor, &&op_lut,
+    };
+  #define SIGNAL_DISPATCH()            goto *handlers[SIGNAL_OPCODE( code[pc] )]
+  #define SIGNAL_HANDLER( op, label ) label
+#else
+  #define SIGNAL_DISPATCH()            goto dispatch
+  #define SIGNAL_HANDLER( op, label ) case op
+#endif
+
+    if ( pc >= end ) return false;
+    SIGNAL_DISPATCH();
+
+#if !SIGNAL_VM_THREADED
+dispatch:
+    switch ( SIGNAL_OPCODE( code[pc] ) ) {
+        default:
+#endif
+    SIGNAL_HANDLER( SIGNAL_OP_SET, op_set ):
+        SampleSignalInputs( store, code + pc );
+        next = true;
+        goto commit;
+
+    SIGNAL_HANDLER( SIGNAL_OP_CLEAR, op_clear ):
+        SampleSignalInputs( store, code + pc );
+        next = false;
+        goto commit;
+
+    SIGNAL_HANDLER( SIGNAL_OP_AND, op_and ):
+        next = SampleSignalInputs( store, code + pc ) == SIGNAL_REQUIRED( code[pc] );
+        goto commit;
+
+    SIGNAL_HANDLER( SIGNAL_OP_OR, op_or ):
+        next = SampleSignalInputs( store, code + pc ) != 0;
+        goto commit;
+
+    SIGNAL_HANDLER( SIGNAL_OP_NOR, op_nor ):
+        next = SampleSignalInputs( store, code + pc ) == 0;
+        goto commit;
+
+    SIGNAL_HANDLER( SIGNAL_OP_LUT, op_lut ):
+        next = ( (uint32_t) code[pc + 2 + SIGNAL_COUNT( code[pc] )] >> SampleSignalInputs( store, code + pc ) ) & 1;
+        goto commit;
+#if !SIGNAL_VM_THREADED
+    }
+#endif
+
+commit:
+    dst  = code[pc + 1];
+    pc  += SIGNAL_LENGTH( code[pc] );
+    {
+        // Branch-free write: whether an output flips is data dependent and predicts poorly.
+        uint64_t *word   = &store->outputBits[dst >> 6];
+        uint64_t  before = *word;
+        uint64_t  after  = ( before & ~( (uint64_t) 1 << ( dst & 63 ) ) ) | ( (uint64_t) next << ( dst & 63 ) );
+        *word            = after;
+        changed         |= before != after;
+        if ( before != after ) {
+            uint64_t key               = SignalSlotKey( dst );
+            simulatorState->stateHash ^= key;
+            if ( stateHash != NULL ) *stateHash ^= key;
+            if ( scheduleFanout ) ScheduleFanout( simulatorState, dst, component );
+        }
+    }
+    if ( pc >= end ) return changed;
+    SIGNAL_DISPATCH();
+
+#undef SIGNAL_DISPATCH
+#undef SIGNAL_HANDLER
+}
+
+static void PushComponent( EvaluationPlan *plan, int component ) {
+    if ( plan->componentQueued[component] ) return;
+    plan->componentQueued[component] = true;
+
+    int child = plan->worklistCount++;
+    while ( child > 0 ) {
+        int parent = ( child - 1 ) / 2;
+        if ( plan->worklist[parent] <= component ) break;
+        plan->worklist[child] = plan->worklist[parent];
+        child                 = parent;
+    }
+    plan->worklist[child] = component;
+}
+
+static int PopComponent( EvaluationPlan *plan ) {
+    int top = plan->worklist[0];
+    int last = plan->worklist[--plan->worklistCount];
+    int parent = 0;
+
+    for ( ;; ) {
+        int child = parent * 2 + 1;
+        if ( child >= plan->worklistCount ) break;
+        if ( child + 1 < plan->worklistCount && plan->worklist[child + 1] < plan->worklist[child] ) child++;
+        if ( last <= plan->worklist[child] ) break;
+        plan->worklist[parent] = plan->worklist[child];
+        parent                 = child;
+    }
+    if ( plan->worklistCount > 0 ) plan->worklist[parent] = last;
+
+    plan->componentQueued[top] = false;
+    return top;
+}
+
+static void ScheduleFanout( SimulatorState *simulatorState, int slot, int currentComponent ) {
+    EvaluationPlan *plan = &simulatorState->evaluationPlan;
+    if ( !plan->isValid || slot >= plan->compiledElementCount ) return;
+
+    for ( int f = plan->fanoutStart[slot]; f < plan->fanoutStart[slot + 1]; ++f ) {
+        int component = plan->componentOf[plan->fanoutTargets[f]];
+        if ( component != currentComponent ) PushComponent( plan, component );
+    }
+}
+
+#if PARALLEL_PROPAGATION_AVAILABLE
+static bool RunSharedSignalCode( SimulatorState *simulatorState, int pc, int end, uint64_t *stateHash );
+#endif
+
+/** Reads an output bit; with shared, other threads may be writing the same word. */
+static inline bool ReadOutputBit( const ElementStore *store, int slot, bool shared ) {
+#if PARALLEL_PROPAGATION_AVAILABLE
+    if ( shared ) return ( __atomic_load_n( &store->outputBits[slot >> 6], __ATOMIC_RELAXED ) >> ( slot & 63 ) ) & 1;
+#else
+    (void) shared;
+#endif
+    return TestElementBit( store->outputBits, slot );
+}
+
+static bool RunComponentPass( SimulatorState *simulatorState, int component, bool scheduleFanout, bool shared,
+                              uint64_t *stateHash ) {
+    const EvaluationPlan *plan = &simulatorState->evaluationPlan;
+    int                   pc   = plan->componentCode[component];
+    int                   end  = plan->componentCode[component + 1];
+
+#if PARALLEL_PROPAGATION_AVAILABLE
+    if ( shared ) return RunSharedSignalCode( simulatorState, pc, end, stateHash );
+#endif
+    return RunSignalCode( simulatorState, pc, end, component, scheduleFanout, stateHash );
+}
+
+/** Hash of the high outputs feeding a component from outside it. */
+static uint64_t ComponentInputHash( const SimulatorState *simulatorState, int component, bool shared ) {
+    const EvaluationPlan *plan = &simulatorState->evaluationPlan;
+    uint64_t              hash = 0;
+
+    for ( int j = plan->componentStart[component]; j < plan->componentStart[component + 1]; ++j ) {
+        int member = plan->order[j];
+        for ( int f = plan->faninStart[member]; f < plan->faninStart[member + 1]; ++f ) {
+            int source = plan->faninSources[f];
+            if ( plan->componentOf[source] != component && ReadOutputBit( &simulatorState->elements, source, shared ) ) {
+                hash ^= SignalSlotKey( source );
+            }
+        }
+    }
+    return hash;
+}
+
+static void ClearComponentOscillation( SimulatorState *simulatorState, int component ) {
+    EvaluationPlan *plan = &simulatorState->evaluationPlan;
+
+    plan->componentPeriod[component] = 0;
+    for ( int j = plan->componentStart[component]; j < plan->componentStart[component + 1]; ++j ) {
+        simulatorState->elements.oscillationPeriods[plan->order[j]] = 0;
+    }
+}
+
+/**
+ * Runs `passes` more passes over an oscillating component, which must end where they started,
+ * and records the period on every member whose output changed along the way.
+ */
+static void MarkComponentOscillation(
+  SimulatorState *simulatorState, int component, int period, int passes, bool scheduleFanout, bool shared
+) {
+    EvaluationPlan *plan    = &simulatorState->evaluationPlan;
+    ElementStore   *store   = &simulatorState->elements;
+    int             first   = plan->componentStart[component];
+    int             members = plan->componentStart[component + 1] - first;
+    bool           *initial = malloc( (size_t) members * sizeof( bool ) );
+    uint8_t         value   = (uint8_t) ( period > 255 ? 255 : period );
+
+    if ( initial == NULL ) {
+        for ( int j = 0; j < members; ++j ) { store->oscillationPeriods[plan->order[first + j]] = value; }
+        return;
+    }
+    for ( int j = 0; j < members; ++j ) {
+        int slot                        = plan->order[first + j];
+        initial[j]                      = ReadOutputBit( store, slot, shared );
+        store->oscillationPeriods[slot] = 0;
+    }
+    for ( int pass = 0; pass < passes; ++pass ) {
+        RunComponentPass( simulatorState, component, scheduleFanout, shared, NULL );
+        for ( int j = 0; j < members; ++j ) {
+            int slot = plan->order[first + j];
+            if ( ReadOutputBit( store, slot, shared ) != initial[j] ) store->oscillationPeriods[slot] = value;
+        }
+    }
+    free( initial );
+}
+
+/**
+ * Settles one component. A feedback loop is iterated until it stops changing; a loop that keeps
+ * changing is checked for a repeated output state, which is an oscillation, and its period is
+ * recorded. While its outside inputs stay the same, an oscillating loop advances one pass per
+ * evaluation.
+ */
+static void SettleComponent( SimulatorState *simulatorState, int component, bool scheduleFanout, bool shared ) {
+    EvaluationPlan *plan = &simulatorState->evaluationPlan;
+
+    if ( !plan->componentCyclic[component] ) {
+        RunComponentPass( simulatorState, component, scheduleFanout, shared, NULL );
+        return;
+    }
+
+    int      knownPeriod = plan->componentPeriod[component];
+    uint64_t inputHash   = ComponentInputHash( simulatorState, component, shared );
+
+    if ( knownPeriod != 0 && plan->componentInputHash[component] == inputHash ) {
+        if ( !RunComponentPass( simulatorState, component, scheduleFanout, shared, NULL ) ) {
+            ClearComponentOscillation( simulatorState, component );
+        }
+        return;
+    }
+
+    // Hashes are relative to the state on entry: the key of every flipped output is XORed in.
+    uint64_t history[MAX_FEEDBACK_ITERATIONS + OSCILLATION_MAX_ITERATIONS + 1];
+    uint64_t stateHash = 0;
+    int      period    = OSCILLATION_PERIOD_UNKNOWN;
+
+    history[0] = 0;
+    for ( int iteration = 1; iteration <= MAX_FEEDBACK_ITERATIONS + OSCILLATION_MAX_ITERATIONS; ++iteration ) {
+        if ( !RunComponentPass( simulatorState, component, scheduleFanout, shared, &stateHash ) ) {
+            if ( knownPeriod != 0 ) ClearComponentOscillation( simulatorState, component );
+            return;
+        }
+        for ( int previous = iteration - 1; previous >= 0 && period == OSCILLATION_PERIOD_UNKNOWN; --previous ) {
+            if ( history[previous] == stateHash ) period = iteration - previous;
+        }
+        if ( period != OSCILLATION_PERIOD_UNKNOWN ) break;
+        history[iteration] = stateHash;
+    }
+
+    MarkComponentOscillation( simulatorState, component, period,
+                              period == OSCILLATION_PERIOD_UNKNOWN ? 1 : period, scheduleFanout, shared );
+    plan->componentPeriod[component]    = period;
+    plan->componentInputHash[component] = inputHash;
+    if ( knownPeriod == 0 ) {
+        TraceLog(
+          LOG_WARNING, "SERVER: Feedback loop of %d elements oscillates (period %d)",
+          plan->componentStart[component + 1] - plan->componentStart[component], period
+        );
+    }
+}
+
+static void EvaluateComponent( SimulatorState *simulatorState, int component, bool scheduleFanout ) {
+    SettleComponent( simulatorState, component, scheduleFanout, false );
+}
+
+static void EnsureEvaluationPlan( SimulatorState *simulatorState ) {
+    EvaluationPlan *plan = &simulatorState->evaluationPlan;
+
+    if ( !plan->isValid || plan->compiledElementCount != simulatorState->elementCount ||
+         plan->compiledConnectionCount != simulatorState->connectionCount ) {
+        CompileEvaluationPlan( simulatorState );
+    }
+}
+
+int Server_GetFanin( SimulatorState *simulatorState, int slot, const int **sources ) {
+    if ( simulatorState == NULL || sources == NULL || slot < 0 || slot >= simulatorState->elementCount ) return -1;
+
+    EnsureEvaluationPlan( simulatorState );
+    const EvaluationPlan *plan = &simulatorState->evaluationPlan;
+    *sources = plan->faninSources + plan->faninStart[slot];
+    return plan->faninStart[slot + 1] - plan->faninStart[slot];
+}
+
+int Server_GetFanout( SimulatorState *simulatorState, int slot, const int **targets ) {
+    if ( simulatorState == NULL || targets == NULL || slot < 0 || slot >= simulatorState->elementCount ) return -1;
+
+    EnsureEvaluationPlan( simulatorState );
+    const EvaluationPlan *plan = &simulatorState->evaluationPlan;
+    *targets = plan->fanoutTargets + plan->fanoutStart[slot];
+    return plan->fanoutStart[slot + 1] - plan->fanoutStart[slot];
+}
+
+/**
+ * Resolves a selection and computes its module table into module. localOf must hold -1 for every
+ * slot of the canvas; the other arrays have room for one entry per selected element. Returns NULL
+ * on success or the reason the selection cannot form a module.
+ */
+static const char *CompileModuleTable(
+  const SimulatorState *simulatorState, const int *elementIds, int elementCount, int outputElementId, int *slots,
+  int *localOf, int *pending, uint64_t *values, ModuleDefinition *module
+) {
+    const EvaluationPlan *plan  = &simulatorState->evaluationPlan;
+    const ElementStore   *store = &simulatorState->elements;
+
+    for ( int j = 0; j < elementCount; ++j ) {
+        slots[j] = Server_FindElementSlot( simulatorState, elementIds[j] );
+        if ( slots[j] == -1 || localOf[slots[j]] != -1 ) return "selection has a missing or repeated element";
+        localOf[slots[j]] = j;
+    }
+    int outputSlot = Server_FindElementSlot( simulatorState, outputElementId );
+    if ( outputSlot == -1 || localOf[outputSlot] == -1 ) return "output element is not in the selection";
+
+    // Switches and buttons become pins; everything else waits for its inputs (Kahn's algorithm
+    // over the fan-out rows), so an element on a feedback loop is never reached.
+    int pins = 0;
+    for ( int j = 0; j < elementCount; ++j ) {
+        uint8_t type = store->types[slots[j]];
+        pending[j]   = 0;
+        if ( type == ELEMENT_SWITCH || type == ELEMENT_BUTTON ) {
+            if ( pins == MAX_INPUTS_PER_LOGIC_GATE ) return "more switches and buttons than an element has inputs";
+            values[j]  = originLanePatterns[pins];
+            pending[j] = -1;
+            pins++;
+            continue;
+        }
+        for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) {
+            int source = plan->inputSlots[slots[j]][k];
+            if ( source < 0 ) continue;
+            if ( localOf[source] == -1 ) return "an input comes from outside the selection";
+            pending[j]++;
+        }
+    }
+
+    // The queue reuses slots: entry n is only overwritten after element n has been queued.
+    int *queue  = slots;
+    int  queued = 0;
+    for ( int j = 0; j < elementCount; ++j ) {
+        if ( pending[j] <= 0 ) queue[queued++] = slots[j];
+    }
+    for ( int head = 0; head < queued; ++head ) {
+        int slot = queue[head];
+        int j    = localOf[slot];
+        if ( pending[j] == 0 ) {
+            values[j] = EvaluateTableElement( simulatorState, slot, plan->inputSlots[slot], localOf, values, slot == outputSlot );
+        }
+        for ( int f = plan->fanoutStart[slot]; f < plan->fanoutStart[slot + 1]; ++f ) {
+            int target = localOf[plan->fanoutTargets[f]];
+            if ( target != -1 && pending[target] > 0 && --pending[target] == 0 ) queue[queued++] = plan->fanoutTargets[f];
+        }
+    }
+    if ( queued < elementCount ) return "the selection contains a feedback loop";
+
+    module->inputCount   = pins;
+    module->elementCount = elementCount;
+    module->truthTable   = (uint32_t) values[localOf[outputSlot]];
+    return NULL;
+}
+
+int Server_DefineModule(
+  SimulatorState *simulatorState, const char *name, const int *elementIds, int elementCount, int outputElementId
+) {
+    if ( simulatorState == NULL || name == NULL || elementIds == NULL || elementCount <= 0 ) return -1;
+    if ( simulatorState->moduleCount >= MAX_MODULE_DEFINITIONS ) {
+        TraceLog( LOG_WARNING, "SERVER: Cannot define module, %d definitions already exist.", MAX_MODULE_DEFINITIONS );
+        return -1;
+    }
+
+    EnsureEvaluationPlan( simulatorState );
+    int       canvas  = simulatorState->elementCount > 0 ? simulatorState->elementCount : 1;
+    int      *slots   = malloc( (size_t) elementCount * sizeof( int ) );
+    int      *pending = malloc( (size_t) elementCount * sizeof( int ) );
+    uint64_t *values  = malloc( (size_t) elementCount * sizeof( uint64_t ) );
+    int      *localOf = malloc( (size_t) canvas * sizeof( int ) );
+
+    ModuleDefinition module = { 0 };
+    const char      *error  = "out of memory";
+    if ( slots != NULL && pending != NULL && values != NULL && localOf != NULL ) {
+        for ( int i = 0; i < canvas; ++i ) { localOf[i] = -1; }
+        error = CompileModuleTable(
+          simulatorState, elementIds, elementCount, outputElementId, slots, localOf, pending, values, &module
+        );
+    }
+    free( slots );
+    free( pending );
+    free( values );
+    free( localOf );
+
+    if ( error != NULL ) {
+        TraceLog( LOG_WARNING, "SERVER: Cannot define module '%s': %s.", name, error );
+        return -1;
+    }
+
+    strncpy( module.name, name, sizeof( module.name ) - 1 );
+    module.name[sizeof( module.name ) - 1] = '\0';
+    int index                              = simulatorState->moduleCount++;
+    simulatorState->modules[index]         = module;
+    simulatorState->changeGeneration++;
+    TraceLog(
+      LOG_INFO, "SERVER: Defined module %d '%s' from %d elements, %d inputs, table 0x%08X", index, module.name,
+      elementCount, module.inputCount, module.truthTable
+    );
+    return index;
+}
+
+int Server_GetLutCone( SimulatorState *simulatorState, int slot, const int **leaves, uint64_t *table ) {
+    if ( simulatorState == NULL || leaves == NULL || table == NULL || slot < 0 || slot >= simulatorState->elementCount ) {
+        return -1;
+    }
+
+    EnsureEvaluationPlan( simulatorState );
+    const EvaluationPlan *plan = &simulatorState->evaluationPlan;
+    if ( plan->coneRoot[slot] != slot ) return -1;
+    *leaves = plan->coneLeaves[slot];
+    *table  = plan->coneTables[slot];
+    return plan->coneLeafCounts[slot];
+}
+
+int Server_GetSlotReduction( SimulatorState *simulatorState, int slot ) {
+    if ( simulatorState == NULL || slot < 0 || slot >= simulatorState->elementCount ) return -1;
+
+    EnsureEvaluationPlan( simulatorState );
+    return simulatorState->evaluationPlan.slotReductions[slot];
+}
+
+const AndInverterGraph *Server_GetAndInverterGraph( SimulatorState *simulatorState ) {
+    if ( simulatorState == NULL ) return NULL;
+
+    EnsureEvaluationPlan( simulatorState );
+    return &simulatorState->evaluationPlan.aig;
+}
+
+typedef void ( *NativeKernelFunction )( uint64_t *outputBits, uint8_t *inputStateBits );
+
+#if NATIVE_ENGINE_AVAILABLE
+
+typedef enum NativeKernelStatus {
+    NATIVE_KERNEL_WAITING = 0,  ///< The topology changed too recently; no build has started.
+    NATIVE_KERNEL_BUILDING,     ///< The build thread is compiling.
+    NATIVE_KERNEL_READY,        ///< function is loaded and matches generation.
+    NATIVE_KERNEL_FAILED,       ///< The compiler or dlopen failed for generation.
+} NativeKernelStatus;
+
+/**
+ * Evaluation kernel generated as C for one plan generation. Once the topology has stayed unchanged
+ * for NATIVE_ENGINE_QUIET_MS, the plan is written out as a few source files and a build thread
+ * compiles them as child processes, several at a time, links the objects into a shared object
+ * and loads it with dlopen. Every build file lives in a directory that mkdtemp made private to
+ * this process, and the thread removes it when it finishes. Each compiler leads its own process
+ * group, so abandoning the kernel kills it together with the passes it started; the thread leaves
+ * it unreaped until its slot in compilers is cleared under lock, so the pid cannot be reused while
+ * it may still be signalled. status is shared with the thread; the other fields are written
+ * before the thread starts or read once status leaves BUILDING.
+ */
+struct NativeKernel {
+    atomic_int           status;
+    bool                 reported;
+    unsigned int         generation;
+    struct timespec      requestedAt;    ///< When generation was first seen.
+    pthread_mutex_t      lock;           ///< Guards cancelled and compilers.
+    bool                 cancelled;      ///< Set when abandoned; no compiler is started after.
+    pid_t                compilers[NATIVE_KERNEL_MAX_JOBS];    ///< Process groups of the running
+                                                               ///< compilers, 0 for a free slot.
+    pthread_t            thread;
+    bool                 threadStarted;
+    int                  unitCount;      ///< Source files u0.c, u1.c, ... written besides entry.c.
+    char                 directory[240];
+    void                *library;
+    NativeKernelFunction function;
+};
+
+/** Emits one instruction of signal bytecode as C; cyclic components also track changes in c. */
+static int EmitNativeInstruction( FILE *file, const int32_t *instruction, bool cyclic ) {
+    uint32_t header = (uint32_t) instruction[0];
+    int      dst    = instruction[1];
+    uint32_t count  = SIGNAL_COUNT( header );
+    uint32_t op     = SIGNAL_OPCODE( header );
+    char     value[32];
+
+    if ( count != 0 || ( op != SIGNAL_OP_SET && op != SIGNAL_OP_CLEAR ) ) {
+        fputs( "h=0", file );
+        for ( uint32_t i = 0; i < count; ++i ) {
+            uint32_t operand = (uint32_t) instruction[2 + i];
+            fprintf( file, "|v[%u]<<%u", operand >> 3, operand & 7 );
+        }
+        fprintf( file, ";s[%d]=(uint8_t)((s[%d]&%uu)|h);", dst, dst, ~SIGNAL_CONNECTED( header ) & 0xFF );
+    }
+    if ( op == SIGNAL_OP_SET || op == SIGNAL_OP_CLEAR ) {
+        snprintf( value, sizeof( value ), "%d", op == SIGNAL_OP_SET );
+    } else {
+        if ( op == SIGNAL_OP_AND ) snprintf( value, sizeof( value ), "h==%uu", SIGNAL_REQUIRED( header ) );
+        else if ( op == SIGNAL_OP_LUT ) snprintf( value, sizeof( value ), "%uu>>h&1u", (uint32_t) instruction[2 + count] );
+        else snprintf( value, sizeof( value ), op == SIGNAL_OP_OR ? "h!=0" : "h==0" );
+    }
+
+    int written = cyclic ? fprintf( file, "n=%s;c|=n^v[%d];v[%d]=n;\n", value, dst, dst )
+                         : fprintf( file, "v[%d]=%s;\n", dst, value );
+    return written < 0 ? -1 : SIGNAL_LENGTH( header );
+}
+
+/** Creates name in a kernel build directory. It must not exist yet: nothing but this process may have put it there. */
+static FILE *CreateNativeKernelFile( const char *directory, const char *name ) {
+    char path[512];
+    snprintf( path, sizeof( path ), "%s/%s", directory, name );
+    int   descriptor = open( path, O_WRONLY | O_CREAT | O_EXCL, 0600 );
+    FILE *file       = descriptor >= 0 ? fdopen( descriptor, "w" ) : NULL;
+    if ( file == NULL && descriptor >= 0 ) close( descriptor );
+    return file;
+}
+
+/** Closes a generated source file; false if anything written to it was lost. */
+static bool CloseNativeKernelFile( FILE *file ) {
+    bool ok = !ferror( file );
+    return fclose( file ) == 0 && ok;
+}
+
+#define NATIVE_KERNEL_PRELUDE "#include <stdint.h>\n#define H __attribute__((visibility(\"hidden\")))\n"
+
+/**
+ * Writes the plan as C source files into directory. Outputs are unpacked to one byte per element
+ * on entry and packed back on exit, so every gate is a single straight-line statement the compiler
+ * gets through quickly. Statements are split into functions of about NATIVE_KERNEL_CHUNK, and
+ * every NATIVE_KERNEL_UNIT_CHUNKS functions go to a file of their own, u0.c, u1.c, ..., so they
+ * compile in parallel. A feedback loop spans as many functions as it needs, each returning whether
+ * it changed anything, and the entry point in entry.c wraps those calls in a bounded settle loop.
+ */
+static bool EmitNativeKernel( const EvaluationPlan *plan, const char *directory, int *unitCount ) {
+    // Entry point body, built alongside the chunks and written out once they are all known.
+    FILE *entry = tmpfile();
+    if ( entry == NULL ) return false;
+
+    FILE *unit      = NULL;
+    char  name[32];
+    bool  ok        = true;
+    int   units     = 0;
+    int   chunks    = 0;
+    int   emitted   = 0;
+    bool  chunkOpen = false;
+    for ( int c = 0; c < plan->componentCount && ok; ++c ) {
+        int  pc     = plan->componentCode[c];
+        int  end    = plan->componentCode[c + 1];
+        bool cyclic = plan->componentCyclic[c];
+        if ( pc == end ) continue;
+
+        // A feedback loop starts in a fresh chunk so the settle loop can re-run exactly its chunks.
+        if ( cyclic && chunkOpen ) {
+            fputs( "return 0;}\n", unit );
+            chunkOpen = false;
+        }
+        if ( cyclic ) fprintf( entry, "for(int it=0;it<%d;++it){uint64_t c=0;\n", MAX_FEEDBACK_ITERATIONS );
+
+        while ( pc < end && ok ) {
+            if ( !chunkOpen ) {
+                if ( chunks % NATIVE_KERNEL_UNIT_CHUNKS == 0 ) {
+                    if ( unit != NULL ) ok = CloseNativeKernelFile( unit );
+                    snprintf( name, sizeof( name ), "u%d.c", units++ );
+                    unit = ok ? CreateNativeKernelFile( directory, name ) : NULL;
+                    if ( unit == NULL ) {
+                        ok = false;
+                        break;
+                    }
+                    fputs( NATIVE_KERNEL_PRELUDE "extern H uint8_t v[];\n", unit );
+                }
+                fprintf( unit, "H uint64_t k%d(uint8_t*s){unsigned h,n;uint64_t c=0;(void)h;(void)n;\n", chunks );
+                fprintf( entry, cyclic ? "c|=k%d(s);\n" : "k%d(s);\n", chunks );
+                chunks++;
+                chunkOpen = true;
+                emitted   = 0;
+            }
+            int length = EmitNativeInstruction( unit, plan->code + pc, cyclic );
+            ok         = length > 0;
+            pc        += length;
+            if ( ++emitted >= NATIVE_KERNEL_CHUNK || ( cyclic && pc >= end ) ) {
+                fputs( "return c;}\n", unit );
+                chunkOpen = false;
+            }
+        }
+        if ( cyclic ) fputs( "if(!c)break;}\n", entry );
+    }
+    if ( unit != NULL ) {
+        if ( chunkOpen ) fputs( "return c;}\n", unit );
+        ok = CloseNativeKernelFile( unit ) && ok;
+    }
+    *unitCount = units;
+
+    int   slots = plan->compiledElementCount;
+    FILE *file  = ok ? CreateNativeKernelFile( directory, "entry.c" ) : NULL;
+    if ( file != NULL ) {
+        fprintf( file, NATIVE_KERNEL_PRELUDE "H uint8_t v[%d];\n", slots > 0 ? slots : 1 );
+        for ( int k = 0; k < chunks; ++k ) { fprintf( file, "H uint64_t k%d(uint8_t*);\n", k ); }
+        fprintf(
+          file,
+          "__attribute__((visibility(\"default\"))) void enjenir_kernel(uint64_t*o,uint8_t*s){\n"
+          "for(int i=0;i<%d;++i)v[i]=(uint8_t)(o[i>>6]>>(i&63)&1u);\n",
+          slots
+        );
+        rewind( entry );
+        char   buffer[4096];
+        size_t length;
+        while ( ( length = fread( buffer, 1, sizeof( buffer ), entry ) ) > 0 ) fwrite( buffer, 1, length, file );
+        ok = !ferror( entry ) && ok;
+        fprintf(
+          file,
+          "for(int i=0;i<%d;i+=64){uint64_t w=0;for(int j=0;j<64&&i+j<%d;++j)w|=(uint64_t)v[i+j]<<j;o[i>>6]=w;}\n"
+          "(void)s;}\n",
+          slots, slots
+        );
+        ok = CloseNativeKernelFile( file ) && ok;
+    } else {
+        ok = false;
+    }
+    fclose( entry );
+    return ok;
+}
+
+/** Deletes a kernel build directory together with whatever the compiler left in it. */
+static void RemoveNativeKernelDirectory( const char *directory ) {
+    DIR *listing = opendir( directory );
+    if ( listing != NULL ) {
+        char           path[512];
+        struct dirent *entry;
+        while ( ( entry = readdir( listing ) ) != NULL ) {
+            if ( strcmp( entry->d_name, "." ) == 0 || strcmp( entry->d_name, ".." ) == 0 ) continue;
+            snprintf( path, sizeof( path ), "%s/%s", directory, entry->d_name );
+            remove( path );
+        }
+        closedir( listing );
+    }
+    rmdir( directory );
+}
+
+extern char **environ;
+
+/**
+ * Starts argv[0], found on PATH, with environment envp as the leader of a new process group, its
+ * output discarded. Only async-signal-safe calls run between fork and exec, as the simulator is
+ * multithreaded.
+ */
+static pid_t SpawnNativeCompiler( char *const *argv, char **envp ) {
+    pid_t pid = fork();
+    if ( pid == 0 ) {
+        environ = envp;
+        setpgid( 0, 0 );
+        int null = open( "/dev/null", O_WRONLY );
+        if ( null >= 0 ) {
+            dup2( null, STDOUT_FILENO );
+            dup2( null, STDERR_FILENO );
+        }
+        execvp( argv[0], argv );
+        _exit( 127 );
+    }
+    // Also set from the parent, so the group exists before anyone can try to kill it.
+    if ( pid > 0 ) setpgid( pid, pid );
+    return pid;
+}
+
+/** Starts a compiler in a slot of compilers unless the kernel was abandoned; false if none started. */
+static bool StartNativeCompiler( struct NativeKernel *kernel, int slot, char *const *argv, char **envp ) {
+    pthread_mutex_lock( &kernel->lock );
+    pid_t pid = kernel->cancelled ? -1 : SpawnNativeCompiler( argv, envp );
+    if ( pid > 0 ) kernel->compilers[slot] = pid;
+    pthread_mutex_unlock( &kernel->lock );
+    return pid > 0;
+}
+
+/** Waits for the compiler in a slot and frees the slot. Returns true if it exited with status 0. */
+static bool FinishNativeCompiler( struct NativeKernel *kernel, int slot ) {
+    // Only the build thread fills slots, so it can read its own without the lock.
+    pid_t pid = kernel->compilers[slot];
+
+    // WNOWAIT keeps the exited child a zombie, holding on to its pid, until the slot is cleared.
+    siginfo_t info;
+    while ( waitid( P_PID, (id_t) pid, &info, WEXITED | WNOWAIT ) != 0 && errno == EINTR ) {}
+    pthread_mutex_lock( &kernel->lock );
+    kernel->compilers[slot] = 0;
+    pthread_mutex_unlock( &kernel->lock );
+
+    int status = 0;
+    while ( waitpid( pid, &status, 0 ) < 0 ) {
+        if ( errno != EINTR ) return false;
+    }
+    return WIFEXITED( status ) && WEXITSTATUS( status ) == 0;
+}
+
+/**
+ * A copy of environ with TMPDIR pointing at directory, so the compiler's own temporaries go there
+ * too and a killed build leaves none behind in the shared $TMPDIR. One allocation, freed with free.
+ */
+static char **CreateNativeCompilerEnvironment( const char *directory ) {
+    size_t variables = 0;
+    while ( environ[variables] != NULL ) { variables++; }
+    size_t pointers = ( variables + 2 ) * sizeof( char * );
+    size_t length   = strlen( "TMPDIR=" ) + strlen( directory ) + 1;
+    char **envp     = malloc( pointers + length );
+    if ( envp == NULL ) return NULL;
+
+    size_t kept = 0;
+    for ( size_t v = 0; v < variables; ++v ) {
+        if ( strncmp( environ[v], "TMPDIR=", 7 ) != 0 ) envp[kept++] = environ[v];
+    }
+    envp[kept] = (char *) envp + pointers;
+    snprintf( envp[kept++], length, "TMPDIR=%s", directory );
+    envp[kept] = NULL;
+    return envp;
+}
+
+static void *BuildNativeKernel( void *argument ) {
+    struct NativeKernel *kernel = argument;
+    int                  units  = kernel->unitCount;
+    size_t               size   = sizeof( kernel->directory ) + 32;
+
+    // One path per object file, then the source being compiled and the library.
+    char  *paths = malloc( ( (size_t) units + 2 ) * size );
+    char **argv  = malloc( ( (size_t) units + 40 ) * sizeof( char * ) );
+    char **envp  = CreateNativeCompilerEnvironment( kernel->directory );
+    bool   ok    = paths != NULL && argv != NULL && envp != NULL;
+
+    // $CC may carry flags of its own ("ccache gcc", "clang -m64"); it is split on spaces.
+    char        compiler[256];
+    int         argc = 0;
+    const char *name = getenv( "CC" );
+    snprintf( compiler, sizeof( compiler ), "%s", name != NULL && name[0] != '\0' ? name : "cc" );
+    for ( char *cursor = compiler; ok && argc < 24; ) {
+        while ( *cursor == ' ' ) { cursor++; }
+        if ( *cursor == '\0' ) break;
+        argv[argc++] = cursor;
+        while ( *cursor != ' ' && *cursor != '\0' ) { cursor++; }
+        if ( *cursor == ' ' ) *cursor++ = '\0';
+    }
+    ok = ok && argc > 0;
+
+    // -Og keeps nearly all of -O1's speed for straight-line code at a fraction of its compile time.
+    char *source  = ok ? paths + (size_t) units * size : NULL;
+    char *library = ok ? source + size : NULL;
+    if ( ok ) {
+        argv[argc + 0] = (char *) "-Og";
+        argv[argc + 1] = (char *) "-fPIC";
+        argv[argc + 2] = (char *) "-fvisibility=hidden";
+        argv[argc + 3] = (char *) "-c";
+        argv[argc + 4] = (char *) "-o";
+        argv[argc + 6] = source;
+        argv[argc + 7] = NULL;
+    }
+
+    // Units are compiled on their own, as many at once as the cores allow, and reaped in the order
+    // they started, so unit i always runs in slot i % jobs.
+    long cores    = sysconf( _SC_NPROCESSORS_ONLN );
+    int  jobs     = cores < 1 ? 1 : cores > NATIVE_KERNEL_MAX_JOBS ? NATIVE_KERNEL_MAX_JOBS : (int) cores;
+    int  started  = 0;
+    int  finished = 0;
+    while ( finished < started || ( ok && started < units ) ) {
+        if ( ok && started < units && started - finished < jobs ) {
+            argv[argc + 5] = paths + (size_t) started * size;
+            snprintf( argv[argc + 5], size, "%s/u%d.o", kernel->directory, started );
+            snprintf( source, size, "%s/u%d.c", kernel->directory, started );
+            ok = StartNativeCompiler( kernel, started % jobs, argv, envp );
+            if ( ok ) started++;
+        } else {
+            ok = FinishNativeCompiler( kernel, finished % jobs ) && ok;
+            finished++;
+        }
+    }
+
+    int status = NATIVE_KERNEL_FAILED;
+    if ( ok ) {
+        snprintf( source, size, "%s/entry.c", kernel->directory );
+        snprintf( library, size, "%s/kernel.so", kernel->directory );
+        argv[argc + 3] = (char *) "-shared";
+        argv[argc + 5] = library;
+        for ( int u = 0; u < units; ++u ) { argv[argc + 7 + u] = paths + (size_t) u * size; }
+        argv[argc + 7 + units] = NULL;
+        ok = StartNativeCompiler( kernel, 0, argv, envp ) && FinishNativeCompiler( kernel, 0 );
+    }
+    if ( ok ) {
+        kernel->library = dlopen( library, RTLD_NOW | RTLD_LOCAL );
+        if ( kernel->library != NULL ) {
+            // ISO C has no conversion from void * to a function pointer; copy the bits instead.
+            void *symbol = dlsym( kernel->library, "enjenir_kernel" );
+            memcpy( &kernel->function, &symbol, sizeof( symbol ) );
+            if ( kernel->function != NULL ) status = NATIVE_KERNEL_READY;
+        }
+    }
+    free( paths );
+    free( argv );
+    free( envp );
+    RemoveNativeKernelDirectory( kernel->directory );
+    atomic_store( &kernel->status, status );
+    return NULL;
+}
+
+/**
+ * Drops a kernel. Compilers still running are killed with their whole process groups, and the
+ * build thread, which then returns at once, is joined, so no process or build file outlives the call.
+ */
+static void AbandonNativeKernel( struct NativeKernel *kernel ) {
+    if ( kernel->threadStarted ) {
+        pthread_mutex_lock( &kernel->lock );
+        kernel->cancelled = true;
+        for ( int j = 0; j < NATIVE_KERNEL_MAX_JOBS; ++j ) {
+            if ( kernel->compilers[j] > 0 ) kill( -kernel->compilers[j], SIGKILL );
+        }
+        pthread_mutex_unlock( &kernel->lock );
+        pthread_join( kernel->thread, NULL );
+    }
+    if ( kernel->library != NULL ) dlclose( kernel->library );
+    pthread_mutex_destroy( &kernel->lock );
+    free( kernel );
+}
+
+/** A kernel for the current plan that waits for the topology to settle before it is built. */
+static struct NativeKernel *CreateNativeKernel( const EvaluationPlan *plan ) {
+    struct NativeKernel *kernel = calloc( 1, sizeof( *kernel ) );
+    if ( kernel == NULL ) return NULL;
+    if ( pthread_mutex_init( &kernel->lock, NULL ) != 0 ) {
+        free( kernel );
+        return NULL;
+    }
+    atomic_init( &kernel->status, NATIVE_KERNEL_WAITING );
+    kernel->generation = plan->generation;
+    timespec_get( &kernel->requestedAt, TIME_UTC );
+    return kernel;
+}
+
+/** Emits the plan and starts the build thread; the kernel is marked failed if that cannot start. */
+static void StartNativeKernelBuild( struct NativeKernel *kernel, const EvaluationPlan *plan ) {
+    const char *directory = getenv( "TMPDIR" );
+    if ( directory == NULL || directory[0] == '\0' ) directory = "/tmp";
+    atomic_store( &kernel->status, NATIVE_KERNEL_FAILED );
+
+    // mkdtemp creates the directory with mode 0700 under a fresh name, so no other user can plant
+    // a file or symlink where the sources are written or the library is loaded from.
+    int length = snprintf( kernel->directory, sizeof( kernel->directory ), "%s/enjenir_kernel_XXXXXX", directory );
+    if ( length < 0 || (size_t) length >= sizeof( kernel->directory ) || mkdtemp( kernel->directory ) == NULL ) {
+        return;
+    }
+
+    atomic_store( &kernel->status, NATIVE_KERNEL_BUILDING );
+    kernel->threadStarted = EmitNativeKernel( plan, kernel->directory, &kernel->unitCount ) &&
+                            pthread_create( &kernel->thread, NULL, BuildNativeKernel, kernel ) == 0;
+    if ( !kernel->threadStarted ) {
+        RemoveNativeKernelDirectory( kernel->directory );
+        atomic_store( &kernel->status, NATIVE_KERNEL_FAILED );
+    }
+}
+
+/**
+ * Returns the native kernel for the current plan, or NULL while the interpreter should run: below
+ * NATIVE_ENGINE_MIN_ELEMENTS, until the topology has been left alone for NATIVE_ENGINE_QUIET_MS,
+ * while the build is in flight, or after it failed. A kernel for an older plan is abandoned, so
+ * at most one build per simulator state is ever running.
+ */
+static NativeKernelFunction AcquireNativeKernel( SimulatorState *simulatorState ) {
+    const EvaluationPlan *plan   = &simulatorState->evaluationPlan;
+    struct NativeKernel  *kernel = simulatorState->nativeKernel;
+
+    if ( kernel != NULL && kernel->generation != plan->generation ) {
+        AbandonNativeKernel( kernel );
+        kernel = simulatorState->nativeKernel = NULL;
+    }
+    if ( plan->compiledElementCount < NATIVE_ENGINE_MIN_ELEMENTS ) return NULL;
+    if ( kernel == NULL ) {
+        simulatorState->nativeKernel = CreateNativeKernel( plan );
+        return NULL;
+    }
+
+    int status = atomic_load( &kernel->status );
+    if ( status == NATIVE_KERNEL_WAITING ) {
+        struct timespec now;
+        timespec_get( &now, TIME_UTC );
+        long long waited = (long long) ( now.tv_sec - kernel->requestedAt.tv_sec ) * 1000 +
+                           ( now.tv_nsec - kernel->requestedAt.tv_nsec ) / 1000000;
+        if ( waited >= NATIVE_ENGINE_QUIET_MS ) StartNativeKernelBuild( kernel, plan );
+        return NULL;
+    }
+    if ( status == NATIVE_KERNEL_BUILDING ) return NULL;
+    if ( !kernel->reported ) {
+        kernel->reported = true;
+        if ( status == NATIVE_KERNEL_READY ) {
+            TraceLog( LOG_INFO, "SERVER: Native kernel loaded for %d elements", plan->compiledElementCount );
+        } else {
+            TraceLog( LOG_WARNING, "SERVER: Native kernel build failed, staying on the interpreter" );
+        }
+    }
+    return status == NATIVE_KERNEL_READY ? kernel->function : NULL;
+}
+
+#endif
+
+bool Server_IsNativeEngineActive( const SimulatorState *simulatorState ) {
+#if NATIVE_ENGINE_AVAILABLE
+    struct NativeKernel *kernel = simulatorState != NULL ? simulatorState->nativeKernel : NULL;
+    return kernel != NULL && simulatorState->evaluationPlan.isValid &&
+           kernel->generation == simulatorState->evaluationPlan.generation &&
+           atomic_load( &kernel->status ) == NATIVE_KERNEL_READY;
+#else
+    (void) simulatorState;
+    return false;
+#endif
+}
+
+#if PARALLEL_PROPAGATION_AVAILABLE
+
+/** Chunks of the current phase still owned by one thread; other threads steal from the front. */
+typedef struct PropagationQueue {
+    atomic_int next;
+    int        end;
+    char       padding[64 - sizeof( atomic_int ) - sizeof( int )];    // One cache line each.
+} PropagationQueue;
+
+typedef struct PropagationWorker {
+    struct PropagationPool *pool;
+    int                     index;
+} PropagationWorker;
+
+/**
+ * Persistent worker threads for level-parallel sweeps. The calling thread takes part as thread 0.
+ * Workers sleep on wake between sweeps; within a sweep, threads meet at a barrier after each
+ * phase, sleeping on phaseDone, and the last one to arrive deals out the next phase's chunks.
+ */
+struct PropagationPool {
+    pthread_t         threads[PARALLEL_MAX_THREADS];
+    PropagationWorker workers[PARALLEL_MAX_THREADS];
+    int               threadCount;
+    pthread_mutex_t   mutex;
+    pthread_cond_t    wake;
+    unsigned int      sweep;             ///< Incremented under mutex to start a sweep.
+    bool              quit;
+    SimulatorState   *simulatorState;    ///< State being swept; set before sweep is incremented.
+    int               phase;             ///< Phase the queues currently hold.
+    pthread_cond_t    phaseDone;         ///< Signalled when barrier is incremented.
+    int               arrived;           ///< Threads waiting at the barrier; guarded by mutex.
+    unsigned int      barrier;           ///< Incremented under mutex each time every thread has
+                                         ///< arrived.
+    PropagationQueue  queues[PARALLEL_MAX_THREADS];
+};
+
+/**
+ * Executes [pc, end) while other threads write the same output words: inputs are read with
+ * relaxed atomic loads and an output bit is flipped with an atomic read-modify-write, and only
+ * when it changes.
+ */
+static bool RunSharedSignalCode( SimulatorState *simulatorState, int pc, int end, uint64_t *stateHash ) {
+    ElementStore  *store   = &simulatorState->elements;
+    const int32_t *code    = simulatorState->evaluationPlan.code;
+    bool           changed = false;
+
+    while ( pc < end ) {
+        uint32_t header = (uint32_t) code[pc];
+        int      dst    = code[pc + 1];
+        uint32_t op     = SIGNAL_OPCODE( header );
+        uint32_t high   = 0;
+        bool     next   = op == SIGNAL_OP_SET;
+
+        if ( SIGNAL_COUNT( header ) != 0 ) {
+            for ( uint32_t i = 0; i < SIGNAL_COUNT( header ); ++i ) {
+                uint32_t operand = (uint32_t) code[pc + 2 + i];
+                uint32_t slot    = operand >> 3;
+                uint64_t word    = __atomic_load_n( &store->outputBits[slot >> 6], __ATOMIC_RELAXED );
+                high            |= (uint32_t) ( ( word >> ( slot & 63 ) ) & 1 ) << ( operand & 7 );
+            }
+            store->inputStateBits[dst] = (uint8_t) ( ( store->inputStateBits[dst] & ~SIGNAL_CONNECTED( header ) ) | high );
+        }
+        if ( op == SIGNAL_OP_LUT ) next = ( (uint32_t) code[pc + 2 + SIGNAL_COUNT( header )] >> high ) & 1;
+        else if ( op != SIGNAL_OP_SET && op != SIGNAL_OP_CLEAR )
+            next = op == SIGNAL_OP_AND ? high == SIGNAL_REQUIRED( header ) : ( high != 0 ) == ( op == SIGNAL_OP_OR );
+
+        uint64_t *word = &store->outputBits[dst >> 6];
+        uint64_t  bit  = (uint64_t) 1 << ( dst & 63 );
+        if ( ( ( __atomic_load_n( word, __ATOMIC_RELAXED ) & bit ) != 0 ) != next ) {
+            if ( next ) __atomic_fetch_or( word, bit, __ATOMIC_RELAXED );
+            else __atomic_fetch_and( word, ~bit, __ATOMIC_RELAXED );
+            if ( stateHash != NULL ) *stateHash ^= SignalSlotKey( dst );
+            changed = true;
+        }
+        pc += SIGNAL_LENGTH( header );
+    }
+    return changed;
+}
+
+/** Runs components [first, last) of one phase; runs of acyclic components execute as one range. */
+static void RunPropagationComponents( SimulatorState *simulatorState, int first, int last ) {
+    const EvaluationPlan *plan = &simulatorState->evaluationPlan;
+
+    for ( int c = first; c < last; ) {
+        if ( plan->componentCyclic[c] ) {
+            SettleComponent( simulatorState, c++, false, true );
+            continue;
+        }
+        int run = c;
+        while ( c < last && !plan->componentCyclic[c] ) { c++; }
+        RunSharedSignalCode( simulatorState, plan->componentCode[run], plan->componentCode[c], NULL );
+    }
+}
+
+/** Splits a phase's chunks evenly over the thread queues; a serial phase is a single chunk. */
+static void DealPropagationPhase( struct PropagationPool *pool, int phase ) {
+    const EvaluationPlan *plan = &pool->simulatorState->evaluationPlan;
+
+    pool->phase = phase;
+    if ( phase >= plan->phaseCount ) return;
+
+    int components = plan->phaseStart[phase + 1] - plan->phaseStart[phase];
+    int chunks     = plan->phaseParallel[phase]
+                     ? ( components + PARALLEL_CHUNK_COMPONENTS - 1 ) / PARALLEL_CHUNK_COMPONENTS
+                     : 1;
+    for ( int t = 0; t < pool->threadCount; ++t ) {
+        atomic_store_explicit( &pool->queues[t].next, chunks * t / pool->threadCount, memory_order_relaxed );
+        pool->queues[t].end = chunks * ( t + 1 ) / pool->threadCount;
+    }
+}
+
+/**
+ * Barrier between phases. Waiting threads sleep rather than spin, so a pool with more threads
+ * than free cores still makes progress; the mutex also publishes the dealt queues.
+ */
+static void WaitForPropagationThreads( struct PropagationPool *pool ) {
+    pthread_mutex_lock( &pool->mutex );
+    unsigned int barrier = pool->barrier;
+    if ( ++pool->arrived == pool->threadCount ) {
+        pool->arrived = 0;
+        DealPropagationPhase( pool, pool->phase + 1 );
+        pool->barrier++;
+        pthread_cond_broadcast( &pool->phaseDone );
+    } else {
+        while ( pool->barrier == barrier ) { pthread_cond_wait( &pool->phaseDone, &pool->mutex ); }
+    }
+    pthread_mutex_unlock( &pool->mutex );
+}
+
+/** Thread index's share of one sweep: every phase, own chunks first, then stolen ones. */
+static void RunPropagationSweep( struct PropagationPool *pool, int index ) {
+    SimulatorState       *simulatorState = pool->simulatorState;
+    const EvaluationPlan *plan           = &simulatorState->evaluationPlan;
+
+    for ( int phase = 0; phase < plan->phaseCount; ++phase ) {
+        int first = plan->phaseStart[phase];
+        int last  = plan->phaseStart[phase + 1];
+        int width = plan->phaseParallel[phase] ? PARALLEL_CHUNK_COMPONENTS : last - first;
+
+        for ( int v = 0; v < pool->threadCount; ++v ) {
+            PropagationQueue *queue = &pool->queues[( index + v ) % pool->threadCount];
+            for ( ;; ) {
+                int chunk = atomic_fetch_add( &queue->next, 1 );
+                if ( chunk >= queue->end ) break;
+                int begin = first + chunk * width;
+                RunPropagationComponents( simulatorState, begin, begin + width < last ? begin + width : last );
+            }
+        }
+        WaitForPropagationThreads( pool );
+    }
+}
+
+static void *RunPropagationWorker( void *argument ) {
+    PropagationWorker      *worker = argument;
+    struct PropagationPool *pool   = worker->pool;
+    unsigned int            seen   = 0;
+
+    for ( ;; ) {
+        pthread_mutex_lock( &pool->mutex );
+        while ( !pool->quit && pool->sweep == seen ) { pthread_cond_wait( &pool->wake, &pool->mutex ); }
+        bool quit = pool->quit;
+        seen      = pool->sweep;
+        pthread_mutex_unlock( &pool->mutex );
+        if ( quit ) return NULL;
+
+        RunPropagationSweep( pool, worker->index );
+    }
+}
+
+/** Starts a pool of wanted threads, caller included, or one per core for 0; NULL below two. */
+static struct PropagationPool *CreatePropagationPool( int wanted ) {
+    if ( wanted == 0 ) {
+        long cores = sysconf( _SC_NPROCESSORS_ONLN );
+        wanted     = cores < 1 ? 1 : cores < PARALLEL_MAX_THREADS ? (int) cores : PARALLEL_MAX_THREADS;
+    }
+    if ( wanted > PARALLEL_MAX_THREADS ) wanted = PARALLEL_MAX_THREADS;
+    if ( wanted < 2 ) return NULL;
+
+    struct PropagationPool *pool = calloc( 1, sizeof( *pool ) );
+    if ( pool == NULL ) return NULL;
+    pthread_mutex_init( &pool->mutex, NULL );
+    pthread_cond_init( &pool->wake, NULL );
+    pthread_cond_init( &pool->phaseDone, NULL );
+
+    pool->threadCount = 1;
+    for ( int t = 1; t < wanted; ++t ) {
+        PropagationWorker *worker = &pool->workers[t];
+        worker->pool              = pool;
+        worker->index             = t;
+        if ( pthread_create( &pool->threads[t], NULL, RunPropagationWorker, worker ) != 0 ) break;
+        pool->threadCount++;
+    }
+    if ( pool->threadCount < 2 ) {
+        DestroyPropagationPool( pool );
+        return NULL;
+    }
+    TraceLog( LOG_INFO, "SERVER: Level-parallel propagation on %d threads", pool->threadCount );
+    return pool;
+}
+
+static void DestroyPropagationPool( struct PropagationPool *pool ) {
+    pthread_mutex_lock( &pool->mutex );
+    pool->quit = true;
+    pthread_cond_broadcast( &pool->wake );
+    pthread_mutex_unlock( &pool->mutex );
+    for ( int t = 1; t < pool->threadCount; ++t ) { pthread_join( pool->threads[t], NULL ); }
+    pthread_cond_destroy( &pool->phaseDone );
+    pthread_cond_destroy( &pool->wake );
+    pthread_mutex_destroy( &pool->mutex );
+    free( pool );
+}
+
+/**
+ * True if the current plan is worth sweeping on a pool: it has a level wide enough to split and
+ * either reaches PARALLEL_MIN_ELEMENTS or Server_SetPropagationThreads asked for threads.
+ */
+static bool WantsPropagationPool( const SimulatorState *simulatorState ) {
+    const EvaluationPlan *plan    = &simulatorState->evaluationPlan;
+    int                   threads = simulatorState->propagationThreads;
+
+    if ( threads == 1 || plan->parallelPhaseCount == 0 ) return false;
+    return threads >= 2 || plan->compiledElementCount >= PARALLEL_MIN_ELEMENTS;
+}
+
+/**
+ * Returns the pool a sweep of the current plan should run on, or NULL when WantsPropagationPool
+ * says no or the machine has a single core and no thread count was forced.
+ */
+static struct PropagationPool *AcquirePropagationPool( SimulatorState *simulatorState ) {
+    if ( !WantsPropagationPool( simulatorState ) ) return NULL;
+    if ( simulatorState->propagationPool == NULL ) {
+        simulatorState->propagationPool = CreatePropagationPool( simulatorState->propagationThreads );
+    }
+    return simulatorState->propagationPool;
+}
+
+/** Sweeps every phase of the plan on the pool, the caller working as thread 0. */
+static void RunParallelSweep( struct PropagationPool *pool, SimulatorState *simulatorState ) {
+    pool->simulatorState = simulatorState;
+    DealPropagationPhase( pool, 0 );
+
+    pthread_mutex_lock( &pool->mutex );
+    pool->sweep++;
+    pthread_cond_broadcast( &pool->wake );
+    pthread_mutex_unlock( &pool->mutex );
+
+    RunPropagationSweep( pool, 0 );
+}
+
+#endif
+
+int Server_GetPropagationThreadCount( const SimulatorState *simulatorState ) {
+#if PARALLEL_PROPAGATION_AVAILABLE
+    if ( simulatorState != NULL && simulatorState->propagationPool != NULL &&
+         simulatorState->evaluationPlan.isValid && WantsPropagationPool( simulatorState ) ) {
+        return simulatorState->propagationPool->threadCount;
+    }
+#else
+    (void) simulatorState;
+#endif
+    return 1;
+}
+
+void Server_SetPropagationThreads( SimulatorState *simulatorState, int threadCount ) {
+    if ( simulatorState == NULL || threadCount < 0 ) return;
+
+    simulatorState->propagationThreads = threadCount;
+#if PARALLEL_PROPAGATION_AVAILABLE
+    // The pool is sized when created; the next sweep that wants one starts it at the new size.
+    if ( simulatorState->propagationPool != NULL ) {
+        DestroyPropagationPool( simulatorState->propagationPool );
+        simulatorState->propagationPool = NULL;
+    }
+#endif
+    TraceLog( LOG_INFO, "SERVER: Propagation threads set to %d", threadCount );
+}
+
+#if NATIVE_ENGINE_AVAILABLE
+/** Folds the outputs a bulk sweep flipped into the state hash, diffing against sweepOutputBits. */
+static void HashSweptOutputs( SimulatorState *simulatorState ) {
+    const EvaluationPlan *plan    = &simulatorState->evaluationPlan;
+    const uint64_t       *outputs = simulatorState->elements.outputBits;
+
+    for ( int w = 0; w < ELEMENT_BIT_WORDS( plan->compiledElementCount ); ++w ) {
+        for ( uint64_t flips = outputs[w] ^ plan->sweepOutputBits[w]; flips != 0; flips &= flips - 1 ) {
+            int bit = 0;
+            while ( ( ( flips >> bit ) & 1 ) == 0 ) { bit++; }
+            simulatorState->stateHash ^= SignalSlotKey( w * 64 + bit );
+        }
+    }
+}
+#endif
+
+static void PropagateSignals( SimulatorState *simulatorState ) {
+    EvaluationPlan *plan = &simulatorState->evaluationPlan;
+
+    EnsureEvaluationPlan( simulatorState );
+#if NATIVE_ENGINE_AVAILABLE
+    size_t outputWords = (size_t) ELEMENT_BIT_WORDS( plan->compiledElementCount ) * sizeof( uint64_t );
+#endif
+
+#if PARALLEL_PROPAGATION_AVAILABLE
+    // Event-driven mode keeps its cone-sized work for small changes; a sweep pays off once a
+    // good share of the canvas is already queued, as after a recompile.
+    bool sweep = simulatorState->propagationMode == PROPAGATION_FULL_SWEEP ||
+                 ( plan->worklistCount > 0 && plan->worklistCount >= plan->componentCount / 4 );
+    struct PropagationPool *pool = sweep ? AcquirePropagationPool( simulatorState ) : NULL;
+    if ( pool != NULL ) {
+        memcpy( plan->sweepOutputBits, simulatorState->elements.outputBits, outputWords );
+        RunParallelSweep( pool, simulatorState );
+        HashSweptOutputs( simulatorState );
+        for ( int c = 0; c < plan->componentCount; ++c ) { plan->componentQueued[c] = false; }
+        plan->worklistCount = 0;
+        return;
+    }
+#endif
+
+#if NATIVE_ENGINE_AVAILABLE
+    NativeKernelFunction kernel = AcquireNativeKernel( simulatorState );
+    if ( kernel != NULL && ( plan->worklistCount > 0 || simulatorState->propagationMode == PROPAGATION_FULL_SWEEP ) ) {
+        memcpy( plan->sweepOutputBits, simulatorState->elements.outputBits, outputWords );
+        kernel( simulatorState->elements.outputBits, simulatorState->elements.inputStateBits );
+        HashSweptOutputs( simulatorState );
+        for ( int c = 0; c < plan->componentCount; ++c ) { plan->componentQueued[c] = false; }
+        plan->worklistCount = 0;
+        return;
+    }
+#endif
+
+    if ( simulatorState->propagationMode == PROPAGATION_FULL_SWEEP ) {
+        // Consecutive acyclic components are contiguous code and run as one straight-line pass.
+        for ( int c = 0; c < plan->componentCount; ) {
+            if ( plan->componentCyclic[c] ) {
+                EvaluateComponent( simulatorState, c++, false );
+                continue;
+            }
+            int first = c;
+            while ( c < plan->componentCount && !plan->componentCyclic[c] ) { c++; }
+            RunSignalCode( simulatorState, plan->componentCode[first], plan->componentCode[c], -1, false, NULL );
+        }
+        for ( int c = 0; c < plan->componentCount; ++c ) { plan->componentQueued[c] = false; }
+        plan->worklistCount = 0;
+        return;
+    }
+
+    while ( plan->worklistCount > 0 ) {
+        EvaluateComponent( simulatorState, PopComponent( plan ), true );
+    }
+}
+
+int Server_CollectOriginSlots( const SimulatorState *simulatorState, int *originSlots, int maxOrigins ) {
+    if ( simulatorState == NULL ) return 0;
+
+    int originCount = 0;
+    for ( int i = 0; i < simulatorState->elementCount; ++i ) {
+        uint8_t type = simulatorState->elements.types[i];
+        if ( ( type != ELEMENT_SWITCH && type != ELEMENT_BUTTON ) ||
+             !TestElementBit( simulatorState->elements.activeBits, i ) ) {
+            continue;
+        }
+        if ( originSlots != NULL && originCount < maxOrigins ) originSlots[originCount] = i;
+        originCount++;
+    }
+    return originCount;
+}
+
+/**
+ * What a lane sweep evaluates: entries grouped by plan component in plan order, a cyclic group
+ * being iterated until it settles. Rows of the lane arrays are slots for the whole canvas and
+ * entry positions for a slice.
+ */
+typedef struct LaneSweep {
+    const int  *slots;          ///< Slot of each entry.
+    const int  *groupStart;     ///< First entry of each group; one extra end entry.
+    const bool *groupCyclic;    ///< True if the group is a feedback loop.
+    int         groupCount;
+    const int ( *inputs )[MAX_INPUTS_PER_LOGIC_GATE];    ///< Input rows of each row.
+    const int  *originOfRow;    ///< Origin index of each switch or button row.
+    int         rowCount;       ///< Rows of the element lane array.
+    bool        rowsAreEntries; ///< Entry j is row j rather than row slots[j].
+    bool        lookupCones;    ///< Cone roots are evaluated by their tables (rows must be slots).
+    const AigCone *graph;       ///< If set, rows are the rows of this graph cone, evaluated instead
+                                ///< of elements; originOfRow is then -1 for held inputs.
+} LaneSweep;
+
+static int LaneSweepSlot( const LaneSweep *sweep, int row ) { return sweep->rowsAreEntries ? sweep->slots[row] : row; }
+
+LANE_INLINE bool EvaluateLaneElement(
+  const SimulatorState *simulatorState, int slot, int row, const int *inputs, const int *originOfRow,
+  const uint64_t *originWords, uint64_t *elementWords, int stride, int offset, int width
+) {
+    const ElementStore *store    = &simulatorState->elements;
+    uint64_t           *dst      = elementWords + (size_t) row * stride + offset;
+    uint64_t            result[SIGNAL_BLOCK_MAX_WORDS];
+    bool                hasInput = false;
+
+    switch ( store->types[slot] ) {
+        case ELEMENT_SOURCE:
+            for ( int w = 0; w < width; ++w ) { result[w] = ~(uint64_t) 0; }
+            break;
+
+        case ELEMENT_BUTTON:
+        case ELEMENT_SWITCH:
+            {
+                const uint64_t *src = originWords + (size_t) originOfRow[row] * stride + offset;
+                for ( int w = 0; w < width; ++w ) { result[w] = src[w]; }
+                break;
+            }
+
+        case ELEMENT_AND:
+            for ( int w = 0; w < width; ++w ) { result[w] = ~(uint64_t) 0; }
+            for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) {
+                if ( inputs[k] < 0 ) continue;
+                const uint64_t *src = elementWords + (size_t) inputs[k] * stride + offset;
+                for ( int w = 0; w < width; ++w ) { result[w] &= src[w]; }
+                hasInput = true;
+            }
+            if ( !hasInput || store->connectedInputCounts[slot] < 2 ) {
+                for ( int w = 0; w < width; ++w ) { result[w] = 0; }
+            }
+            break;
+
+        case ELEMENT_OR:
+        case ELEMENT_BUS:
+        case ELEMENT_NOT:
+            for ( int w = 0; w < width; ++w ) { result[w] = 0; }
+            for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) {
+                if ( inputs[k] < 0 ) continue;
+                const uint64_t *src = elementWords + (size_t) inputs[k] * stride + offset;
+                for ( int w = 0; w < width; ++w ) { result[w] |= src[w]; }
+                hasInput = true;
+            }
+            if ( store->types[slot] == ELEMENT_NOT && hasInput ) {
+                for ( int w = 0; w < width; ++w ) { result[w] = ~result[w]; }
+            }
+            break;
+
+        case ELEMENT_MODULE:
+            {
+                // Sum of the table's minterms; an unconnected pin is low, so its minterms with the
+                // pin high never match.
+                uint32_t table = simulatorState->modules[store->modules[slot]].truthTable;
+                for ( int w = 0; w < width; ++w ) {
+                    uint64_t pins[MAX_INPUTS_PER_LOGIC_GATE];
+                    for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) {
+                        pins[k] = inputs[k] < 0 ? 0 : elementWords[(size_t) inputs[k] * stride + offset + w];
+                    }
+                    result[w] = 0;
+                    for ( int m = 0; m < 1 << MAX_INPUTS_PER_LOGIC_GATE; ++m ) {
+                        if ( !( ( table >> m ) & 1 ) ) continue;
+                        uint64_t term = ~(uint64_t) 0;
+                        for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) { term &= ( m >> k ) & 1 ? pins[k] : ~pins[k]; }
+                        result[w] |= term;
+                    }
+                }
+                break;
+            }
+
+        case ELEMENT_SENSOR:
+            for ( int w = 0; w < width; ++w ) { result[w] = 0; }
+            break;
+
+        default: return false;
+    }
+
+    uint64_t difference = 0;
+    for ( int w = 0; w < width; ++w ) {
+        difference |= dst[w] ^ result[w];
+        dst[w]      = result[w];
+    }
+    return difference != 0;
+}
+
+/**
+ * Evaluates a cone root from its leaves by its truth table, as a mux tree: the table's bit pairs
+ * select between the first leaf, its complement and constants, and each further leaf halves the
+ * remaining candidates.
+ */
+LANE_INLINE void EvaluateLaneCone( const EvaluationPlan *plan, int slot, uint64_t *elementWords, int stride, int offset, int width ) {
+    const int *leaves    = plan->coneLeaves[slot];
+    int        leafCount = plan->coneLeafCounts[slot];
+    uint64_t   table     = plan->coneTables[slot];
+    uint64_t  *dst       = elementWords + (size_t) slot * stride + offset;
+    uint64_t   node[( 1 << ( LUT_CONE_MAX_LEAVES - 1 ) ) * SIGNAL_BLOCK_MAX_WORDS];
+
+    if ( leafCount == 0 ) {
+        for ( int w = 0; w < width; ++w ) { dst[w] = table & 1 ? ~(uint64_t) 0 : 0; }
+        return;
+    }
+
+    const uint64_t *leaf  = elementWords + (size_t) leaves[0] * stride + offset;
+    int             nodes = 1 << ( leafCount - 1 );
+    for ( int i = 0; i < nodes; ++i ) {
+        uint64_t low  = ( table >> ( 2 * i ) ) & 1 ? ~(uint64_t) 0 : 0;
+        uint64_t high = ( table >> ( 2 * i + 1 ) ) & 1 ? ~(uint64_t) 0 : 0;
+        for ( int w = 0; w < width; ++w ) { node[i * width + w] = ( low & ~leaf[w] ) | ( high & leaf[w] ); }
+    }
+    for ( int k = 1; k < leafCount; ++k ) {
+        leaf   = elementWords + (size_t) leaves[k] * stride + offset;
+        nodes /= 2;
+        for ( int i = 0; i < nodes; ++i ) {
+            for ( int w = 0; w < width; ++w ) {
+                node[i * width + w] = ( node[2 * i * width + w] & ~leaf[w] ) | ( node[( 2 * i + 1 ) * width + w] & leaf[w] );
+            }
+        }
+    }
+    for ( int w = 0; w < width; ++w ) { dst[w] = node[w]; }
+}
+
+/**
+ * Simulates one block of lanes over a sweep. The canvas sweep of the capability engine covers
+ * only the simulated netlist: constants keep the rows filled from their outputs, cones marked for
+ * lookup are evaluated at their roots, and bypassed, dead and collapsed elements are left stale.
+ * That suits callers that read nothing but the simulated inputs of sensors.
+ */
+LANE_INLINE void SimulateLaneChunk(
+  const SimulatorState *simulatorState, const LaneSweep *sweep, const uint64_t *originWords, uint64_t *elementWords,
+  int stride, int offset, int width
+) {
+    const EvaluationPlan *plan = &simulatorState->evaluationPlan;
+
+    for ( int g = 0; g < sweep->groupCount; ++g ) {
+        int passes = sweep->groupCyclic[g] ? MAX_FEEDBACK_ITERATIONS : 1;
+
+        for ( int pass = 0; pass < passes; ++pass ) {
+            bool changed = false;
+            for ( int j = sweep->groupStart[g]; j < sweep->groupStart[g + 1]; ++j ) {
+                int slot = sweep->slots[j];
+                int row  = sweep->rowsAreEntries ? j : slot;
+                if ( sweep->lookupCones && plan->coneLookup[slot] ) {
+                    EvaluateLaneCone( plan, slot, elementWords, stride, offset, width );
+                    continue;
+                }
+                if ( EvaluateLaneElement(
+                       simulatorState, slot, row, sweep->inputs[row], sweep->originOfRow, originWords, elementWords,
+                       stride, offset, width
+                     ) ) {
+                    changed = true;
+                }
+            }
+            if ( !changed ) break;
+        }
+    }
+}
+
+static void SimulateLaneChunkPortable(
+  const SimulatorState *simulatorState, const LaneSweep *sweep, const uint64_t *originWords, uint64_t *elementWords,
+  int stride, int offset
+) {
+    SimulateLaneChunk( simulatorState, sweep, originWords, elementWords, stride, offset, 1 );
+}
+
+#if LANE_X86_DISPATCH
+__attribute__( ( target( "avx2" ) ) ) static void SimulateLaneChunkAvx2(
+  const SimulatorState *simulatorState, const LaneSweep *sweep, const uint64_t *originWords, uint64_t *elementWords,
+  int stride, int offset
+) {
+    SimulateLaneChunk( simulatorState, sweep, originWords, elementWords, stride, offset, 4 );
+}
+
+__attribute__( ( target( "avx512f" ) ) ) static void SimulateLaneChunkAvx512(
+  const SimulatorState *simulatorState, const LaneSweep *sweep, const uint64_t *originWords, uint64_t *elementWords,
+  int stride, int offset
+) {
+    SimulateLaneChunk( simulatorState, sweep, originWords, elementWords, stride, offset, 8 );
+}
+#endif
+
+int Server_GetPreferredLaneWords( void ) {
+#if LANE_X86_DISPATCH
+    if ( __builtin_cpu_supports( "avx512f" ) ) return 8;
+    if ( __builtin_cpu_supports( "avx2" ) ) return 4;
+#endif
+    return 1;
+}
+
+static void SimulateLaneRows(
+  const SimulatorState *simulatorState, const LaneSweep *sweep, const uint64_t *originWords, int laneWords,
+  uint64_t *elementWords
+) {
+    for ( int row = 0; row < sweep->rowCount; ++row ) {
+        uint64_t fill = TestElementBit( simulatorState->elements.outputBits, LaneSweepSlot( sweep, row ) ) ? ~(uint64_t) 0 : 0;
+        for ( int w = 0; w < laneWords; ++w ) { elementWords[(size_t) row * laneWords + w] = fill; }
+    }
+
+    int offset = 0;
+#if LANE_X86_DISPATCH
+    int preferredWords = Server_GetPreferredLaneWords();
+    if ( preferredWords == 8 ) {
+        for ( ; offset + 8 <= laneWords; offset += 8 ) {
+            SimulateLaneChunkAvx512( simulatorState, sweep, originWords, elementWords, laneWords, offset );
+        }
+    }
+    if ( preferredWords >= 4 ) {
+        for ( ; offset + 4 <= laneWords; offset += 4 ) {
+            SimulateLaneChunkAvx2( simulatorState, sweep, originWords, elementWords, laneWords, offset );
+        }
+    }
+#endif
+    for ( ; offset < laneWords; ++offset ) {
+        SimulateLaneChunkPortable( simulatorState, sweep, originWords, elementWords, laneWords, offset );
+    }
+}
+
+/** ANDs one block of lanes through the AND rows of a graph cone, complementing fan-ins as marked. */
+LANE_INLINE void SimulateAigChunk( const AigCone *cone, uint64_t *rowWords, int stride, int offset, int width ) {
+    for ( int r = cone->inputCount + 1; r < cone->rowCount; ++r ) {
+        int             a     = cone->fanins[r][0];
+        int             b     = cone->fanins[r][1];
+        const uint64_t *left  = rowWords + (size_t) ( a >> 1 ) * stride + offset;
+        const uint64_t *right = rowWords + (size_t) ( b >> 1 ) * stride + offset;
+        uint64_t        flipA = a & 1 ? ~(uint64_t) 0 : 0;
+        uint64_t        flipB = b & 1 ? ~(uint64_t) 0 : 0;
+        uint64_t       *dst   = rowWords + (size_t) r * stride + offset;
+        for ( int w = 0; w < width; ++w ) { dst[w] = ( left[w] ^ flipA ) & ( right[w] ^ flipB ); }
+    }
+}
+
+static void SimulateAigChunkPortable( const AigCone *cone, uint64_t *rowWords, int stride, int offset ) {
+    SimulateAigChunk( cone, rowWords, stride, offset, 1 );
+}
+
+#if LANE_X86_DISPATCH
+__attribute__( ( target( "avx2" ) ) ) static void SimulateAigChunkAvx2(
+  const AigCone *cone, uint64_t *rowWords, int stride, int offset
+) {
+    SimulateAigChunk( cone, rowWords, stride, offset, 4 );
+}
+
+__attribute__( ( target( "avx512f" ) ) ) static void SimulateAigChunkAvx512(
+  const AigCone *cone, uint64_t *rowWords, int stride, int offset
+) {
+    SimulateAigChunk( cone, rowWords, stride, offset, 8 );
+}
+#endif
+
+/** Fills the constant and input rows of a graph sweep and evaluates its AND rows. */
+static void SimulateAigRows(
+  const SimulatorState *simulatorState, const LaneSweep *sweep, const uint64_t *originWords, int laneWords,
+  uint64_t *rowWords
+) {
+    const AigCone *cone      = sweep->graph;
+    const int     *nodeSlots = simulatorState->evaluationPlan.aig.nodeSlots;
+    for ( int w = 0; w < laneWords; ++w ) { rowWords[w] = 0; }
+    for ( int r = 1; r <= cone->inputCount; ++r ) {
+        int       slot   = nodeSlots[cone->nodes[r]];
+        int       origin = sweep->originOfRow[r];
+        uint64_t  fill   = TestElementBit( simulatorState->elements.outputBits, slot ) ? ~(uint64_t) 0 : 0;
+        uint64_t *dst    = rowWords + (size_t) r * laneWords;
+        for ( int w = 0; w < laneWords; ++w ) { dst[w] = origin >= 0 ? originWords[(size_t) origin * laneWords + w] : fill; }
+    }
+
+    int offset = 0;
+#if LANE_X86_DISPATCH
+    int preferredWords = Server_GetPreferredLaneWords();
+    if ( preferredWords == 8 ) {
+        for ( ; offset + 8 <= laneWords; offset += 8 ) { SimulateAigChunkAvx512( cone, rowWords, laneWords, offset ); }
+    }
+    if ( preferredWords >= 4 ) {
+        for ( ; offset + 4 <= laneWords; offset += 4 ) { SimulateAigChunkAvx2( cone, rowWords, laneWords, offset ); }
+    }
+#endif
+    for ( ; offset < laneWords; ++offset ) { SimulateAigChunkPortable( cone, rowWords, laneWords, offset ); }
+}
+
+/** Sweep of the whole canvas, rows being slots; reduced selects the capability engine's netlist. */
+static LaneSweep CanvasLaneSweep( const SimulatorState *simulatorState, const int *originIndexOfSlot, bool reduced ) {
+    const EvaluationPlan *plan = &simulatorState->evaluationPlan;
+    return (LaneSweep) {
+        .slots          = reduced ? plan->simulatedOrder : plan->order,
+        .groupStart     = reduced ? plan->simulatedStart : plan->componentStart,
+        .groupCyclic    = plan->componentCyclic,
+        .groupCount     = plan->componentCount,
+        .inputs         = reduced ? plan->simulatedInputs : plan->inputSlots,
+        .originOfRow    = originIndexOfSlot,
+        .rowCount       = simulatorState->elementCount,
+        .rowsAreEntries = false,
+        .lookupCones    = reduced,
+    };
+}
+
+/** Sweep of a slice, rows being member positions. */
+static LaneSweep SliceLaneSweep( const ConeSlice *slice ) {
+    return (LaneSweep) {
+        .slots          = slice->members,
+        .groupStart     = slice->groupStart,
+        .groupCyclic    = slice->groupCyclic,
+        .groupCount     = slice->groupCount,
+        .inputs         = slice->inputs,
+        .originOfRow    = slice->originOfRow,
+        .rowCount       = slice->memberCount,
+        .rowsAreEntries = true,
+        .lookupCones    = false,
+    };
+}
+
+bool Server_SimulateLanes(
+  SimulatorState *simulatorState, const uint64_t *originWords, int laneWords, uint64_t *elementWords
+) {
+    if ( simulatorState == NULL || elementWords == NULL || laneWords <= 0 ) return false;
+
+    EnsureEvaluationPlan( simulatorState );
+
+    size_t slots             = (size_t) simulatorState->elementCount + 1;
+    int   *originSlots       = malloc( slots * sizeof( int ) );
+    int   *originIndexOfSlot = malloc( slots * sizeof( int ) );
+    bool   succeeded         = originSlots != NULL && originIndexOfSlot != NULL;
+
+    if ( succeeded ) {
+        int originCount = Server_CollectOriginSlots( simulatorState, originSlots, simulatorState->elementCount );
+        succeeded       = originCount == 0 || originWords != NULL;
+        for ( int o = 0; o < originCount; ++o ) { originIndexOfSlot[originSlots[o]] = o; }
+        LaneSweep sweep = CanvasLaneSweep( simulatorState, originIndexOfSlot, false );
+        if ( succeeded ) SimulateLaneRows( simulatorState, &sweep, originWords, laneWords, elementWords );
+    }
+
+    free( originSlots );
+    free( originIndexOfSlot );
+    return succeeded;
+}
+
+/**
+ * Open-addressing set of 64-bit sensor patterns. Key 0 marks an empty bucket, so the all-off
+ * pattern is tracked by hasZero instead of being stored.
+ */
+typedef struct PatternSet {
+    uint64_t *keys;
+    size_t    capacity;
+    size_t    count;
+    bool      hasZero;
+} PatternSet;
+
+static size_t PatternBucket( uint64_t pattern, size_t capacity ) {
+    return (size_t) ( ( pattern * 0x9E3779B97F4A7C15ull ) >> 32 ) & ( capacity - 1 );
+}
+
+static bool PatternSetInsert( PatternSet *set, uint64_t pattern ) {
+    if ( pattern == 0 ) {
+        set->hasZero = true;
+        return true;
+    }
+
+    if ( ( set->count + 1 ) * 2 > set->capacity ) {
+        size_t    newCapacity = set->capacity ? set->capacity * 2 : 256;
+        uint64_t *newKeys     = calloc( newCapacity, sizeof( uint64_t ) );
+        if ( newKeys == NULL ) return false;
+        for ( size_t i = 0; i < set->capacity; ++i ) {
+            if ( set->keys[i] == 0 ) continue;
+            size_t bucket = PatternBucket( set->keys[i], newCapacity );
+            while ( newKeys[bucket] != 0 ) { bucket = ( bucket + 1 ) & ( newCapacity - 1 ); }
+            newKeys[bucket] = set->keys[i];
+        }
+        free( set->keys );
+        set->keys     = newKeys;
+        set->capacity = newCapacity;
+    }
+
+    size_t bucket = PatternBucket( pattern, set->capacity );
+    while ( set->keys[bucket] != 0 ) {
+        if ( set->keys[bucket] == pattern ) return true;
+        bucket = ( bucket + 1 ) & ( set->capacity - 1 );
+    }
+    set->keys[bucket] = pattern;
+    set->count++;
+    return true;
+}
+
+static size_t PatternSetSize( const PatternSet *set ) {
+    return set->count + ( set->hasZero ? 1 : 0 );
+}
+
+/**
+ * Word w of a terminal's lane row: a row literal for a graph sweep, otherwise a row whose sensor
+ * contributes whether it is triggered and any other element its output.
+ */
+static uint64_t TerminalLaneWord(
+  const SimulatorState *simulatorState, const LaneSweep *sweep, const uint64_t *rowWords, int words, int w, int row
+) {
+    if ( sweep->graph != NULL ) return rowWords[(size_t) ( row >> 1 ) * words + w] ^ ( row & 1 ? ~(uint64_t) 0 : 0 );
+    if ( simulatorState->elements.types[LaneSweepSlot( sweep, row )] != ELEMENT_SENSOR ) {
+        return rowWords[(size_t) row * words + w];
+    }
+
+    uint64_t triggered = 0;
+    for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) {
+        int input = sweep->inputs[row][k];
+        if ( input >= 0 ) triggered |= rowWords[(size_t) input * words + w];
+    }
+    return triggered;
+}
+
+typedef struct CapabilityJob {
+    const SimulatorState *simulatorState;
+    const LaneSweep      *sweep;
+    const int            *terminalRows;    ///< Rows whose patterns are counted; a sensor row
+                                           ///< contributes whether it is triggered. Row literals
+                                           ///< for a graph sweep.
+    int                   terminalCount;
+    int                   originCount;
+    uint64_t              vectorCount;
+    uint64_t              wordCount;
+    int                   chunkWords;
+    int                   chunkCount;
+#if CAPABILITY_THREADED
+    atomic_int nextChunk;
+#else
+    int nextChunk;
+#endif
+} CapabilityJob;
+
+typedef struct CapabilityWorker {
+    CapabilityJob *job;
+    PatternSet     patterns;
+    bool           succeeded;
+} CapabilityWorker;
+
+static int ClaimCapabilityChunk( CapabilityJob *job ) {
+#if CAPABILITY_THREADED
+    return atomic_fetch_add( &job->nextChunk, 1 );
+#else
+    return job->nextChunk++;
+#endif
+}
+
+static void *RunCapabilityWorker( void *argument ) {
+    CapabilityWorker     *worker         = argument;
+    CapabilityJob        *job            = worker->job;
+    const SimulatorState *simulatorState = job->simulatorState;
+    const LaneSweep      *sweep          = job->sweep;
+    size_t                originRows     = job->originCount > 0 ? (size_t) job->originCount : 1;
+    size_t                elementRows    = sweep->rowCount > 0 ? (size_t) sweep->rowCount : 1;
+    uint64_t *originWords  = malloc( originRows * (size_t) job->chunkWords * sizeof( uint64_t ) );
+    uint64_t *elementWords = malloc( elementRows * (size_t) job->chunkWords * sizeof( uint64_t ) );
+
+    worker->succeeded = ( originWords != NULL && elementWords != NULL );
+
+    for ( int chunk = ClaimCapabilityChunk( job ); worker->succeeded && chunk < job->chunkCount;
+          chunk = ClaimCapabilityChunk( job ) ) {
+        uint64_t firstWord = (uint64_t) chunk * (uint64_t) job->chunkWords;
+        int      words     = (int) ( job->wordCount - firstWord < (uint64_t) job->chunkWords ? job->wordCount - firstWord
+                                                                                            : (uint64_t) job->chunkWords );
+
+        for ( int o = 0; o < job->originCount; ++o ) {
+            for ( int w = 0; w < words; ++w ) {
+                originWords[(size_t) o * words + w] =
+                  ( o < 6 ) ? originLanePatterns[o]
+                            : ( ( ( firstWord + w ) >> ( o - 6 ) ) & 1 ) ? ~(uint64_t) 0 : 0;
+            }
+        }
+
+        // On the canvas only the sensors' simulated inputs are read, and those are never inside
+        // a cone.
+        if ( sweep->graph != NULL ) SimulateAigRows( simulatorState, sweep, originWords, words, elementWords );
+        else SimulateLaneRows( simulatorState, sweep, originWords, words, elementWords );
+
+        for ( int w = 0; w < words && worker->succeeded; ++w ) {
+            uint64_t triggered[CAPABILITY_MAX_SENSORS];
+            for ( int s = 0; s < job->terminalCount; ++s ) {
+                triggered[s] = TerminalLaneWord( simulatorState, sweep, elementWords, words, w, job->terminalRows[s] );
+            }
+
+            uint64_t firstVector = ( firstWord + w ) * SIGNAL_LANES_PER_WORD;
+            int      lanes       = job->vectorCount - firstVector < SIGNAL_LANES_PER_WORD
+                                   ? (int) ( job->vectorCount - firstVector )
+                                   : SIGNAL_LANES_PER_WORD;
+            uint64_t previous    = 0;
+            for ( int b = 0; b < lanes; ++b ) {
+                uint64_t pattern = 0;
+                for ( int s = 0; s < job->terminalCount; ++s ) {
+                    pattern |= ( ( triggered[s] >> b ) & 1 ) << s;
+                }
+                if ( b > 0 && pattern == previous ) continue;
+                previous = pattern;
+                if ( !PatternSetInsert( &worker->patterns, pattern ) ) worker->succeeded = false;
+            }
+        }
+    }
+
+    free( originWords );
+    free( elementWords );
+    return NULL;
+}
+
+#define BDD_FALSE 0
+#define BDD_TRUE  1
+
+typedef enum BddOperation {
+    BDD_OP_ITE = 1,
+    BDD_OP_EXISTS,
+} BddOperation;
+
+typedef struct BddNode {
+    int var;     ///< Variable index, which is also its level; terminals use varCount.
+    int low;     ///< Node reached when var is 0.
+    int high;    ///< Node reached when var is 1.
+    int next;    ///< Next node in the same unique-table bucket, -1 at the end.
+} BddNode;
+
+typedef struct BddCacheEntry {
+    int operation;
+    int f;
+    int g;
+    int h;
+    int result;
+} BddCacheEntry;
+
+/**
+ * Reduced ordered BDD manager: node store, unique table (hash-consing so every function has one
+ * node) and a direct-mapped computed cache. Exceeding BDD_MAX_NODES sets overflow, after which
+ * results are meaningless and the caller gives up.
+ */
+typedef struct BddManager {
+    BddNode       *nodes;
+    int            nodeCount;
+    int            nodeCapacity;
+    int           *buckets;
+    BddCacheEntry *cache;
+    int            varCount;
+    const bool    *quantified;
+    bool           overflow;
+} BddManager;
+
+static unsigned int BddHash( int a, int b, int c ) {
+    unsigned int hash = (unsigned int) a * 12582917u;
+    hash              = ( hash ^ (unsigned int) b ) * 4256249u;
+    hash              = ( hash ^ (unsigned int) c ) * 741457u;
+    return hash ^ ( hash >> 15 );
+}
+
+static bool BddInit( BddManager *bdd, int varCount, const bool *quantified ) {
+    bdd->nodeCapacity = 4096;
+    bdd->nodes        = malloc( (size_t) bdd->nodeCapacity * sizeof( BddNode ) );
+    bdd->buckets      = malloc( (size_t) BDD_MAX_NODES * sizeof( int ) );
+    bdd->cache        = calloc( BDD_CACHE_SIZE, sizeof( BddCacheEntry ) );
+    bdd->varCount     = varCount;
+    bdd->quantified   = quantified;
+    bdd->overflow     = false;
+    if ( bdd->nodes == NULL || bdd->buckets == NULL || bdd->cache == NULL ) return false;
+
+    for ( int i = 0; i < BDD_MAX_NODES; ++i ) { bdd->buckets[i] = -1; }
+    for ( int t = BDD_FALSE; t <= BDD_TRUE; ++t ) {
+        bdd->nodes[t] = (BddNode) { varCount, t, t, -1 };
+    }
+    bdd->nodeCount = 2;
+    return true;
+}
+
+static void BddFree( BddManager *bdd ) {
+    free( bdd->nodes );
+    free( bdd->buckets );
+    free( bdd->cache );
+}
+
+static int BddMakeNode( BddManager *bdd, int var, int low, int high ) {
+    if ( low == high ) return low;
+
+    unsigned int bucket = BddHash( var, low, high ) & ( BDD_MAX_NODES - 1 );
+    for ( int n = bdd->buckets[bucket]; n != -1; n = bdd->nodes[n].next ) {
+        if ( bdd->nodes[n].var == var && bdd->nodes[n].low == low && bdd->nodes[n].high == high ) return n;
+    }
+
+    if ( bdd->nodeCount >= BDD_MAX_NODES ) {
+        bdd->overflow = true;
+        return BDD_FALSE;
+    }
+    if ( bdd->nodeCount == bdd->nodeCapacity ) {
+        int      newCapacity = bdd->nodeCapacity * 2;
+        BddNode *newNodes    = realloc( bdd->nodes, (size_t) newCapacity * sizeof( BddNode ) );
+        if ( newNodes == NULL ) {
+            bdd->overflow = true;
+            return BDD_FALSE;
+        }
+        bdd->nodes        = newNodes;
+        bdd->nodeCapacity = newCapacity;
+    }
+
+    int n                = bdd->nodeCount++;
+    bdd->nodes[n]        = (BddNode) { var, low, high, bdd->buckets[bucket] };
+    bdd->buckets[bucket] = n;
+    return n;
+}
+
+static BddCacheEntry *BddCacheSlot( BddManager *bdd, int operation, int f, int g, int h ) {
+    return &bdd->cache[BddHash( f * 4 + operation, g, h ) & ( BDD_CACHE_SIZE - 1 )];
+}
+
+static int BddCofactor( const BddManager *bdd, int f, int var, bool high ) {
+    if ( bdd->nodes[f].var != var ) return f;
+    return high ? bdd->nodes[f].high : bdd->nodes[f].low;
+}
+
+static int BddIte( BddManager *bdd, int f, int g, int h ) {
+    if ( f == BDD_TRUE ) return g;
+    if ( f == BDD_FALSE ) return h;
+    if ( g == h ) return g;
+    if ( g == BDD_TRUE && h == BDD_FALSE ) return f;
+    if ( bdd->overflow ) return BDD_FALSE;
+
+    BddCacheEntry *entry = BddCacheSlot( bdd, BDD_OP_ITE, f, g, h );
+    if ( entry->operation == BDD_OP_ITE && entry->f == f && entry->g == g && entry->h == h ) return entry->result;
+
+    int top = bdd->nodes[f].var;
+    if ( bdd->nodes[g].var < top ) top = bdd->nodes[g].var;
+    if ( bdd->nodes[h].var < top ) top = bdd->nodes[h].var;
+
+    int low  = BddIte(
+      bdd, BddCofactor( bdd, f, top, false ), BddCofactor( bdd, g, top, false ), BddCofactor( bdd, h, top, false )
+    );
+    int high = BddIte(
+      bdd, BddCofactor( bdd, f, top, true ), BddCofactor( bdd, g, top, true ), BddCofactor( bdd, h, top, true )
+    );
+    int result = BddMakeNode( bdd, top, low, high );
+
+    entry  = BddCacheSlot( bdd, BDD_OP_ITE, f, g, h );
+    *entry = (BddCacheEntry) { BDD_OP_ITE, f, g, h, result };
+    return result;
+}
+
+static int BddAnd( BddManager *bdd, int f, int g ) { return BddIte( bdd, f, g, BDD_FALSE ); }
+static int BddOr( BddManager *bdd, int f, int g ) { return BddIte( bdd, f, BDD_TRUE, g ); }
+static int BddNot( BddManager *bdd, int f ) { return BddIte( bdd, f, BDD_FALSE, BDD_TRUE ); }
+
+/** Existentially quantifies every variable flagged in bdd->quantified. */
+static int BddExists( BddManager *bdd, int f ) {
+    if ( f <= BDD_TRUE || bdd->overflow ) return f;
+
+    BddCacheEntry *entry = BddCacheSlot( bdd, BDD_OP_EXISTS, f, 0, 0 );
+    if ( entry->operation == BDD_OP_EXISTS && entry->f == f ) return entry->result;
+
+    int var    = bdd->nodes[f].var;
+    int low    = BddExists( bdd, bdd->nodes[f].low );
+    int high   = BddExists( bdd, bdd->nodes[f].high );
+    int result = bdd->quantified[var] ? BddOr( bdd, low, high ) : BddMakeNode( bdd, var, low, high );
+
+    entry  = BddCacheSlot( bdd, BDD_OP_EXISTS, f, 0, 0 );
+    *entry = (BddCacheEntry) { BDD_OP_EXISTS, f, 0, 0, result };
+    return result;
+}
+
+static uint64_t SaturatingShift( uint64_t value, int shift ) {
+    if ( value == 0 ) return 0;
+    if ( shift >= 64 || value > ( UINT64_MAX >> shift ) ) return UINT64_MAX;
+    return value << shift;
+}
+
+static uint64_t SaturatingAdd( uint64_t a, uint64_t b ) { return ( a > UINT64_MAX - b ) ? UINT64_MAX : a + b; }
+
+/**
+ * Model count of f over the non-quantified variables. freeBelow[v] is the number of
+ * non-quantified variables with index >= v; counts are memoised per node in memo, 0 meaning "not
+ * yet computed" since every node other than BDD_FALSE has a model.
+ */
+static uint64_t BddCountModels( const BddManager *bdd, int f, const int *freeBelow, uint64_t *memo ) {
+    if ( f == BDD_FALSE ) return 0;
+    if ( f == BDD_TRUE ) return 1;
+    if ( memo[f] != 0 ) return memo[f];
+
+    const BddNode *node  = &bdd->nodes[f];
+    uint64_t       total = 0;
+    for ( int branch = 0; branch < 2; ++branch ) {
+        int child = branch ? node->high : node->low;
+        int gap   = freeBelow[node->var + 1] - freeBelow[bdd->nodes[child].var];
+        total     = SaturatingAdd( total, SaturatingShift( BddCountModels( bdd, child, freeBelow, memo ), gap ) );
+    }
+    memo[f] = total;
+    return total;
+}
+
+static float CapabilityEfficiency( const SimulatorState *simulatorState, int uniqueStateCount ) {
+    int originPoints = 0;
+    for ( int i = 0; i < simulatorState->elementCount; ++i ) {
+        const ElementStore *store = &simulatorState->elements;
+        if ( IsActiveElementOfType( store, i, ELEMENT_SOURCE ) || IsActiveElementOfType( store, i, ELEMENT_SWITCH ) ||
+             IsActiveElementOfType( store, i, ELEMENT_BUTTON ) ) {
+            originPoints++;
+        }
+    }
+    return originPoints > 0 ? (float) uniqueStateCount / (float) originPoints : 0.0f;
+}
+
+/**
+ * Counts the patterns of the given terminals on BDDs built over the graph's cone of them, or of
+ * every sensor when terminalSlots is NULL. A sensor terminal contributes whether it is triggered,
+ * any other its output.
+ */
+static bool AnalyzeSymbolicTerminals(
+  SimulatorState *simulatorState, const int *terminalSlots, int terminalCount, CapabilityReport *report
+) {
+    EnsureEvaluationPlan( simulatorState );
+    const AndInverterGraph *aig         = &simulatorState->evaluationPlan.aig;
+    const ElementStore     *store       = &simulatorState->elements;
+    size_t                  slots       = (size_t) simulatorState->elementCount + 1 + (size_t) terminalCount;
+    int                    *terminals   = malloc( slots * sizeof( int ) );
+    int                     sensorCount = 0;
+    int                     originCount = Server_CollectOriginSlots( simulatorState, NULL, 0 );
+    AigCone                 cone        = { 0 };
+    BddManager              bdd         = { 0 };
+
+    *report             = (CapabilityReport) { 0 };
+    report->originCount = originCount;
+    report->vectorCount = SaturatingShift( 1, originCount );
+    report->isSymbolic  = true;
+    report->isValid     = true;
+
+    for ( int i = 0; i < simulatorState->elementCount && terminalSlots == NULL && terminals != NULL; ++i ) {
+        if ( IsActiveElementOfType( store, i, ELEMENT_SENSOR ) ) terminals[sensorCount++] = aig->triggerLiterals[i];
+    }
+    for ( int t = 0; t < terminalCount && terminalSlots != NULL && terminals != NULL; ++t ) {
+        int slot                 = terminalSlots[t];
+        terminals[sensorCount++] = store->types[slot] == ELEMENT_SENSOR ? aig->triggerLiterals[slot] : aig->outputLiterals[slot];
+    }
+    report->sensorCount = sensorCount;
+
+    bool   allocated  = terminals != NULL && CollectAigCone( aig, terminals, sensorCount, &cone );
+    size_t rows       = (size_t) cone.rowCount + (size_t) sensorCount + 1;
+    int   *varOfRow   = malloc( rows * sizeof( int ) );
+    int   *visitedBy  = malloc( rows * sizeof( int ) );
+    int   *function   = malloc( rows * sizeof( int ) );
+    int   *stack      = malloc( rows * sizeof( int ) );
+    int   *sensorVar  = malloc( rows * sizeof( int ) );
+    bool  *quantified = malloc( rows * sizeof( bool ) );
+    int   *freeBelow  = malloc( rows * sizeof( int ) );
+    allocated         = allocated && varOfRow != NULL && visitedBy != NULL && function != NULL && stack != NULL;
+    allocated         = allocated && sensorVar != NULL && quantified != NULL && freeBelow != NULL;
+
+    // Variable order: each terminal's origins in depth-first order over its cone, followed by the
+    // terminal's own output variable, so every output sits just below its support.
+    int varCount = 0;
+    for ( int r = 0; r < cone.rowCount && allocated; ++r ) {
+        varOfRow[r]  = -1;
+        visitedBy[r] = -1;
+    }
+    for ( int s = 0; s < sensorCount && allocated; ++s ) {
+        int root         = cone.rowOfNode[terminals[s] >> 1];
+        int first        = varCount;
+        int pending      = 0;
+        stack[pending++] = root;
+        visitedBy[root]  = s;
+        while ( pending > 0 ) {
+            int row = stack[--pending];
+            if ( row > cone.inputCount ) {
+                for ( int i = 1; i >= 0; --i ) {
+                    int fanin = cone.fanins[row][i] >> 1;
+                    if ( visitedBy[fanin] == s ) continue;
+                    visitedBy[fanin] = s;
+                    stack[pending++] = fanin;
+                }
+            } else if ( row > 0 && varOfRow[row] == -1 ) {
+                uint8_t type = store->types[aig->nodeSlots[cone.nodes[row]]];
+                if ( type == ELEMENT_SWITCH || type == ELEMENT_BUTTON ) varOfRow[row] = varCount++;
+            }
+        }
+        for ( int v = first; v < varCount; ++v ) { quantified[v] = true; }
+        sensorVar[s]           = varCount;
+        quantified[varCount++] = false;
+    }
+    if ( allocated ) quantified[varCount] = false;
+
+    bool cyclic = allocated && cone.stateCount > 0;
+    if ( allocated && !cyclic ) allocated = BddInit( &bdd, varCount, quantified );
+
+    int relation = BDD_TRUE;
+    for ( int r = 0; r < cone.rowCount && allocated && !cyclic && !bdd.overflow; ++r ) {
+        if ( r > cone.inputCount ) {
+            int a       = cone.fanins[r][0];
+            int b       = cone.fanins[r][1];
+            int left    = a & 1 ? BddNot( &bdd, function[a >> 1] ) : function[a >> 1];
+            int right   = b & 1 ? BddNot( &bdd, function[b >> 1] ) : function[b >> 1];
+            function[r] = BddAnd( &bdd, left, right );
+        } else if ( varOfRow[r] != -1 ) {
+            function[r] = BddMakeNode( &bdd, varOfRow[r], BDD_FALSE, BDD_TRUE );
+        } else {
+            function[r] = r > 0 && TestElementBit( store->outputBits, aig->nodeSlots[cone.nodes[r]] ) ? BDD_TRUE : BDD_FALSE;
+        }
+    }
+    for ( int s = 0; s < sensorCount && allocated && !cyclic && !bdd.overflow; ++s ) {
+        int literal = AigConeLiteral( &cone, terminals[s] );
+        int trigger = literal & 1 ? BddNot( &bdd, function[literal >> 1] ) : function[literal >> 1];
+        int output  = BddMakeNode( &bdd, sensorVar[s], BDD_FALSE, BDD_TRUE );
+        relation    = BddAnd( &bdd, relation, BddIte( &bdd, output, trigger, BddNot( &bdd, trigger ) ) );
+    }
+
+    bool succeeded = allocated && !cyclic && !bdd.overflow;
+    if ( succeeded && sensorCount > 0 ) {
+        int       image = BddExists( &bdd, relation );
+        uint64_t *memo  = calloc( (size_t) bdd.nodeCount, sizeof( uint64_t ) );
+        freeBelow[varCount] = 0;
+        for ( int v = varCount - 1; v >= 0; --v ) { freeBelow[v] = freeBelow[v + 1] + ( quantified[v] ? 0 : 1 ); }
+
+        if ( memo != NULL && !bdd.overflow ) {
+            uint64_t states = SaturatingShift(
+              BddCountModels( &bdd, image, freeBelow, memo ), freeBelow[0] - freeBelow[bdd.nodes[image].var]
+            );
+            report->uniqueStateCount = states > INT_MAX ? INT_MAX : (int) states;
+        } else {
+            succeeded = false;
+        }
+        free( memo );
+    }
+
+    if ( !allocated ) TraceLog( LOG_WARNING, "SERVER: Symbolic capability analysis ran out of memory" );
+    if ( cyclic ) TraceLog( LOG_WARNING, "SERVER: Symbolic capability analysis does not support feedback loops" );
+    if ( bdd.overflow ) TraceLog( LOG_WARNING, "SERVER: Symbolic capability analysis exceeded %d BDD nodes", BDD_MAX_NODES );
+
+    report->isExact    = succeeded;
+    report->efficiency = succeeded ? CapabilityEfficiency( simulatorState, report->uniqueStateCount ) : 0.0f;
+    BddFree( &bdd );
+    AigConeFree( &cone );
+    free( terminals );
+    free( varOfRow );
+    free( visitedBy );
+    free( function );
+    free( stack );
+    free( sensorVar );
+    free( quantified );
+    free( freeBelow );
+    return succeeded;
+}
+
+bool Server_AnalyzeCapabilitySymbolic( SimulatorState *simulatorState, CapabilityReport *report ) {
+    if ( simulatorState == NULL || report == NULL ) return false;
+    return AnalyzeSymbolicTerminals( simulatorState, NULL, 0, report );
+}
+
+/**
+ * Enumerates every assignment of report->originCount origins over the sweep in chunks claimed by
+ * up to CAPABILITY_MAX_THREADS workers, and stores the number of distinct terminal patterns in
+ * report. Returns false, with isExact cleared, if memory ran out.
+ */
+static bool EnumerateTerminalPatterns(
+  const SimulatorState *simulatorState, const LaneSweep *sweep, const int *terminalRows, int terminalCount,
+  CapabilityReport *report
+) {
+    CapabilityJob job;
+    job.simulatorState = simulatorState;
+    job.sweep          = sweep;
+    job.terminalRows   = terminalRows;
+    job.terminalCount  = terminalCount;
+    job.originCount    = report->originCount;
+    job.vectorCount    = report->vectorCount;
+    job.wordCount      = ( job.vectorCount + SIGNAL_LANES_PER_WORD - 1 ) / SIGNAL_LANES_PER_WORD;
+    job.chunkWords     = CAPABILITY_CHUNK_WORDS;
+    while ( job.chunkWords > 1 && (size_t) job.chunkWords * (size_t) sweep->rowCount > CAPABILITY_MAX_ROW_WORDS ) {
+        job.chunkWords /= 2;
+    }
+    job.chunkCount     = (int) ( ( job.wordCount + (uint64_t) job.chunkWords - 1 ) / (uint64_t) job.chunkWords );
+#if CAPABILITY_THREADED
+    atomic_init( &job.nextChunk, 0 );
+#else
+    job.nextChunk = 0;
+#endif
+
+    int workerCount = job.chunkCount < CAPABILITY_MAX_THREADS ? job.chunkCount : CAPABILITY_MAX_THREADS;
+    CapabilityWorker workers[CAPABILITY_MAX_THREADS];
+    for ( int t = 0; t < workerCount; ++t ) {
+        workers[t].job       = &job;
+        workers[t].patterns  = (PatternSet) { 0 };
+        workers[t].succeeded = false;
+    }
+
+#if CAPABILITY_THREADED
+    pthread_t threads[CAPABILITY_MAX_THREADS];
+    bool      started[CAPABILITY_MAX_THREADS] = { false };
+    for ( int t = 1; t < workerCount; ++t ) {
+        started[t] = pthread_create( &threads[t], NULL, RunCapabilityWorker, &workers[t] ) == 0;
+    }
+    RunCapabilityWorker( &workers[0] );
+    for ( int t = 1; t < workerCount; ++t ) {
+        if ( started[t] ) pthread_join( threads[t], NULL );
+        else workers[t].succeeded = true;
+    }
+#else
+    RunCapabilityWorker( &workers[0] );
+    for ( int t = 1; t < workerCount; ++t ) { workers[t].succeeded = true; }
+#endif
+
+    bool succeeded = true;
+    for ( int t = 0; t < workerCount; ++t ) { succeeded = succeeded && workers[t].succeeded; }
+    for ( int t = 1; t < workerCount && succeeded; ++t ) {
+        if ( workers[t].patterns.hasZero ) workers[0].patterns.hasZero = true;
+        for ( size_t i = 0; i < workers[t].patterns.capacity && succeeded; ++i ) {
+            uint64_t pattern = workers[t].patterns.keys[i];
+            if ( pattern != 0 ) succeeded = PatternSetInsert( &workers[0].patterns, pattern );
+        }
+    }
+    for ( int t = 0; t < workerCount; ++t ) {
+        if ( t > 0 || !succeeded ) free( workers[t].patterns.keys );
+    }
+
+    if ( !succeeded ) {
+        TraceLog( LOG_WARNING, "SERVER: Capability analysis ran out of memory" );
+        report->isExact = false;
+        return false;
+    }
+
+    report->uniqueStateCount = (int) PatternSetSize( &workers[0].patterns );
+    free( workers[0].patterns.keys );
+    return true;
+}
+
+const CapabilityReport *Server_AnalyzeCapability( SimulatorState *simulatorState ) {
+    if ( simulatorState == NULL ) return NULL;
+
+    EnsureEvaluationPlan( simulatorState );
+
+    CapabilityReport *report = &simulatorState->capability;
+    if ( report->isValid ) return report;
+
+    int originSlots[CAPABILITY_MAX_ORIGINS];
+    int sensorSlots[CAPABILITY_MAX_SENSORS];
+    int sensorCount  = 0;
+    int originCount  = Server_CollectOriginSlots( simulatorState, originSlots, CAPABILITY_MAX_ORIGINS );
+    for ( int i = 0; i < simulatorState->elementCount; ++i ) {
+        if ( !IsActiveElementOfType( &simulatorState->elements, i, ELEMENT_SENSOR ) ) continue;
+        if ( sensorCount < CAPABILITY_MAX_SENSORS ) sensorSlots[sensorCount] = i;
+        sensorCount++;
+    }
+
+    if ( originCount > CAPABILITY_MAX_ORIGINS || sensorCount > CAPABILITY_MAX_SENSORS ) {
+        Server_AnalyzeCapabilitySymbolic( simulatorState, report );
+        TraceLog(
+          LOG_INFO, "SERVER: Symbolic capability %d unique states over %d origins (%s)", report->uniqueStateCount,
+          originCount, report->isExact ? "exact" : "failed"
+        );
+        return report;
+    }
+
+    *report             = (CapabilityReport) { 0 };
+    report->originCount = originCount;
+    report->sensorCount = sensorCount;
+    report->isValid     = true;
+
+    report->vectorCount = (uint64_t) 1 << originCount;
+    report->isExact     = true;
+    if ( sensorCount == 0 ) return report;
+
+    int *originIndexOfSlot = malloc( (size_t) simulatorState->elementCount * sizeof( int ) );
+    if ( originIndexOfSlot == NULL ) {
+        TraceLog( LOG_WARNING, "SERVER: Capability analysis ran out of memory" );
+        report->isExact = false;
+        return report;
+    }
+    for ( int i = 0; i < simulatorState->elementCount; ++i ) { originIndexOfSlot[i] = -1; }
+    for ( int o = 0; o < originCount; ++o ) { originIndexOfSlot[originSlots[o]] = o; }
+
+    // The sweep runs over the And-Inverter Graph's cone of the sensor triggers unless a feedback
+    // loop is in it, in which case the simulated netlist is iterated element by element.
+    const AndInverterGraph *aig = &simulatorState->evaluationPlan.aig;
+    int                     triggers[CAPABILITY_MAX_SENSORS];
+    AigCone                 cone        = { 0 };
+    int                    *originOfRow = NULL;
+    for ( int s = 0; s < sensorCount; ++s ) { triggers[s] = aig->triggerLiterals[sensorSlots[s]]; }
+    if ( CollectAigCone( aig, triggers, sensorCount, &cone ) && cone.stateCount == 0 ) {
+        originOfRow = malloc( (size_t) cone.rowCount * sizeof( int ) );
+    }
+
+    LaneSweep sweep = CanvasLaneSweep( simulatorState, originIndexOfSlot, true );
+    if ( originOfRow != NULL ) {
+        for ( int r = 1; r <= cone.inputCount; ++r ) { originOfRow[r] = originIndexOfSlot[aig->nodeSlots[cone.nodes[r]]]; }
+        for ( int s = 0; s < sensorCount; ++s ) { triggers[s] = AigConeLiteral( &cone, triggers[s] ); }
+        sweep = (LaneSweep) { .originOfRow = originOfRow, .rowCount = cone.rowCount, .graph = &cone };
+    }
+    bool succeeded = EnumerateTerminalPatterns(
+      simulatorState, &sweep, originOfRow != NULL ? triggers : sensorSlots, sensorCount, report
+    );
+    AigConeFree( &cone );
+    free( originOfRow );
+    free( originIndexOfSlot );
+    if ( !succeeded ) return report;
+
+    report->efficiency = CapabilityEfficiency( simulatorState, report->uniqueStateCount );
+
+    TraceLog(
+      LOG_INFO, "SERVER: Capability %d unique states over %d origins (efficiency %.2f)", report->uniqueStateCount,
+      originCount, report->efficiency
+    );
+    return report;
+}
+
+typedef struct IntVector {
+    int *items;
+    int  count;
+    int  capacity;
+} IntVector;
+
+static bool IntVectorPush( IntVector *vector, int value ) {
+    if ( vector->count == vector->capacity ) {
+        int  newCapacity = vector->capacity ? vector->capacity * 2 : 8;
+        int *newItems    = realloc( vector->items, (size_t) newCapacity * sizeof( int ) );
+        if ( newItems == NULL ) return false;
+        vector->items    = newItems;
+        vector->capacity = newCapacity;
+    }
+    vector->items[vector->count++] = value;
+    return true;
+}
+
+#define SAT_VAR( lit )    ( ( lit ) >> 1 )
+#define SAT_LIT( v, neg ) ( ( ( v ) << 1 ) | ( ( neg ) ? 1 : 0 ) )
+#define SAT_UNDEF         -1
+
+typedef enum SatResult {
+    SAT_UNSATISFIABLE = 0,
+    SAT_SATISFIABLE,
+    SAT_UNKNOWN,
+} SatResult;
+
+/**
+ * Minimal CDCL solver. Literals are 2 * var + negated. Clauses live in one flat literal array;
+ * the first two literals of every clause of size >= 2 are watched, and the implied literal of a
+ * reason clause is kept at position 0.
+ */
+typedef struct SatSolver {
+    int          varCount;
+    IntVector    literals;          ///< All clause literals, back to back.
+    IntVector    clauseStart;       ///< Offset of each clause in literals.
+    IntVector    clauseSize;        ///< Literal count of each clause.
+    IntVector   *watches;           ///< Clauses watching each literal.
+    signed char *values;            ///< Per variable: SAT_UNDEF, 0 or 1.
+    bool        *savedPhase;        ///< Last value of each variable, reused on decision.
+    bool        *seen;
+    int         *level;
+    int         *reason;            ///< Clause that implied the variable, -1 for decisions.
+    double      *activity;
+    double       activityIncrement;
+    IntVector    trail;
+    IntVector    trailLimits;       ///< Trail length at the start of each decision level.
+    int          propagateHead;
+    bool         ok;                ///< False once an empty clause was derived.
+} SatSolver;
+
+static bool SatInit( SatSolver *solver, int varCount ) {
+    *solver                   = (SatSolver) { 0 };
+    solver->varCount          = varCount;
+    solver->watches           = calloc( (size_t) varCount * 2, sizeof( IntVector ) );
+    solver->values            = malloc( (size_t) varCount );
+    solver->savedPhase        = calloc( (size_t) varCount, sizeof( bool ) );
+    solver->seen              = calloc( (size_t) varCount, sizeof( bool ) );
+    solver->level             = calloc( (size_t) varCount, sizeof( int ) );
+    solver->reason            = malloc( (size_t) varCount * sizeof( int ) );
+    solver->activity          = calloc( (size_t) varCount, sizeof( double ) );
+    solver->activityIncrement = 1.0;
+    solver->ok                = true;
+    if ( solver->watches == NULL || solver->values == NULL || solver->savedPhase == NULL || solver->seen == NULL ||
+         solver->level == NULL || solver->reason == NULL || solver->activity == NULL ) {
+        return false;
+    }
+    for ( int v = 0; v < varCount; ++v ) {
+        solver->values[v] = SAT_UNDEF;
+        solver->reason[v] = -1;
+    }
+    return true;
+}
+
+static void SatFree( SatSolver *solver ) {
+    if ( solver->watches != NULL ) {
+        for ( int l = 0; l < solver->varCount * 2; ++l ) { free( solver->watches[l].items ); }
+    }
+    free( solver->watches );
+    free( solver->values );
+    free( solver->savedPhase );
+    free( solver->seen );
+    free( solver->level );
+    free( solver->reason );
+    free( solver->activity );
+    free( solver->literals.items );
+    free( solver->clauseStart.items );
+    free( solver->clauseSize.items );
+    free( solver->trail.items );
+    free( solver->trailLimits.items );
+}
+
+/** Returns 1 if the literal is true, 0 if false, SAT_UNDEF if its variable is unassigned. */
+static int SatLiteralValue( const SatSolver *solver, int lit ) {
+    signed char value = solver->values[SAT_VAR( lit )];
+    return value == SAT_UNDEF ? SAT_UNDEF : ( value ^ ( lit & 1 ) );
+}
+
+static bool SatAttachClause( SatSolver *solver, const int *lits, int size ) {
+    int clause = solver->clauseStart.count;
+    if ( !IntVectorPush( &solver->clauseStart, solver->literals.count ) ) return false;
+    if ( !IntVectorPush( &solver->clauseSize, size ) ) return false;
+    for ( int i = 0; i < size; ++i ) {
+        if ( !IntVectorPush( &solver->literals, lits[i] ) ) return false;
+    }
+    if ( size >= 2 ) {
+        if ( !IntVectorPush( &solver->watches[lits[0]], clause ) ) return false;
+        if ( !IntVectorPush( &solver->watches[lits[1]], clause ) ) return false;
+    }
+    return true;
+}
+
+/** Adds an input clause before solving; duplicate literals are dropped and tautologies skipped. */
+static bool SatAddClause( SatSolver *solver, const int *lits, int size ) {
+    int clean[MAX_INPUTS_PER_LOGIC_GATE + 2];
+    int cleanSize = 0;
+    for ( int i = 0; i < size; ++i ) {
+        bool duplicate = false;
+        for ( int j = 0; j < cleanSize; ++j ) {
+            if ( clean[j] == ( lits[i] ^ 1 ) ) return true;
+            if ( clean[j] == lits[i] ) duplicate = true;
+        }
+        if ( !duplicate ) clean[cleanSize++] = lits[i];
+    }
+    if ( cleanSize == 0 ) {
+        solver->ok = false;
+        return true;
+    }
+    return SatAttachClause( solver, clean, cleanSize );
+}
+
+static void SatAssign( SatSolver *solver, int lit, int reason ) {
+    int var                  = SAT_VAR( lit );
+    solver->values[var]      = (signed char) !( lit & 1 );
+    solver->level[var]       = solver->trailLimits.count;
+    solver->reason[var]      = reason;
+    IntVectorPush( &solver->trail, lit );
+}
+
+/** Unit propagation over the watch lists; returns the conflicting clause or -1. */
+static int SatPropagate( SatSolver *solver ) {
+    while ( solver->propagateHead < solver->trail.count ) {
+        int        falseLit = solver->trail.items[solver->propagateHead++] ^ 1;
+        IntVector *watchers = &solver->watches[falseLit];
+        int        kept     = 0;
+
+        for ( int w = 0; w < watchers->count; ++w ) {
+            int  clause = watchers->items[w];
+            int *lits   = &solver->literals.items[solver->clauseStart.items[clause]];
+            int  size   = solver->clauseSize.items[clause];
+
+            if ( lits[0] == falseLit ) {
+                lits[0] = lits[1];
+                lits[1] = falseLit;
+            }
+            if ( SatLiteralValue( solver, lits[0] ) == 1 ) {
+                watchers->items[kept++] = clause;
+                continue;
+            }
+
+            bool moved = false;
+            for ( int k = 2; k < size; ++k ) {
+                if ( SatLiteralValue( solver, lits[k] ) != 0 ) {
+                    lits[1] = lits[k];
+                    lits[k] = falseLit;
+                    IntVectorPush( &solver->watches[lits[1]], clause );
+                    moved = true;
+                    break;
+                }
+            }
+            if ( moved ) continue;
+
+            watchers->items[kept++] = clause;
+            if ( SatLiteralValue( solver, lits[0] ) == 0 ) {
+                while ( ++w < watchers->count ) { watchers->items[kept++] = watchers->items[w]; }
+                watchers->count = kept;
+                return clause;
+            }
+            SatAssign( solver, lits[0], clause );
+        }
+        watchers->count = kept;
+    }
+    return -1;
+}
+
+static void SatBumpActivity( SatSolver *solver, int var ) {
+    solver->activity[var] += solver->activityIncrement;
+    if ( solver->activity[var] > 1e100 ) {
+        for ( int v = 0; v < solver->varCount; ++v ) { solver->activity[v] *= 1e-100; }
+        solver->activityIncrement *= 1e-100;
+    }
+}
+
+static void SatBacktrack( SatSolver *solver, int targetLevel ) {
+    if ( solver->trailLimits.count <= targetLevel ) return;
+    int keep = solver->trailLimits.items[targetLevel];
+    for ( int i = solver->trail.count - 1; i >= keep; --i ) {
+        int var                 = SAT_VAR( solver->trail.items[i] );
+        solver->savedPhase[var] = solver->values[var] == 1;
+        solver->values[var]     = SAT_UNDEF;
+        solver->reason[var]     = -1;
+    }
+    solver->trail.count       = keep;
+    solver->trailLimits.count = targetLevel;
+    solver->propagateHead     = keep;
+}
+
+/** First-UIP conflict analysis; fills learnt (asserting literal first) and returns the backjump level. */
+static int SatAnalyze( SatSolver *solver, int conflict, IntVector *learnt ) {
+    int currentLevel = solver->trailLimits.count;
+    int pending      = 0;
+    int lit          = -1;
+    int index        = solver->trail.count - 1;
+
+    learnt->count = 0;
+    IntVectorPush( learnt, -1 );
+
+    do {
+        const int *lits = &solver->literals.items[solver->clauseStart.items[conflict]];
+        int        size = solver->clauseSize.items[conflict];
+        for ( int j = ( lit == -1 ) ? 0 : 1; j < size; ++j ) {
+            int var = SAT_VAR( lits[j] );
+            if ( solver->seen[var] || solver->level[var] == 0 ) continue;
+            solver->seen[var] = true;
+            SatBumpActivity( solver, var );
+            if ( solver->level[var] >= currentLevel ) pending++;
+            else IntVectorPush( learnt, lits[j] );
+        }
+        while ( !solver->seen[SAT_VAR( solver->trail.items[index] )] ) { index--; }
+        lit                         = solver->trail.items[index--];
+        conflict                    = solver->reason[SAT_VAR( lit )];
+        solver->seen[SAT_VAR( lit )] = false;
+        pending--;
+    } while ( pending > 0 );
+    learnt->items[0] = lit ^ 1;
+
+    int backjumpLevel = 0;
+    for ( int i = 1; i < learnt->count; ++i ) {
+        int var           = SAT_VAR( learnt->items[i] );
+        solver->seen[var] = false;
+        if ( solver->level[var] > backjumpLevel ) {
+            backjumpLevel     = solver->level[var];
+            int swap          = learnt->items[1];
+            learnt->items[1]  = learnt->items[i];
+            learnt->items[i]  = swap;
+        }
+    }
+    solver->activityIncrement *= 1.05;
+    return backjumpLevel;
+}
+
+static SatResult SatSolve( SatSolver *solver, int maxConflicts ) {
+    if ( !solver->ok ) return SAT_UNSATISFIABLE;
+
+    for ( int c = 0; c < solver->clauseStart.count; ++c ) {
+        if ( solver->clauseSize.items[c] != 1 ) continue;
+        int lit   = solver->literals.items[solver->clauseStart.items[c]];
+        int value = SatLiteralValue( solver, lit );
+        if ( value == 0 ) return SAT_UNSATISFIABLE;
+        if ( value == SAT_UNDEF ) SatAssign( solver, lit, c );
+    }
+
+    IntVector learnt        = { 0 };
+    int       conflicts     = 0;
+    int       restartLimit  = 100;
+    int       sinceRestart  = 0;
+    SatResult result        = SAT_UNKNOWN;
+
+    for ( ;; ) {
+        int conflict = SatPropagate( solver );
+        if ( conflict != -1 ) {
+            if ( solver->trailLimits.count == 0 ) {
+                result = SAT_UNSATISFIABLE;
+                break;
+            }
+            if ( ++conflicts > maxConflicts ) break;
+            sinceRestart++;
+
+            int backjumpLevel = SatAnalyze( solver, conflict, &learnt );
+            SatBacktrack( solver, backjumpLevel );
+            int clause = solver->clauseStart.count;
+            if ( !SatAttachClause( solver, learnt.items, learnt.count ) ) break;
+            SatAssign( solver, learnt.items[0], clause );
+            continue;
+        }
+
+        if ( sinceRestart >= restartLimit ) {
+            SatBacktrack( solver, 0 );
+            sinceRestart  = 0;
+            restartLimit += restartLimit / 2;
+        }
+
+        int decision = -1;
+        for ( int v = 0; v < solver->varCount; ++v ) {
+            if ( solver->values[v] == SAT_UNDEF &&
+                 ( decision == -1 || solver->activity[v] > solver->activity[decision] ) ) {
+                decision = v;
+            }
+        }
+        if ( decision == -1 ) {
+            result = SAT_SATISFIABLE;
+            break;
+        }
+        IntVectorPush( &solver->trailLimits, solver->trail.count );
+        SatAssign( solver, SAT_LIT( decision, !solver->savedPhase[decision] ), -1 );
+    }
+
+    free( learnt.items );
+    return result;
+}
+
+/** Adds clauses for out == AND(ins) (isAnd) or out == OR(ins), over input literals. */
+static void SatEncodeGate( SatSolver *solver, int out, const int *ins, int count, bool isAnd ) {
+    int wide[MAX_INPUTS_PER_LOGIC_GATE + 1];
+    for ( int i = 0; i < count; ++i ) {
+        int pair[2] = { isAnd ? out ^ 1 : out, isAnd ? ins[i] : ins[i] ^ 1 };
+        SatAddClause( solver, pair, 2 );
+        wide[i] = isAnd ? ins[i] ^ 1 : ins[i];
+    }
+    wide[count] = isAnd ? out : out ^ 1;
+    SatAddClause( solver, wide, count + 1 );
+}
+
+/**
+ * Encodes out = table[i] as one clause per assignment of the connected inputs, i collecting the
+ * input at position j on bit pins[j]; unconnected pins contribute zeros.
+ */
+static void SatEncodeTable( SatSolver *solver, int out, const int *ins, const int *pins, int count, uint32_t table ) {
+    int clause[MAX_INPUTS_PER_LOGIC_GATE + 1];
+    for ( int assignment = 0; assignment < 1 << count; ++assignment ) {
+        int index = 0;
+        for ( int j = 0; j < count; ++j ) {
+            bool high = ( assignment >> j ) & 1;
+            clause[j] = high ? ins[j] ^ 1 : ins[j];
+            index    |= (int) high << pins[j];
+        }
+        clause[count] = ( table >> index ) & 1 ? out : out ^ 1;
+        SatAddClause( solver, clause, count + 1 );
+    }
+}
+
+/**
+ * Adds the clauses tying variable out to the element in slot, ins holding the literals of its
+ * connected inputs and pins their input positions. Switches and buttons stay free; a sensor's own
+ * output is low, its trigger being encoded by the caller.
+ */
+static void SatEncodeElement(
+  SatSolver *solver, const SimulatorState *simulatorState, int slot, int out, const int *ins, const int *pins, int count
+) {
+    const ElementStore *store    = &simulatorState->elements;
+    int                 constant = -1;
+
+    switch ( store->types[slot] ) {
+        case ELEMENT_SOURCE: constant = 1; break;
+
+        case ELEMENT_BUTTON:
+        case ELEMENT_SWITCH: break;
+
+        case ELEMENT_SENSOR: constant = 0; break;
+
+        case ELEMENT_AND:
+            if ( count >= 2 ) SatEncodeGate( solver, out, ins, count, true );
+            else constant = 0;
+            break;
+
+        case ELEMENT_OR:
+        case ELEMENT_BUS:
+            SatEncodeGate( solver, out, ins, count, false );
+            break;
+
+        case ELEMENT_NOT:
+            if ( count > 0 ) SatEncodeGate( solver, out ^ 1, ins, count, false );
+            else constant = 0;
+            break;
+
+        case ELEMENT_MODULE:
+            SatEncodeTable( solver, out, ins, pins, count, simulatorState->modules[store->modules[slot]].truthTable );
+            break;
+
+        default: constant = TestElementBit( store->outputBits, slot ) ? 1 : 0; break;
+    }
+    if ( constant != -1 ) {
+        int unit = constant ? out : out ^ 1;
+        SatAddClause( solver, &unit, 1 );
+    }
+}
+
+/** Grows the witness origin arrays to originCount entries; returns false if memory ran out. */
+static bool ReserveWitnessOrigins( StateWitness *witness, int originCount ) {
+    if ( originCount > witness->originCapacity ) {
+        int  *ids    = realloc( witness->originIds, (size_t) originCount * sizeof( int ) );
+        if ( ids != NULL ) witness->originIds = ids;
+        bool *values = realloc( witness->originValues, (size_t) originCount * sizeof( bool ) );
+        if ( values != NULL ) witness->originValues = values;
+        if ( ids != NULL && values != NULL ) witness->originCapacity = originCount;
+    }
+    if ( originCount <= witness->originCapacity ) return true;
+
+    TraceLog( LOG_WARNING, "SERVER: Specific-state solver ran out of memory" );
+    return false;
+}
+
+bool Server_SolveSpecificState( SimulatorState *simulatorState, uint64_t sensorPattern, StateWitness *witness ) {
+    if ( simulatorState == NULL || witness == NULL ) return false;
+
+    int elementCount           = simulatorState->elementCount;
+    witness->sensorPattern     = sensorPattern;
+    witness->terminalKey       = 0;
+    witness->isSatisfiable     = false;
+    witness->isValid           = true;
+    witness->originCount       = 0;
+
+    EnsureEvaluationPlan( simulatorState );
+    const AndInverterGraph *aig         = &simulatorState->evaluationPlan.aig;
+    const ElementStore     *store       = &simulatorState->elements;
+    int                    *triggers    = malloc( ( (size_t) elementCount + 1 ) * sizeof( int ) );
+    int                     sensorCount = 0;
+    for ( int i = 0; i < elementCount && triggers != NULL; ++i ) {
+        if ( IsActiveElementOfType( store, i, ELEMENT_SENSOR ) ) triggers[sensorCount++] = aig->triggerLiterals[i];
+    }
+
+    // Only the graph's cone of the sensor triggers is encoded, variable r being row r.
+    SatSolver solver   = { 0 };
+    AigCone   cone     = { 0 };
+    bool      prepared = triggers != NULL && CollectAigCone( aig, triggers, sensorCount, &cone );
+    if ( prepared ) prepared = SatInit( &solver, cone.rowCount );
+    if ( !prepared ) {
+        SatFree( &solver );
+        AigConeFree( &cone );
+        free( triggers );
+        TraceLog( LOG_WARNING, "SERVER: Specific-state solver ran out of memory" );
+        return false;
+    }
+
+    // Row 0 is low. Switches and buttons stay free, other inputs hold their outputs, and a state
+    // input equals its next-state literal, which puts every feedback loop at a fixed point.
+    int low = SAT_LIT( 0, true );
+    SatAddClause( &solver, &low, 1 );
+    for ( int r = 1; r < cone.rowCount; ++r ) {
+        int out = SAT_LIT( r, false );
+        if ( r > cone.inputCount ) {
+            SatEncodeGate( &solver, out, cone.fanins[r], 2, true );
+            continue;
+        }
+
+        int     slot = aig->nodeSlots[cone.nodes[r]];
+        uint8_t type = store->types[slot];
+        if ( aig->nextLiterals[slot] != -1 ) {
+            int next = AigConeLiteral( &cone, aig->nextLiterals[slot] );
+            SatEncodeGate( &solver, out, &next, 1, false );
+        } else if ( type != ELEMENT_SWITCH && type != ELEMENT_BUTTON ) {
+            int unit = TestElementBit( store->outputBits, slot ) ? out : out ^ 1;
+            SatAddClause( &solver, &unit, 1 );
+        }
+    }
+    for ( int s = 0; s < sensorCount; ++s ) {
+        bool required = s < 64 && ( ( sensorPattern >> s ) & 1 );
+        int  trigger  = AigConeLiteral( &cone, triggers[s] );
+        int  unit     = required ? trigger : trigger ^ 1;
+        SatAddClause( &solver, &unit, 1 );
+    }
+
+    SatResult result = SatSolve( &solver, SAT_MAX_CONFLICTS );
+    if ( result == SAT_SATISFIABLE ) {
+        int originCount = Server_CollectOriginSlots( simulatorState, NULL, 0 );
+        if ( ReserveWitnessOrigins( witness, originCount ) ) {
+            for ( int i = 0; i < elementCount; ++i ) {
+                uint8_t type = store->types[i];
+                if ( ( type != ELEMENT_SWITCH && type != ELEMENT_BUTTON ) || !TestElementBit( store->activeBits, i ) ) {
+                    continue;
+                }
+                // An origin outside the cone affects no sensor; it is left low.
+                int row = cone.rowOfNode[aig->outputLiterals[i] >> 1];
+                witness->originIds[witness->originCount]    = store->ids[i];
+                witness->originValues[witness->originCount] = row > 0 && solver.values[row] == 1;
+                witness->originCount++;
+            }
+            witness->isSatisfiable = true;
+        }
+    } else if ( result == SAT_UNKNOWN ) {
+        TraceLog( LOG_WARNING, "SERVER: Specific-state solver gave up after %d conflicts", SAT_MAX_CONFLICTS );
+    }
+
+    SatFree( &solver );
+    AigConeFree( &cone );
+    free( triggers );
+    return witness->isSatisfiable;
+}
+
+static int CompareInts( const void *a, const void *b ) {
+    int x = *(const int *) a;
+    int y = *(const int *) b;
+    return ( x > y ) - ( x < y );
+}
+
+/**
+ * Fills slice with the fan-in of the terminal slots. A breadth-first walk over the fan-in rows
+ * reaches every slot that can affect a terminal; since a feedback loop is reached whole, the
+ * reached slots are exactly the members of their components, which are then listed in plan order
+ * and renumbered to rows.
+ */
+static void BuildConeSlice( SimulatorState *simulatorState, ConeSlice *slice, const int *terminalSlots, int terminalCount ) {
+    const EvaluationPlan *plan    = &simulatorState->evaluationPlan;
+    const ElementStore   *store   = &simulatorState->elements;
+    int                  *rows    = plan->sliceRows;
+    int                  *queue   = plan->sliceQueue;
+    int                   reached = 0;
+
+    for ( int t = 0; t < terminalCount; ++t ) {
+        if ( rows[terminalSlots[t]] != -1 ) continue;
+        rows[terminalSlots[t]] = 0;
+        queue[reached++]       = terminalSlots[t];
+    }
+    for ( int head = 0; head < reached; ++head ) {
+        int slot = queue[head];
+        for ( int f = plan->faninStart[slot]; f < plan->faninStart[slot + 1]; ++f ) {
+            int source = plan->faninSources[f];
+            if ( rows[source] != -1 ) continue;
+            rows[source]     = 0;
+            queue[reached++] = source;
+        }
+    }
+
+    Arena *arena    = &slice->arena;
+    size_t rowCount = (size_t) reached;
+    arena_reset( arena );
+    slice->terminalSlots = arena_alloc( arena, (size_t) terminalCount * sizeof( int ) );
+    slice->terminalRows  = arena_alloc( arena, (size_t) terminalCount * sizeof( int ) );
+    slice->members       = arena_alloc( arena, rowCount * sizeof( int ) );
+    slice->inputs        = arena_alloc( arena, rowCount * sizeof( *slice->inputs ) );
+    slice->originOfRow   = arena_alloc( arena, rowCount * sizeof( int ) );
+    slice->originRows    = arena_alloc( arena, rowCount * sizeof( int ) );
+    slice->groupStart    = arena_alloc( arena, ( rowCount + 1 ) * sizeof( int ) );
+    slice->groupCyclic   = arena_alloc( arena, rowCount * sizeof( bool ) );
+
+    // Each component is entered once, through its first member, and the component indices are
+    // sorted into plan order before groupStart is overwritten with member offsets.
+    slice->groupCount = 0;
+    for ( int i = 0; i < reached; ++i ) {
+        int component = plan->componentOf[queue[i]];
+        if ( plan->order[plan->componentStart[component]] == queue[i] ) slice->groupStart[slice->groupCount++] = component;
+    }
+    qsort( slice->groupStart, (size_t) slice->groupCount, sizeof( int ), CompareInts );
+
+    slice->memberCount = 0;
+    for ( int g = 0; g < slice->groupCount; ++g ) {
+        int component         = slice->groupStart[g];
+        slice->groupStart[g]  = slice->memberCount;
+        slice->groupCyclic[g] = plan->componentCyclic[component];
+        for ( int j = plan->componentStart[component]; j < plan->componentStart[component + 1]; ++j ) {
+            rows[plan->order[j]]                 = slice->memberCount;
+            slice->members[slice->memberCount++] = plan->order[j];
+        }
+    }
+    slice->groupStart[slice->groupCount] = slice->memberCount;
+
+    slice->originCount = 0;
+    slice->sourceCount = 0;
+    for ( int r = 0; r < slice->memberCount; ++r ) {
+        int     slot = slice->members[r];
+        uint8_t type = store->types[slot];
+        for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) {
+            int input           = plan->inputSlots[slot][k];
+            slice->inputs[r][k] = input < 0 ? -1 : rows[input];
+        }
+        slice->originOfRow[r] = -1;
+        if ( type == ELEMENT_SWITCH || type == ELEMENT_BUTTON ) slice->originRows[slice->originCount++] = slot;
+        if ( type == ELEMENT_SOURCE ) slice->sourceCount++;
+    }
+
+    // Origins are numbered in slot order, matching Server_CollectOriginSlots on the canvas.
+    qsort( slice->originRows, (size_t) slice->originCount, sizeof( int ), CompareInts );
+    for ( int o = 0; o < slice->originCount; ++o ) {
+        slice->originRows[o]                     = rows[slice->originRows[o]];
+        slice->originOfRow[slice->originRows[o]] = o;
+    }
+    for ( int t = 0; t < terminalCount; ++t ) {
+        slice->terminalSlots[t] = terminalSlots[t];
+        slice->terminalRows[t]  = rows[terminalSlots[t]];
+    }
+    slice->terminalCount = terminalCount;
+
+    for ( int r = 0; r < slice->memberCount; ++r ) { rows[slice->members[r]] = -1; }
+    slice->capability = (CapabilityReport) { 0 };
+}
+
+ConeSlice *Server_SliceCone( SimulatorState *simulatorState, const int *terminalIds, int terminalCount ) {
+    if ( simulatorState == NULL || terminalIds == NULL || terminalCount <= 0 || terminalCount > CAPABILITY_MAX_SENSORS ) {
+        return NULL;
+    }
+
+    EnsureEvaluationPlan( simulatorState );
+
+    int      terminalSlots[CAPABILITY_MAX_SENSORS];
+    uint64_t key = 0;
+    for ( int t = 0; t < terminalCount; ++t ) {
+        terminalSlots[t] = Server_FindElementSlot( simulatorState, terminalIds[t] );
+        if ( terminalSlots[t] < 0 ) {
+            TraceLog( LOG_WARNING, "SERVER: Cannot slice the fan-in of missing element %d", terminalIds[t] );
+            return NULL;
+        }
+        key = MixHash64( key ^ SignalSlotKey( terminalSlots[t] ) );
+    }
+    if ( key == 0 ) key = 1;
+
+    // A hit refreshes the entry; a miss rebuilds a free entry or else the least recently used one.
+    unsigned int clock = ++simulatorState->coneSliceClock;
+    ConeSlice   *slice = NULL;
+    for ( int i = 0; i < simulatorState->coneSliceCount; ++i ) {
+        ConeSlice *cached = &simulatorState->coneSlices[i];
+        if ( cached->terminalKey == key && cached->terminalCount == terminalCount &&
+             memcmp( cached->terminalSlots, terminalSlots, (size_t) terminalCount * sizeof( int ) ) == 0 ) {
+            cached->lastUsed = clock;
+            return cached;
+        }
+        if ( slice == NULL || cached->lastUsed < slice->lastUsed ) slice = cached;
+    }
+    if ( simulatorState->coneSliceCount < MAX_CONE_SLICES ) {
+        slice = &simulatorState->coneSlices[simulatorState->coneSliceCount++];
+    }
+
+    BuildConeSlice( simulatorState, slice, terminalSlots, terminalCount );
+    slice->terminalKey = key;
+    slice->generation  = simulatorState->evaluationPlan.generation;
+    slice->lastUsed    = clock;
+    return slice;
+}
+
+/** True if slice was built against the current plan, which is recompiled first if needed. */
+static bool IsSliceCurrent( SimulatorState *simulatorState, const ConeSlice *slice ) {
+    EnsureEvaluationPlan( simulatorState );
+    if ( slice->terminalKey != 0 && slice->generation == simulatorState->evaluationPlan.generation ) return true;
+
+    TraceLog( LOG_WARNING, "SERVER: Fan-in slice is stale; the topology changed since it was built" );
+    return false;
+}
+
+bool Server_SimulateSliceLanes(
+  SimulatorState *simulatorState, ConeSlice *slice, const uint64_t *originWords, int laneWords, uint64_t *memberWords
+) {
+    if ( simulatorState == NULL || slice == NULL || memberWords == NULL || laneWords <= 0 ) return false;
+    if ( !IsSliceCurrent( simulatorState, slice ) || ( slice->originCount > 0 && originWords == NULL ) ) return false;
+
+    LaneSweep sweep = SliceLaneSweep( slice );
+    SimulateLaneRows( simulatorState, &sweep, originWords, laneWords, memberWords );
+    return true;
+}
+
+const CapabilityReport *Server_AnalyzeSliceCapability( SimulatorState *simulatorState, ConeSlice *slice ) {
+    if ( simulatorState == NULL || slice == NULL || !IsSliceCurrent( simulatorState, slice ) ) return NULL;
+
+    CapabilityReport *report = &slice->capability;
+    if ( report->isValid ) return report;
+
+    if ( slice->originCount > CAPABILITY_MAX_ORIGINS ) {
+        // The BDD engine works on the And-Inverter Graph's cone of the terminals, which covers
+        // the same fan-in as the slice.
+        AnalyzeSymbolicTerminals( simulatorState, slice->terminalSlots, slice->terminalCount, report );
+    } else {
+        *report             = (CapabilityReport) { 0 };
+        report->sensorCount = slice->terminalCount;
+        report->originCount = slice->originCount;
+        report->vectorCount = (uint64_t) 1 << slice->originCount;
+        report->isExact     = true;
+        report->isValid     = true;
+        LaneSweep sweep     = SliceLaneSweep( slice );
+        EnumerateTerminalPatterns( simulatorState, &sweep, slice->terminalRows, slice->terminalCount, report );
+    }
+
+    int originPoints    = slice->originCount + slice->sourceCount;
+    report->originCount = slice->originCount;
+    report->vectorCount = SaturatingShift( 1, slice->originCount );
+    report->efficiency  = report->isExact && originPoints > 0 ? (float) report->uniqueStateCount / (float) originPoints
+                                                              : 0.0f;
+    return report;
+}
+
+bool Server_SolveSliceState(
+  SimulatorState *simulatorState, ConeSlice *slice, uint64_t terminalPattern, StateWitness *witness
+) {
+    if ( simulatorState == NULL || slice == NULL || witness == NULL || !IsSliceCurrent( simulatorState, slice ) ) {
+        return false;
+    }
+
+    witness->sensorPattern = terminalPattern;
+    witness->terminalKey   = slice->terminalKey;
+    witness->isSatisfiable = false;
+    witness->isValid       = true;
+    witness->originCount   = 0;
+
+    // Variable r is the output of member row r; memberCount + t is the trigger of terminal t.
+    const ElementStore *store       = &simulatorState->elements;
+    int                 memberCount = slice->memberCount;
+    SatSolver           solver;
+    if ( !SatInit( &solver, memberCount + slice->terminalCount ) ) {
+        SatFree( &solver );
+        TraceLog( LOG_WARNING, "SERVER: Specific-state solver ran out of memory" );
+        return false;
+    }
+
+    for ( int r = 0; r < memberCount; ++r ) {
+        int ins[MAX_INPUTS_PER_LOGIC_GATE];
+        int pins[MAX_INPUTS_PER_LOGIC_GATE];
+        int count = 0;
+        for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) {
+            if ( slice->inputs[r][k] < 0 ) continue;
+            pins[count]  = k;
+            ins[count++] = SAT_LIT( slice->inputs[r][k], false );
+        }
+        SatEncodeElement( &solver, simulatorState, slice->members[r], SAT_LIT( r, false ), ins, pins, count );
+    }
+
+    for ( int t = 0; t < slice->terminalCount; ++t ) {
+        int row   = slice->terminalRows[t];
+        int value = SAT_LIT( row, false );
+        if ( store->types[slice->members[row]] == ELEMENT_SENSOR ) {
+            int ins[MAX_INPUTS_PER_LOGIC_GATE];
+            int count = 0;
+            for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) {
+                if ( slice->inputs[row][k] >= 0 ) ins[count++] = SAT_LIT( slice->inputs[row][k], false );
+            }
+            value = SAT_LIT( memberCount + t, false );
+            SatEncodeGate( &solver, value, ins, count, false );
+        }
+        int unit = ( terminalPattern >> t ) & 1 ? value : value ^ 1;
+        SatAddClause( &solver, &unit, 1 );
+    }
+
+    SatResult result = SatSolve( &solver, SAT_MAX_CONFLICTS );
+    if ( result == SAT_SATISFIABLE && ReserveWitnessOrigins( witness, slice->originCount ) ) {
+        for ( int o = 0; o < slice->originCount; ++o ) {
+            int row                  = slice->originRows[o];
+            witness->originIds[o]    = store->ids[slice->members[row]];
+            witness->originValues[o] = solver.values[row] == 1;
+        }
+        witness->originCount   = slice->originCount;
+        witness->isSatisfiable = true;
+    } else if ( result == SAT_UNKNOWN ) {
+        TraceLog( LOG_WARNING, "SERVER: Specific-state solver gave up after %d conflicts", SAT_MAX_CONFLICTS );
+    }
+
+    SatFree( &solver );
+    return witness->isSatisfiable;
+}
 
-    toElem->inputElementIDs[toInputSlot] = fromElementId;
-    if ( toElem->connectedInputCount < MAX_INPUTS_PER_LOGIC_GATE ) {
-        toElem->connectedInputCount++;
+/** Transposes a 64x64 bit matrix in place: bit j of word i trades places with bit i of word j. */
+static void TransposeBits64( uint64_t *matrix ) {
+    uint64_t mask = 0x00000000FFFFFFFFull;
+    for ( int width = 32; width > 0; width >>= 1, mask ^= mask << width ) {
+        for ( int i = 0; i < 64; i = ( ( i | width ) + 1 ) & ~width ) {
+            uint64_t swap      = ( ( matrix[i] >> width ) ^ matrix[i + width] ) & mask;
+            matrix[i]         ^= swap << width;
+            matrix[i + width] ^= swap;
+        }
     }
+}
 
-    TraceLog(
-      LOG_INFO,
-      "SERVER: Created connection from %d to element %d (slot %d). "
-      "Total connections: %d",
-      fromElementId, toElementId, toInputSlot, simulatorState->connectionCount
-    );
-    return true;
+typedef struct VectorJob {
+    const SimulatorState *simulatorState;
+    const LaneSweep      *sweep;
+    const int            *terminalRows;    ///< As CapabilityJob.terminalRows.
+    int                   terminalCount;
+    const int            *sweepOrigins;    ///< Canvas origin index of each sweep origin, ascending.
+    int                   sweepOriginCount;
+    const uint64_t       *originBits;      ///< Caller's vectors, originStride words each.
+    size_t                originStride;
+    uint64_t             *patterns;        ///< Caller's output, one word per vector.
+    size_t                vectorCount;
+    int                   chunkWords;
+    int                   chunkCount;
+#if CAPABILITY_THREADED
+    atomic_int nextChunk;
+#else
+    int nextChunk;
+#endif
+} VectorJob;
+
+typedef struct VectorWorker {
+    VectorJob *job;
+    bool       succeeded;
+} VectorWorker;
+
+static int ClaimVectorChunk( VectorJob *job ) {
+#if CAPABILITY_THREADED
+    return atomic_fetch_add( &job->nextChunk, 1 );
+#else
+    return job->nextChunk++;
+#endif
 }
 
-void Server_Init( SimulatorState *simulatorState ) {
-    if ( simulatorState == NULL ) return;
+/**
+ * Streams chunks of the caller's vectors through the sweep. Each group of 64 vectors is turned
+ * into origin lane words one 64-origin block at a time, and the terminal lane words are turned
+ * back into one pattern per vector the same way.
+ */
+static void *RunVectorWorker( void *argument ) {
+    VectorWorker         *worker         = argument;
+    VectorJob            *job            = worker->job;
+    const SimulatorState *simulatorState = job->simulatorState;
+    const LaneSweep      *sweep          = job->sweep;
+    size_t                originRows     = job->sweepOriginCount > 0 ? (size_t) job->sweepOriginCount : 1;
+    size_t                rows           = sweep->rowCount > 0 ? (size_t) sweep->rowCount : 1;
+    uint64_t             *originWords    = malloc( originRows * (size_t) job->chunkWords * sizeof( uint64_t ) );
+    uint64_t             *rowWords       = malloc( rows * (size_t) job->chunkWords * sizeof( uint64_t ) );
 
-    srand( (unsigned int) time( NULL ) );
+    worker->succeeded = ( originWords != NULL && rowWords != NULL );
 
-    simulatorState->elementCount  = 0;
-    simulatorState->nextElementId = 1;
-    simulatorState->connectionCount = 0;
+    for ( int chunk = ClaimVectorChunk( job ); worker->succeeded && chunk < job->chunkCount;
+          chunk = ClaimVectorChunk( job ) ) {
+        size_t firstVector = (size_t) chunk * (size_t) job->chunkWords * SIGNAL_LANES_PER_WORD;
+        size_t remaining   = job->vectorCount - firstVector;
+        int    words       = (int) ( remaining < (size_t) job->chunkWords * SIGNAL_LANES_PER_WORD
+                                       ? ( remaining + SIGNAL_LANES_PER_WORD - 1 ) / SIGNAL_LANES_PER_WORD
+                                       : (size_t) job->chunkWords );
+        uint64_t matrix[64];
+
+        for ( int w = 0; w < words; ++w ) {
+            size_t          vector = firstVector + (size_t) w * SIGNAL_LANES_PER_WORD;
+            int             lanes  = job->vectorCount - vector < SIGNAL_LANES_PER_WORD ? (int) ( job->vectorCount - vector )
+                                                                                   : SIGNAL_LANES_PER_WORD;
+            const uint64_t *bits   = job->originBits + vector * job->originStride;
+            for ( int o = 0; o < job->sweepOriginCount; ) {
+                int block = job->sweepOrigins[o] >> 6;
+                for ( int b = 0; b < 64; ++b ) { matrix[b] = b < lanes ? bits[(size_t) b * job->originStride + block] : 0; }
+                TransposeBits64( matrix );
+                for ( ; o < job->sweepOriginCount && job->sweepOrigins[o] >> 6 == block; ++o ) {
+                    originWords[(size_t) o * words + w] = matrix[job->sweepOrigins[o] & 63];
+                }
+            }
+        }
 
-    for ( int i = 0; i < MAX_ELEMENTS_ON_CANVAS; ++i ) {
-        simulatorState->elementsOnCanvas[i].isActive            = false;
-        simulatorState->elementsOnCanvas[i].type                = ELEMENT_NONE;
-        simulatorState->elementsOnCanvas[i].outputState         = false;
-        simulatorState->elementsOnCanvas[i].defaultOutputState  = false;
-        simulatorState->elementsOnCanvas[i].connectedInputCount = 0;
-        simulatorState->elementsOnCanvas[i].id                  = -1;
-        simulatorState->elementsOnCanvas[i].canvasPosition      = (Vector2) { 0, 0 };
-        for ( int j = 0; j < MAX_INPUTS_PER_LOGIC_GATE; ++j ) {
-            simulatorState->elementsOnCanvas[i].inputElementIDs[j] = -1;
-            simulatorState->elementsOnCanvas[i].actualInputStates[j] = false;
+        if ( sweep->graph != NULL ) SimulateAigRows( simulatorState, sweep, originWords, words, rowWords );
+        else SimulateLaneRows( simulatorState, sweep, originWords, words, rowWords );
+
+        for ( int w = 0; w < words; ++w ) {
+            size_t vector = firstVector + (size_t) w * SIGNAL_LANES_PER_WORD;
+            int    lanes  = job->vectorCount - vector < SIGNAL_LANES_PER_WORD ? (int) ( job->vectorCount - vector )
+                                                                          : SIGNAL_LANES_PER_WORD;
+            for ( int t = 0; t < 64; ++t ) {
+                matrix[t] = t < job->terminalCount
+                              ? TerminalLaneWord( simulatorState, sweep, rowWords, words, w, job->terminalRows[t] )
+                              : 0;
+            }
+            TransposeBits64( matrix );
+            memcpy( job->patterns + vector, matrix, (size_t) lanes * sizeof( uint64_t ) );
         }
     }
 
-    simulatorState->handCardCount    = 0;
-    simulatorState->deckCardCount    = 0;
-    simulatorState->currentDeckIndex = 0;
-    simulatorState->discardCardCount = 0;
+    free( originWords );
+    free( rowWords );
+    return NULL;
+}
 
-    Card buttonCard         = CreateElementCard( 1, "Button", ELEMENT_BUTTON );
-    Card switchCard         = CreateElementCard( 2, "Switch", ELEMENT_SWITCH );
-    Card andGateCard        = CreateElementCard( 3, "AND Gate", ELEMENT_AND );
-    Card orGateCard         = CreateElementCard( 4, "OR Gate", ELEMENT_OR );
-    Card sourceCard         = CreateElementCard( 5, "Source", ELEMENT_SOURCE );
-    Card sensorCard         = CreateElementCard( 6, "Sensor", ELEMENT_SENSOR );
+bool Server_SimulateVectors(
+  SimulatorState *simulatorState, const int *terminalIds, int terminalCount, const uint64_t *originBits,
+  size_t vectorCount, uint64_t *patterns
+) {
+    if ( simulatorState == NULL || ( patterns == NULL && vectorCount > 0 ) ) return false;
+    if ( terminalIds != NULL && ( terminalCount <= 0 || terminalCount > CAPABILITY_MAX_SENSORS ) ) return false;
 
-    Card requisitionCard    = Server_CreateActionCard( 7, "Requisition", ACTION_REQUISITION );
-    Card reOrgCard          = Server_CreateActionCard( 8, "Re-Org", ACTION_RE_ORG );
+    EnsureEvaluationPlan( simulatorState );
 
-    int  deckIdx            = 0;
+    const AndInverterGraph *aig          = &simulatorState->evaluationPlan.aig;
+    const ElementStore     *store        = &simulatorState->elements;
+    int                     elementCount = simulatorState->elementCount;
+    int                     originCount  = Server_CollectOriginSlots( simulatorState, NULL, 0 );
+    size_t                  chunkCount   = ( vectorCount + CAPABILITY_CHUNK_WORDS * SIGNAL_LANES_PER_WORD - 1 ) /
+                                           ( CAPABILITY_CHUNK_WORDS * SIGNAL_LANES_PER_WORD );
+    int                     terminalSlots[CAPABILITY_MAX_SENSORS];
+    int                     terminalRows[CAPABILITY_MAX_SENSORS];
+    if ( vectorCount == 0 ) return true;
+    if ( originCount > 0 && originBits == NULL ) return false;
+    if ( chunkCount > (size_t) INT_MAX / CAPABILITY_CHUNK_WORDS ) {
+        TraceLog( LOG_WARNING, "SERVER: Too many vectors for one simulation batch" );
+        return false;
+    }
 
-    for ( int type = 0; type < 6; ++type ) {
-        int cardCount = ( type < 4 ) ? 4 : 2;
-        for ( int i = 0; i < cardCount; ++i ) {
-            if ( deckIdx >= MAX_CARDS_IN_DECK ) break;
-            switch ( type ) {
-                case 0: simulatorState->userDeck[deckIdx++] = buttonCard; break;
-                case 1: simulatorState->userDeck[deckIdx++] = switchCard; break;
-                case 2: simulatorState->userDeck[deckIdx++] = andGateCard; break;
-                case 3: simulatorState->userDeck[deckIdx++] = orGateCard; break;
-                case 4: simulatorState->userDeck[deckIdx++] = sourceCard; break;
-                case 5: simulatorState->userDeck[deckIdx++] = sensorCard; break;
+    // Without terminal IDs the terminals are the sensors, in slot order.
+    if ( terminalIds == NULL ) {
+        terminalCount = 0;
+        for ( int i = 0; i < elementCount; ++i ) {
+            if ( !IsActiveElementOfType( store, i, ELEMENT_SENSOR ) ) continue;
+            if ( terminalCount == CAPABILITY_MAX_SENSORS ) {
+                TraceLog( LOG_WARNING, "SERVER: Vector simulation supports at most %d sensors", CAPABILITY_MAX_SENSORS );
+                return false;
             }
+            terminalSlots[terminalCount++] = i;
         }
-        if ( deckIdx >= MAX_CARDS_IN_DECK ) break;
     }
-
-    for ( int i = 0; i < 3 && deckIdx < MAX_CARDS_IN_DECK; ++i ) {
-        simulatorState->userDeck[deckIdx++] = requisitionCard;
+    for ( int t = 0; t < terminalCount && terminalIds != NULL; ++t ) {
+        terminalSlots[t] = Server_FindElementSlot( simulatorState, terminalIds[t] );
+        if ( terminalSlots[t] < 0 ) {
+            TraceLog( LOG_WARNING, "SERVER: Cannot simulate vectors on missing element %d", terminalIds[t] );
+            return false;
+        }
     }
-    for ( int i = 0; i < 2 && deckIdx < MAX_CARDS_IN_DECK; ++i ) {
-        simulatorState->userDeck[deckIdx++] = reOrgCard;
+
+    size_t slots       = (size_t) elementCount + 1;
+    int   *originSlots = malloc( slots * sizeof( int ) );
+    int   *originIndex = malloc( slots * sizeof( int ) );
+    int   *sweepOrigin = malloc( slots * sizeof( int ) );
+    int   *originOfRow = NULL;
+    if ( originSlots == NULL || originIndex == NULL || sweepOrigin == NULL ) {
+        free( originSlots );
+        free( originIndex );
+        free( sweepOrigin );
+        TraceLog( LOG_WARNING, "SERVER: Vector simulation ran out of memory" );
+        return false;
     }
+    Server_CollectOriginSlots( simulatorState, originSlots, elementCount );
+    for ( int i = 0; i < elementCount; ++i ) { originIndex[i] = -1; }
+    for ( int o = 0; o < originCount; ++o ) { originIndex[originSlots[o]] = o; }
 
-    simulatorState->deckCardCount = deckIdx;
-    if ( simulatorState->deckCardCount > 1 ) {
-        for ( int i = simulatorState->deckCardCount - 1; i > 0; i-- ) {
-            int  j                         = rand() % ( i + 1 );
-            Card temp                      = simulatorState->userDeck[i];
-            simulatorState->userDeck[i]    = simulatorState->userDeck[j];
-            simulatorState->userDeck[j]    = temp;
+    // The And-Inverter Graph's cone of the terminals is swept when no feedback loop is in it;
+    // otherwise the fan-in slice of the terminals is iterated element by element.
+    ConeSlice slice            = { 0 };
+    AigCone   cone             = { 0 };
+    LaneSweep sweep            = { 0 };
+    int       sweepOriginCount = 0;
+    for ( int t = 0; t < terminalCount; ++t ) {
+        int slot        = terminalSlots[t];
+        terminalRows[t] = store->types[slot] == ELEMENT_SENSOR ? aig->triggerLiterals[slot] : aig->outputLiterals[slot];
+    }
+    if ( CollectAigCone( aig, terminalRows, terminalCount, &cone ) && cone.stateCount == 0 ) {
+        originOfRow = malloc( (size_t) cone.rowCount * sizeof( int ) );
+    }
+    if ( originOfRow != NULL ) {
+        // Sweep origins are numbered in canvas origin order; originSlots is reused as a mark.
+        for ( int o = 0; o < originCount; ++o ) { originSlots[o] = -1; }
+        for ( int r = 1; r <= cone.inputCount; ++r ) {
+            int origin = originIndex[aig->nodeSlots[cone.nodes[r]]];
+            if ( origin >= 0 ) originSlots[origin] = 0;
         }
-        TraceLog( LOG_INFO, "SERVER: Initial deck shuffled." );
-    }    for ( int i = 0; i < 5; ++i ) { Server_UserDrawCard( simulatorState ); }
-
-    simulatorState->score               = 0;
-    simulatorState->simulationComplete  = false;
-    Server_LoadStarterScenario( simulatorState );
+        for ( int o = 0; o < originCount; ++o ) {
+            if ( originSlots[o] == -1 ) continue;
+            originSlots[o]                  = sweepOriginCount;
+            sweepOrigin[sweepOriginCount++] = o;
+        }
+        for ( int r = 1; r <= cone.inputCount; ++r ) {
+            int origin     = originIndex[aig->nodeSlots[cone.nodes[r]]];
+            originOfRow[r] = origin >= 0 ? originSlots[origin] : -1;
+        }
+        for ( int t = 0; t < terminalCount; ++t ) { terminalRows[t] = AigConeLiteral( &cone, terminalRows[t] ); }
+        sweep = (LaneSweep) { .originOfRow = originOfRow, .rowCount = cone.rowCount, .graph = &cone };
+    } else {
+        BuildConeSlice( simulatorState, &slice, terminalSlots, terminalCount );
+        for ( int o = 0; o < slice.originCount; ++o ) {
+            sweepOrigin[sweepOriginCount++] = originIndex[slice.members[slice.originRows[o]]];
+        }
+        for ( int t = 0; t < terminalCount; ++t ) { terminalRows[t] = slice.terminalRows[t]; }
+        sweep = SliceLaneSweep( &slice );
+    }
 
-    TraceLog(
-      LOG_INFO,
-      "SERVER_INIT_END: Score: %d, DeckCount: %d, CurrentDeckIdx: %d, "
-      "HandCount: %d, DiscardCount: %d",
-      simulatorState->score, simulatorState->deckCardCount, simulatorState->currentDeckIndex,
-      simulatorState->handCardCount, simulatorState->discardCardCount
-    );
-}
+    VectorJob job;
+    job.simulatorState   = simulatorState;
+    job.sweep            = &sweep;
+    job.terminalRows     = terminalRows;
+    job.terminalCount    = terminalCount;
+    job.sweepOrigins     = sweepOrigin;
+    job.sweepOriginCount = sweepOriginCount;
+    job.originBits       = originBits;
+    job.originStride     = (size_t) ELEMENT_BIT_WORDS( originCount );
+    job.patterns         = patterns;
+    job.vectorCount      = vectorCount;
+    job.chunkWords       = CAPABILITY_CHUNK_WORDS;
+    while ( job.chunkWords > 1 && (size_t) job.chunkWords * (size_t) sweep.rowCount > CAPABILITY_MAX_ROW_WORDS ) {
+        job.chunkWords /= 2;
+    }
+    size_t chunkVectors = (size_t) job.chunkWords * SIGNAL_LANES_PER_WORD;
+    job.chunkCount      = (int) ( ( vectorCount + chunkVectors - 1 ) / chunkVectors );
+#if CAPABILITY_THREADED
+    atomic_init( &job.nextChunk, 0 );
+#else
+    job.nextChunk = 0;
+#endif
 
-static void PropagateSignals( SimulatorState *simulatorState ) {
-    bool stateChanged  = true;
-    int  maxIterations = 10;
-    int  iteration     = 0;
-
-    while ( stateChanged && iteration < maxIterations ) {
-        stateChanged = false;
-        iteration++;
-
-        for ( int i = 0; i < simulatorState->elementCount; ++i ) {
-            if ( !simulatorState->elementsOnCanvas[i].isActive ) continue;
-
-            CircuitElement *elem          = &simulatorState->elementsOnCanvas[i];
-            bool            previousState = elem->outputState;
-
-            switch ( elem->type ) {
-                case ELEMENT_SOURCE : elem->outputState = true; break;
-
-                case ELEMENT_SENSOR : elem->outputState = false; break;
-
-                case ELEMENT_BUTTON:
-                case ELEMENT_SWITCH : break;                case ELEMENT_AND:
-                    {
-                        bool hasAllInputs  = false;
-                        bool allInputsHigh = true;
-
-                        // Count valid inputs and check if they're high
-                        for (int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k) {
-                            if (elem->inputElementIDs[k] != -1) {
-                                CircuitElement *inputElem = NULL;
-                                for (int j = 0; j < simulatorState->elementCount; ++j) {
-                                    if (simulatorState->elementsOnCanvas[j].isActive &&
-                                        simulatorState->elementsOnCanvas[j].id == elem->inputElementIDs[k]) {
-                                        inputElem = &simulatorState->elementsOnCanvas[j];
-                                        break;
-                                    }
-                                }
-                                if (inputElem) {
-                                    elem->actualInputStates[k] = inputElem->outputState;
-                                    if (!inputElem->outputState) {
-                                        allInputsHigh = false;
-                                    }
-                                    hasAllInputs = true;
-                                }
-                            }
-                        }
-
-                        // AND gate needs at least 2 inputs and all must be high
-                        elem->outputState = (hasAllInputs && elem->connectedInputCount >= 2 && allInputsHigh);
-                        break;
-                    }
+    int          workerCount = job.chunkCount < CAPABILITY_MAX_THREADS ? job.chunkCount : CAPABILITY_MAX_THREADS;
+    VectorWorker workers[CAPABILITY_MAX_THREADS];
+    for ( int t = 0; t < workerCount; ++t ) { workers[t] = (VectorWorker) { &job, false }; }
 
-                case ELEMENT_OR:
-                    {
-                        bool hasAnyInput  = false;
-                        bool anyInputHigh = false;
-
-                        for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) {
-                            if ( elem->inputElementIDs[k] != -1 ) {
-                                hasAnyInput                 = true;
-                                CircuitElement *inputElem = NULL;
-                                for ( int j = 0; j < simulatorState->elementCount; ++j ) {
-                                    if ( simulatorState->elementsOnCanvas[j].isActive &&
-                                         simulatorState->elementsOnCanvas[j].id ==
-                                           elem->inputElementIDs[k] ) {
-                                        inputElem = &simulatorState->elementsOnCanvas[j];
-                                        break;
-                                    }
-                                }
-                                if ( inputElem ) {
-                                    elem->actualInputStates[k] = inputElem->outputState;
-                                    if ( inputElem->outputState ) { anyInputHigh = true; }
-                                }
-                            }
-                        }
-
-                        elem->outputState = hasAnyInput && anyInputHigh;
-                        break;
-                    }
+#if CAPABILITY_THREADED
+    pthread_t threads[CAPABILITY_MAX_THREADS];
+    bool      started[CAPABILITY_MAX_THREADS] = { false };
+    for ( int t = 1; t < workerCount; ++t ) {
+        started[t] = pthread_create( &threads[t], NULL, RunVectorWorker, &workers[t] ) == 0;
+    }
+    RunVectorWorker( &workers[0] );
+    for ( int t = 1; t < workerCount; ++t ) {
+        if ( started[t] ) pthread_join( threads[t], NULL );
+        else workers[t].succeeded = true;
+    }
+#else
+    RunVectorWorker( &workers[0] );
+    for ( int t = 1; t < workerCount; ++t ) { workers[t].succeeded = true; }
+#endif
 
-                default: break;
-            }
+    bool succeeded = true;
+    for ( int t = 0; t < workerCount; ++t ) { succeeded = succeeded && workers[t].succeeded; }
+    if ( !succeeded ) TraceLog( LOG_WARNING, "SERVER: Vector simulation ran out of memory" );
 
-            if ( elem->outputState != previousState ) { stateChanged = true; }
-        }
-    }
+    arena_free( &slice.arena );
+    AigConeFree( &cone );
+    free( originOfRow );
+    free( originSlots );
+    free( originIndex );
+    free( sweepOrigin );
+    return succeeded;
+}
 
-    if ( iteration >= maxIterations && stateChanged ) {
-        TODO(
-          "Circuit oscillation detected or too complex - implement cycle "
-          "detection"
-        );
-    }
+void Server_SetPropagationMode( SimulatorState *simulatorState, PropagationMode mode ) {
+    if ( simulatorState == NULL || mode < 0 || mode >= PROPAGATION_MODE_COUNT ) return;
+    simulatorState->propagationMode        = mode;
+    simulatorState->evaluationPlan.isValid = false;
+    simulatorState->changeGeneration++;
+    TraceLog( LOG_INFO, "SERVER: Propagation mode set to %d", mode );
 }
 
 void Server_InitScenario( Scenario *scenario, const char *name, const char *description ) {
@@ -446,12 +5319,14 @@ void Server_InitScenario( Scenario *scenario, const char *name, const char *desc
 
     scenario->conditionCount                                   = 0;
     scenario->isCompleted                                      = false;
-    scenario->rewardScore                                      = 100;    for ( int i = 0; i < 8; ++i ) {
+    scenario->rewardScore                                      = 100;
+    scenario->dirtyConditions                                  = 0;    for ( int i = 0; i < 8; ++i ) {
         scenario->conditions[i].type           = CONDITION_MIN_ELEMENTS;
         scenario->conditions[i].elementType    = ELEMENT_NONE;
         scenario->conditions[i].targetValue    = 0;
         scenario->conditions[i].isMet          = false;
         scenario->conditions[i].description[0] = '\0';
+        scenario->conditions[i].terminalCount  = 0;
     }
 }
 
@@ -466,62 +5341,110 @@ bool Server_AddScenarioCondition(
     condition->elementType       = elementType;
     condition->targetValue       = targetValue;
     condition->isMet             = false;
+    condition->terminalCount     = 0;
     strncpy( condition->description, description, sizeof( condition->description ) - 1 );
     condition->description[sizeof( condition->description ) - 1] = '\0';
 
+    scenario->dirtyConditions |= 1u << scenario->conditionCount;
     scenario->conditionCount++;
     return true;
 }
 
+bool Server_SetConditionTerminals(
+  SimulatorState *simulatorState, int conditionIndex, const int *terminalIds, int terminalCount
+) {
+    if ( simulatorState == NULL ) return false;
+
+    Scenario *scenario = &simulatorState->currentScenario;
+    if ( conditionIndex < 0 || conditionIndex >= scenario->conditionCount ) return false;
+    if ( terminalCount < 0 || terminalCount > CONDITION_MAX_TERMINALS || ( terminalCount > 0 && terminalIds == NULL ) ) {
+        return false;
+    }
+
+    ScenarioCondition *condition = &scenario->conditions[conditionIndex];
+    for ( int t = 0; t < terminalCount; ++t ) { condition->terminalIds[t] = terminalIds[t]; }
+    condition->terminalCount   = terminalCount;
+    scenario->dirtyConditions |= 1u << conditionIndex;
+    simulatorState->changeGeneration++;
+    return true;
+}
+
+/** Capability a unique-states condition is checked against: its terminals' slice, or the canvas. */
+static const CapabilityReport *ConditionCapability( SimulatorState *simulatorState, const ScenarioCondition *condition ) {
+    if ( condition->terminalCount == 0 ) return Server_AnalyzeCapability( simulatorState );
+
+    ConeSlice *slice = Server_SliceCone( simulatorState, condition->terminalIds, condition->terminalCount );
+    return slice != NULL ? Server_AnalyzeSliceCapability( simulatorState, slice ) : NULL;
+}
+
 void Server_EvaluateScenario( SimulatorState *simulatorState ) {
     if ( simulatorState == NULL ) return;
 
     Scenario *scenario         = &simulatorState->currentScenario;
     bool      allConditionsMet = true;
 
+    // Conditions only change with element counts or wiring, which mark them dirty.
+    if ( scenario->dirtyConditions == 0 ) return;
+
     for ( int i = 0; i < scenario->conditionCount; ++i ) {
         ScenarioCondition *condition = &scenario->conditions[i];
-        condition->isMet             = false;
+        if ( ( scenario->dirtyConditions & ( 1u << i ) ) == 0 ) {
+            if ( !condition->isMet ) { allConditionsMet = false; }
+            continue;
+        }
+        condition->isMet = false;
 
         switch ( condition->type ) {
             case CONDITION_MIN_ELEMENTS:
+            case CONDITION_MAX_ELEMENTS:
                 {
-                    int count = 0;
-                    for ( int j = 0; j < simulatorState->elementCount; ++j ) {
-                        if ( simulatorState->elementsOnCanvas[j].isActive &&
-                             simulatorState->elementsOnCanvas[j].type == condition->elementType ) {
-                            count++;
-                        }
-                    }
-                    condition->isMet = ( count >= condition->targetValue );
+                    int count = condition->elementType >= 0 && condition->elementType < ELEMENT_TYPE_COUNT
+                                ? simulatorState->elementTypeCounts[condition->elementType]
+                                : 0;
+                    condition->isMet = condition->type == CONDITION_MIN_ELEMENTS ? count >= condition->targetValue
+                                                                                 : count <= condition->targetValue;
                     break;
                 }
 
-            case CONDITION_MAX_ELEMENTS:
+            case CONDITION_MIN_UNIQUE_STATES:
                 {
-                    int count = 0;
-                    for ( int j = 0; j < simulatorState->elementCount; ++j ) {
-                        if ( simulatorState->elementsOnCanvas[j].isActive &&
-                             simulatorState->elementsOnCanvas[j].type == condition->elementType ) {
-                            count++;
-                        }
-                    }
-                    condition->isMet = ( count <= condition->targetValue );
+                    const CapabilityReport *report = ConditionCapability( simulatorState, condition );
+                    condition->isMet = report != NULL && report->isExact && report->uniqueStateCount >= condition->targetValue;
                     break;
                 }
 
-            case CONDITION_MIN_UNIQUE_STATES:
             case CONDITION_MAX_UNIQUE_STATES:
+                {
+                    const CapabilityReport *report = ConditionCapability( simulatorState, condition );
+                    condition->isMet = report != NULL && report->isExact && report->uniqueStateCount <= condition->targetValue;
+                    break;
+                }
+
             case CONDITION_SPECIFIC_STATE:
-                TODO( "Implement state-based scenario conditions" );
-                condition->isMet = false;
-                break;
+                {
+                    StateWitness *witness = &simulatorState->stateWitness;
+                    uint64_t      pattern = (uint64_t) (unsigned int) condition->targetValue;
+                    ConeSlice    *slice   = NULL;
+                    EnsureEvaluationPlan( simulatorState );
+                    if ( condition->terminalCount > 0 ) {
+                        slice = Server_SliceCone( simulatorState, condition->terminalIds, condition->terminalCount );
+                        if ( slice == NULL ) break;
+                    }
+                    uint64_t terminalKey = slice != NULL ? slice->terminalKey : 0;
+                    if ( !witness->isValid || witness->sensorPattern != pattern || witness->terminalKey != terminalKey ) {
+                        if ( slice != NULL ) Server_SolveSliceState( simulatorState, slice, pattern, witness );
+                        else Server_SolveSpecificState( simulatorState, pattern, witness );
+                    }
+                    condition->isMet = witness->isSatisfiable;
+                    break;
+                }
 
             default: condition->isMet = false; break;
         }
 
         if ( !condition->isMet ) { allConditionsMet = false; }
     }
+    scenario->dirtyConditions = 0;
 
     if ( allConditionsMet && !scenario->isCompleted ) {
         scenario->isCompleted     = true;
@@ -540,6 +5463,7 @@ void Server_LoadScenario( SimulatorState *simulatorState, ScenarioId scenarioId
     if ( simulatorState == NULL || scenarioId >= SCENARIO_COUNT ) return;
 
     simulatorState->currentScenarioId = scenarioId;
+    simulatorState->changeGeneration++;
 
     switch ( scenarioId ) {
         case SCENARIO_BASIC_CIRCUIT:
@@ -661,10 +5585,15 @@ void Server_ResetCurrentScenario( SimulatorState *simulatorState ) {
     if ( simulatorState == NULL ) return;
 
     for ( int i = 0; i < simulatorState->elementCount; ++i ) {
-        simulatorState->elementsOnCanvas[i].isActive = false;
+        AssignElementBit( simulatorState->elements.activeBits, i, false );
     }
     simulatorState->elementCount  = 0;
     simulatorState->connectionCount = 0;
+    simulatorState->freeConnection  = -1;
+    simulatorState->elements.freeSlotCount = 0;
+    simulatorState->evaluationPlan.isValid = false;
+    ElementIdMapClear( &simulatorState->elementIdMap );
+    memset( simulatorState->elementTypeCounts, 0, sizeof( simulatorState->elementTypeCounts ) );
 
     for ( int i = 0; i < simulatorState->discardCardCount; ++i ) {
         if ( simulatorState->handCardCount < MAX_CARDS_IN_HAND ) {
@@ -673,6 +5602,8 @@ void Server_ResetCurrentScenario( SimulatorState *simulatorState ) {
         }
     }
     simulatorState->discardCardCount = 0;
+    simulatorState->stateHash        = Server_ComputeStateHash( simulatorState );
+    simulatorState->changeGeneration++;
 
     Server_LoadScenario( simulatorState, simulatorState->currentScenarioId );
 
@@ -726,12 +5657,73 @@ Card Server_CreateActionCard( int id, const char *name, ActionCardType actionTyp
         case ACTION_PARTS_BIN:
             snprintf( card.description, sizeof( card.description ), "Copy an element in play." );
             break;
+        case ACTION_BLUEPRINT:
+            snprintf( card.description, sizeof( card.description ), "Save the newest circuit as a module." );
+            break;
+        case ACTION_SCHEMATIC:
+            snprintf( card.description, sizeof( card.description ), "Place a saved module." );
+            break;
         default: snprintf( card.description, sizeof( card.description ), "Unknown action." ); break;
     }
 
     return card;
 }
 
+/**
+ * Blueprint card. The client has no element selection, so the circuit saved is the fan-in of the
+ * newest element that can form a module: combinational, with one to MAX_INPUTS_PER_LOGIC_GATE
+ * switches and buttons.
+ */
+static bool SaveBlueprint( SimulatorState *simulatorState ) {
+    const ElementStore *store = &simulatorState->elements;
+    int                 tried = 0;
+
+    for ( int slot = simulatorState->elementCount - 1; slot >= 0 && tried < BLUEPRINT_MAX_CANDIDATES; --slot ) {
+        uint8_t type = store->types[slot];
+        if ( !Server_IsElementActive( simulatorState, slot ) || type == ELEMENT_SWITCH || type == ELEMENT_BUTTON ) continue;
+        tried++;
+
+        // Checked here as well, so candidates that cannot work are skipped without a warning.
+        int        id     = store->ids[slot];
+        ConeSlice *slice  = Server_SliceCone( simulatorState, &id, 1 );
+        bool       cyclic = false;
+        if ( slice == NULL || slice->originCount == 0 || slice->originCount > MAX_INPUTS_PER_LOGIC_GATE ) continue;
+        for ( int g = 0; g < slice->groupCount; ++g ) { cyclic |= slice->groupCyclic[g]; }
+        if ( cyclic ) continue;
+
+        int *memberIds = malloc( (size_t) slice->memberCount * sizeof( int ) );
+        if ( memberIds == NULL ) return false;
+        for ( int m = 0; m < slice->memberCount; ++m ) { memberIds[m] = store->ids[slice->members[m]]; }
+        char name[MODULE_NAME_LENGTH];
+        snprintf( name, sizeof( name ), "Blueprint %d", simulatorState->moduleCount + 1 );
+        int module = Server_DefineModule( simulatorState, name, memberIds, slice->memberCount, id );
+        free( memberIds );
+        if ( module != -1 ) return true;
+    }
+    TraceLog( LOG_INFO, "SERVER: Blueprint found no circuit in play that forms a module" );
+    return false;
+}
+
+/** Schematic card: places the newest module right of the canvas, on the newest element's row. */
+static bool PlaceSchematic( SimulatorState *simulatorState ) {
+    if ( simulatorState->moduleCount == 0 ) {
+        TraceLog( LOG_INFO, "SERVER: Schematic has no saved module to place" );
+        return false;
+    }
+
+    // Two cells right of every element, so the cell is always free.
+    Vector2 position = { 0, 0 };
+    bool    first    = true;
+    for ( int slot = 0; slot < simulatorState->elementCount; ++slot ) {
+        if ( !Server_IsElementActive( simulatorState, slot ) ) continue;
+        Vector2 at = simulatorState->elements.positions[slot];
+        if ( first || at.x + 2 > position.x ) position.x = at.x + 2;
+        position.y = at.y;
+        first      = false;
+    }
+    return Server_PlaceModule( simulatorState, simulatorState->moduleCount - 1, position ) != -1;
+}
+
 bool Server_ExecuteActionCard( SimulatorState *simulatorState, ActionCardType actionType ) {
     if ( simulatorState == NULL ) return false;
 
@@ -746,10 +5738,7 @@ bool Server_ExecuteActionCard( SimulatorState *simulatorState, ActionCardType ac
         case ACTION_RE_ORG:
             while ( simulatorState->handCardCount > 0 ) {
                 if ( simulatorState->discardCardCount >= MAX_CARDS_IN_DECK ) break;
-                simulatorState->userDiscard[simulatorState->discardCardCount] =
-                  simulatorState->userHand[simulatorState->handCardCount - 1];
-                simulatorState->discardCardCount++;
-                simulatorState->handCardCount--;
+                DiscardHandCard( simulatorState, simulatorState->handCardCount - 1 );
             }
             while ( simulatorState->handCardCount < MAX_CARDS_IN_HAND ) {
                 if ( !Server_UserDrawCard( simulatorState ) ) break;
@@ -757,6 +5746,10 @@ bool Server_ExecuteActionCard( SimulatorState *simulatorState, ActionCardType ac
             TraceLog( LOG_INFO, "SERVER: Re-Org executed - discarded hand and drew full hand" );
             return true;
 
+        case ACTION_BLUEPRINT: return SaveBlueprint( simulatorState );
+
+        case ACTION_SCHEMATIC: return PlaceSchematic( simulatorState );
+
         case ACTION_RECYCLE:
         case ACTION_JOB_FAIR:
         case ACTION_CONTINUOUS_IMPROVEMENT:
@@ -771,9 +5764,42 @@ bool Server_ExecuteActionCard( SimulatorState *simulatorState, ActionCardType ac
     }
 }
 
+/**
+ * Runs the analyses that depend on the topology rather than on signal values: the capability once
+ * per plan generation, and the scenario while any condition is dirty. Called from the first update
+ * that finds nothing changed, so a burst of edits over several frames pays for one analysis, not
+ * one per frame. Doing the work counts as a change, so the server thread publishes the results.
+ */
+static void AnalyzeSettledState( SimulatorState *simulatorState ) {
+    const EvaluationPlan *plan  = &simulatorState->evaluationPlan;
+    bool                  stale = plan->isValid && simulatorState->analyzedGeneration != plan->generation;
+    if ( !stale && simulatorState->currentScenario.dirtyConditions == 0 ) return;
+
+    // Bumped first: whatever the scenario mutates below, such as advancing, is newer still.
+    simulatorState->changeGeneration++;
+    simulatorState->updatedGeneration = simulatorState->changeGeneration;
+    if ( stale ) {
+        simulatorState->analyzedGeneration = plan->generation;
+        Server_AnalyzeCapability( simulatorState );
+    }
+    Server_EvaluateScenario( simulatorState );
+}
+
 void Server_Update( SimulatorState *simulatorState, float deltaTime ) {
     serverUpdateFrameCounter++;
 
+    // Idle frame: nothing has been mutated since the last update did its work. Analyses of the
+    // settled state, and a native kernel waiting for the topology to settle, start from here.
+    if ( simulatorState != NULL && simulatorState->updatedGeneration == simulatorState->changeGeneration ) {
+        if ( !simulatorState->simulationComplete ) AnalyzeSettledState( simulatorState );
+#if NATIVE_ENGINE_AVAILABLE
+        if ( simulatorState->nativeKernel != NULL && simulatorState->evaluationPlan.isValid ) {
+            AcquireNativeKernel( simulatorState );
+        }
+#endif
+        return;
+    }
+
     if ( simulatorState == NULL || simulatorState->simulationComplete ) {
         TraceLog(
           LOG_INFO, "SERVER_UPDATE_END (Frame: %u): Early exit (null or simulation complete)",
@@ -782,17 +5808,330 @@ void Server_Update( SimulatorState *simulatorState, float deltaTime ) {
         return;
     }
 
+    if ( simulatorState->elements.freeSlotCount >= COMPACTION_MIN_FREE_SLOTS &&
+         simulatorState->elements.freeSlotCount * 2 >= simulatorState->elementCount ) {
+        Server_CompactStorage( simulatorState );
+    }
+
+    simulatorState->updatedGeneration = simulatorState->changeGeneration;
+
+    PropagateSignals( simulatorState );
+#ifdef DEBUG
+    if ( simulatorState->stateHash != Server_ComputeStateHash( simulatorState ) ) {
+        TraceLog( LOG_ERROR, "SERVER: State hash drifted from a full recompute (frame %u)", serverUpdateFrameCounter );
+    }
+#endif
+}
+
+uint64_t Server_ComputeStateHash( const SimulatorState *simulatorState ) {
+    if ( simulatorState == NULL ) return 0;
+
+    const ElementStore *store = &simulatorState->elements;
+    uint64_t            hash  = 0;
+
     for ( int i = 0; i < simulatorState->elementCount; ++i ) {
-        if ( !simulatorState->elementsOnCanvas[i].isActive ) continue;
+        if ( !TestElementBit( store->activeBits, i ) ) continue;
+        hash ^= ElementHashKey( store, i );
+        if ( TestElementBit( store->outputBits, i ) ) hash ^= SignalSlotKey( i );
+    }
+    for ( int i = 0; i < simulatorState->connectionCount; ++i ) {
+        if ( simulatorState->connections[i].isActive ) hash ^= ConnectionHashKey( &simulatorState->connections[i] );
+    }
+    HashCardRange( &hash, STATE_HASH_HAND, simulatorState->userHand, 0, simulatorState->handCardCount );
+    HashCardRange(
+      &hash, STATE_HASH_DECK, simulatorState->userDeck, simulatorState->currentDeckIndex,
+      simulatorState->deckCardCount
+    );
+    HashCardRange( &hash, STATE_HASH_DISCARD, simulatorState->userDiscard, 0, simulatorState->discardCardCount );
+    return hash;
+}
 
-        CircuitElement *elem    = &simulatorState->elementsOnCanvas[i];
-        elem->connectedInputCount = 0;
+bool Server_ExecuteCommand( SimulatorState *simulatorState, const ServerCommand *command ) {
+    if ( simulatorState == NULL || command == NULL ) return false;
 
-        for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) {
-            if ( elem->inputElementIDs[k] != -1 ) { elem->connectedInputCount++; }
+    switch ( command->type ) {
+        case SERVER_COMMAND_DRAW_CARD: return Server_UserDrawCard( simulatorState );
+
+        case SERVER_COMMAND_USE_CARD: return Server_UseCardFromHand( simulatorState, command->handIndex );
+
+        case SERVER_COMMAND_PLACE_CARD: {
+            if ( command->handIndex < 0 || command->handIndex >= simulatorState->handCardCount ||
+                 simulatorState->userHand[command->handIndex].type != CARD_TYPE_ELEMENT ) {
+                TraceLog( LOG_WARNING, "SERVER: Hand index %d is not an element card.", command->handIndex );
+                return false;
+            }
+            ElementType type = simulatorState->userHand[command->handIndex].elementToPlace;
+            if ( Server_PlaceElement( simulatorState, type, command->position ) == -1 ) return false;
+            return Server_UseCardFromHand( simulatorState, command->handIndex );
+        }
+
+        case SERVER_COMMAND_CONNECT:
+            return Server_CreateConnection(
+              simulatorState, command->elementId, command->targetElementId, command->inputSlot
+            );
+
+        case SERVER_COMMAND_INTERACT: Server_InteractWithElement( simulatorState, command->elementId ); return true;
+
+        case SERVER_COMMAND_RELEASE: Server_ReleaseElementInteraction( simulatorState, command->elementId ); return true;
+
+        case SERVER_COMMAND_REMOVE_ELEMENT: return Server_RemoveElement( simulatorState, command->elementId );
+
+        case SERVER_COMMAND_REMOVE_CONNECTION:
+            return Server_RemoveConnection( simulatorState, command->targetElementId, command->inputSlot );
+
+        case SERVER_COMMAND_PLACE_MODULE:
+            return Server_PlaceModule( simulatorState, command->moduleIndex, command->position ) != -1;
+
+        default:
+            TraceLog( LOG_WARNING, "SERVER: Unknown command type %d", command->type );
+            return false;
+    }
+}
+
+#define SNAPSHOT_FRESH 4    // Set on ServerThread.middle when it holds an unread snapshot.
+
+struct ServerThread {
+    SimulatorState *simulatorState;
+    int             tickRate;
+#if CAPABILITY_THREADED
+    pthread_t       thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t  wake;
+    bool            quit;    ///< Guarded by mutex.
+    atomic_bool     running;
+
+    // Single-producer, single-consumer ring: the client advances head, the thread advances tail.
+    ServerCommand   commands[SERVER_COMMAND_QUEUE_SIZE];
+    atomic_uint     commandHead;
+    atomic_uint     commandTail;
+
+    // Triple buffer: the thread fills snapshots[back], the client reads snapshots[front], and
+    // they swap through middle, which holds the third index plus SNAPSHOT_FRESH once published.
+    SimulatorState  snapshots[3];
+    Arena           snapshotArenas[3];
+    int             back;
+    int             front;
+    atomic_int      middle;
+#else
+    bool            running;
+#endif
+};
+
+#if CAPABILITY_THREADED
+
+static void *CopyToSnapshot( Arena *arena, const void *source, size_t bytes ) {
+    if ( source == NULL || bytes == 0 ) return NULL;
+    return memcpy( arena_alloc( arena, bytes ), source, bytes );
+}
+
+/**
+ * Copies what the client reads: the game fields and the live part of the element store, ID map,
+ * connections and witness. The plan and the engines stay behind; a snapshot is never simulated.
+ */
+static void CopySimulatorSnapshot( SimulatorState *snapshot, Arena *arena, const SimulatorState *simulatorState ) {
+    const ElementStore *store = &simulatorState->elements;
+    size_t              slots = (size_t) simulatorState->elementCount;
+    size_t              words = (size_t) ELEMENT_BIT_WORDS( simulatorState->elementCount ) * sizeof( uint64_t );
+
+    arena_reset( arena );
+    *snapshot                 = *simulatorState;
+    snapshot->storageArena    = (Arena) { 0 };
+    snapshot->evaluationPlan  = (EvaluationPlan) { 0 };
+    snapshot->nativeKernel    = NULL;
+    snapshot->propagationPool = NULL;
+    snapshot->coneSliceCount  = 0;
+    memset( snapshot->coneSlices, 0, sizeof( snapshot->coneSlices ) );
+
+    snapshot->elements = (ElementStore) {
+        .types                = CopyToSnapshot( arena, store->types, slots ),
+        .outputBits           = CopyToSnapshot( arena, store->outputBits, words ),
+        .inputStateBits       = CopyToSnapshot( arena, store->inputStateBits, slots ),
+        .connectedInputCounts = CopyToSnapshot( arena, store->connectedInputCounts, slots ),
+        .inputIds             = CopyToSnapshot( arena, store->inputIds, slots * sizeof( *store->inputIds ) ),
+        .activeBits           = CopyToSnapshot( arena, store->activeBits, words ),
+        .oscillationPeriods   = CopyToSnapshot( arena, store->oscillationPeriods, slots ),
+        .ids                  = CopyToSnapshot( arena, store->ids, slots * sizeof( int ) ),
+        .positions            = CopyToSnapshot( arena, store->positions, slots * sizeof( Vector2 ) ),
+        .defaultOutputBits    = CopyToSnapshot( arena, store->defaultOutputBits, words ),
+        .modules              = CopyToSnapshot( arena, store->modules, slots ),
+        .capacity             = simulatorState->elementCount,
+    };
+
+    size_t buckets                = (size_t) simulatorState->elementIdMap.capacity * sizeof( int );
+    snapshot->elementIdMap.keys   = CopyToSnapshot( arena, simulatorState->elementIdMap.keys, buckets );
+    snapshot->elementIdMap.slots  = CopyToSnapshot( arena, simulatorState->elementIdMap.slots, buckets );
+    snapshot->connections         = CopyToSnapshot(
+      arena, simulatorState->connections, (size_t) simulatorState->connectionCount * sizeof( Connection )
+    );
+    snapshot->connectionCapacity  = simulatorState->connectionCount;
+
+    const StateWitness *witness              = &simulatorState->stateWitness;
+    size_t              origins              = (size_t) witness->originCount;
+    snapshot->stateWitness.originIds         = CopyToSnapshot( arena, witness->originIds, origins * sizeof( int ) );
+    snapshot->stateWitness.originValues      = CopyToSnapshot( arena, witness->originValues, origins * sizeof( bool ) );
+    snapshot->stateWitness.originCapacity    = witness->originCount;
+}
+
+static void PublishSnapshot( ServerThread *serverThread ) {
+    int back = serverThread->back;
+    CopySimulatorSnapshot( &serverThread->snapshots[back], &serverThread->snapshotArenas[back], serverThread->simulatorState );
+    serverThread->back = atomic_exchange( &serverThread->middle, back | SNAPSHOT_FRESH ) & ~SNAPSHOT_FRESH;
+}
+
+/** Applies every queued command; returns true if there were any. */
+static bool DrainServerCommands( ServerThread *serverThread ) {
+    unsigned int tail = atomic_load_explicit( &serverThread->commandTail, memory_order_relaxed );
+    unsigned int head = atomic_load_explicit( &serverThread->commandHead, memory_order_acquire );
+
+    for ( unsigned int i = tail; i != head; ++i ) {
+        Server_ExecuteCommand( serverThread->simulatorState, &serverThread->commands[i % SERVER_COMMAND_QUEUE_SIZE] );
+    }
+    atomic_store_explicit( &serverThread->commandTail, head, memory_order_release );
+    return head != tail;
+}
+
+static void AdvanceDeadline( struct timespec *deadline, long nanoseconds ) {
+    deadline->tv_nsec += nanoseconds;
+    while ( deadline->tv_nsec >= 1000000000L ) {
+        deadline->tv_nsec -= 1000000000L;
+        deadline->tv_sec++;
+    }
+}
+
+static bool IsDeadlinePassed( const struct timespec *deadline ) {
+    struct timespec now;
+    timespec_get( &now, TIME_UTC );
+    return now.tv_sec > deadline->tv_sec || ( now.tv_sec == deadline->tv_sec && now.tv_nsec >= deadline->tv_nsec );
+}
+
+/**
+ * Fixed-timestep loop: each tick is due one interval after the previous one, independent of how
+ * long the client takes to draw. After a stall the thread runs at most SERVER_MAX_CATCHUP_TICKS
+ * late ticks back to back, then restarts the schedule from now rather than spiral.
+ */
+static void *RunServerThread( void *argument ) {
+    ServerThread   *serverThread = argument;
+    long            interval     = 1000000000L / serverThread->tickRate;
+    float           deltaTime    = 1.0f / (float) serverThread->tickRate;
+    struct timespec deadline;
+
+    timespec_get( &deadline, TIME_UTC );
+    for ( ;; ) {
+        pthread_mutex_lock( &serverThread->mutex );
+        while ( !serverThread->quit &&
+                pthread_cond_timedwait( &serverThread->wake, &serverThread->mutex, &deadline ) == 0 ) {}
+        bool quit = serverThread->quit;
+        pthread_mutex_unlock( &serverThread->mutex );
+        if ( quit ) return NULL;
+
+        int ticks = 0;
+        while ( IsDeadlinePassed( &deadline ) ) {
+            if ( ++ticks > SERVER_MAX_CATCHUP_TICKS ) {
+                timespec_get( &deadline, TIME_UTC );
+                break;
+            }
+            // Publish only when a command ran or the update had something to do.
+            uint64_t updated = serverThread->simulatorState->updatedGeneration;
+            bool     changed = DrainServerCommands( serverThread );
+            if ( atomic_load( &serverThread->running ) ) {
+                Server_Update( serverThread->simulatorState, deltaTime );
+                changed |= serverThread->simulatorState->updatedGeneration != updated;
+            }
+            if ( changed ) PublishSnapshot( serverThread );
+            AdvanceDeadline( &deadline, interval );
         }
     }
+}
 
-    PropagateSignals( simulatorState );
-    Server_EvaluateScenario( simulatorState );
+#endif
+
+ServerThread *Server_StartThread( SimulatorState *simulatorState, int tickRate ) {
+    if ( simulatorState == NULL ) return NULL;
+
+    ServerThread *serverThread = calloc( 1, sizeof( *serverThread ) );
+    if ( serverThread == NULL ) return NULL;
+    serverThread->simulatorState = simulatorState;
+    serverThread->tickRate       = tickRate >= 1 ? tickRate : SERVER_DEFAULT_TICK_RATE;
+
+#if CAPABILITY_THREADED
+    atomic_init( &serverThread->running, false );
+    atomic_init( &serverThread->commandHead, 0 );
+    atomic_init( &serverThread->commandTail, 0 );
+    serverThread->back  = 0;
+    serverThread->front = 2;
+    atomic_init( &serverThread->middle, 1 );
+    CopySimulatorSnapshot( &serverThread->snapshots[2], &serverThread->snapshotArenas[2], simulatorState );
+
+    pthread_mutex_init( &serverThread->mutex, NULL );
+    pthread_cond_init( &serverThread->wake, NULL );
+    if ( pthread_create( &serverThread->thread, NULL, RunServerThread, serverThread ) != 0 ) {
+        TraceLog( LOG_ERROR, "SERVER: Could not start the simulation thread" );
+        pthread_cond_destroy( &serverThread->wake );
+        pthread_mutex_destroy( &serverThread->mutex );
+        arena_free( &serverThread->snapshotArenas[2] );
+        free( serverThread );
+        return NULL;
+    }
+    TraceLog( LOG_INFO, "SERVER: Simulation thread started at %d ticks per second", serverThread->tickRate );
+#endif
+    return serverThread;
+}
+
+void Server_StopThread( ServerThread *serverThread ) {
+    if ( serverThread == NULL ) return;
+
+#if CAPABILITY_THREADED
+    pthread_mutex_lock( &serverThread->mutex );
+    serverThread->quit = true;
+    pthread_cond_signal( &serverThread->wake );
+    pthread_mutex_unlock( &serverThread->mutex );
+    pthread_join( serverThread->thread, NULL );
+
+    DrainServerCommands( serverThread );
+    pthread_cond_destroy( &serverThread->wake );
+    pthread_mutex_destroy( &serverThread->mutex );
+    for ( int i = 0; i < 3; ++i ) { arena_free( &serverThread->snapshotArenas[i] ); }
+#endif
+    free( serverThread );
+}
+
+void Server_SetThreadRunning( ServerThread *serverThread, bool running ) {
+    if ( serverThread == NULL ) return;
+#if CAPABILITY_THREADED
+    atomic_store( &serverThread->running, running );
+#else
+    serverThread->running = running;
+#endif
+}
+
+bool Server_SubmitCommand( ServerThread *serverThread, const ServerCommand *command ) {
+    if ( serverThread == NULL || command == NULL ) return false;
+
+#if CAPABILITY_THREADED
+    unsigned int head = atomic_load_explicit( &serverThread->commandHead, memory_order_relaxed );
+    unsigned int tail = atomic_load_explicit( &serverThread->commandTail, memory_order_acquire );
+    if ( head - tail >= SERVER_COMMAND_QUEUE_SIZE ) {
+        TraceLog( LOG_WARNING, "SERVER: Command queue full, dropping command type %d", command->type );
+        return false;
+    }
+    serverThread->commands[head % SERVER_COMMAND_QUEUE_SIZE] = *command;
+    atomic_store_explicit( &serverThread->commandHead, head + 1, memory_order_release );
+    return true;
+#else
+    return Server_ExecuteCommand( serverThread->simulatorState, command );
+#endif
+}
+
+const SimulatorState *Server_AcquireSnapshot( ServerThread *serverThread ) {
+    if ( serverThread == NULL ) return NULL;
+
+#if CAPABILITY_THREADED
+    if ( atomic_load( &serverThread->middle ) & SNAPSHOT_FRESH ) {
+        serverThread->front = atomic_exchange( &serverThread->middle, serverThread->front ) & ~SNAPSHOT_FRESH;
+    }
+    return &serverThread->snapshots[serverThread->front];
+#else
+    if ( serverThread->running ) Server_Update( serverThread->simulatorState, 1.0f / (float) serverThread->tickRate );
+    return serverThread->simulatorState;
+#endif
 }
@@ -2,7 +2,9 @@
 #define SERVER_H
 
 #include "raylib.h"    // For Vector2, Color, TraceLog etc.
+#include "arena.h"     // Backing memory of the growable simulator storage
 #include <stdbool.h>
+#include <stdint.h>
 
 // In server.h
 #if defined( PLATFORM_WEB )    // For full Raylib web app build
@@ -24,13 +26,59 @@ typedef struct Vector2 {
   #include "raymath.h"
 #endif
 
-#define MAX_ELEMENTS_ON_CANVAS                                               \
-    100    ///< Maximum number of elements that can be placed on the canvas.
 #define MAX_CARDS_IN_HAND         10    ///< Maximum number of cards a user can hold.
 #define MAX_CARDS_IN_DECK         60    ///< Maximum number of cards in a deck.
 #define MAX_INPUTS_PER_LOGIC_GATE 5     ///< Max inputs for complex gates like MUX (5 inputs)
 #define MAX_OUTPUTS_PER_BUS       4     ///< Max outputs for bus element (quad output)
-#define MAX_CONNECTIONS           MAX_ELEMENTS_ON_CANVAS *MAX_INPUTS_PER_LOGIC_GATE    // Theoretical max
+#define ELEMENT_STORE_MIN_CAPACITY 64   ///< Element slots reserved by the first placement; doubles
+                                        ///< whenever the store is full.
+#define CONNECTION_MIN_CAPACITY   128   ///< Connection slots reserved by the first connection; doubles
+                                        ///< whenever the array is full.
+#define MAX_FEEDBACK_ITERATIONS   10    ///< Max settle passes over a single feedback loop per update
+#define OSCILLATION_MAX_ITERATIONS 64   ///< Passes a loop still changing after MAX_FEEDBACK_ITERATIONS
+                                        ///< gets for its state to repeat; at most 255
+#define OSCILLATION_PERIOD_UNKNOWN 1    ///< Period reported when no repeat was found in time
+#define SIGNAL_LANES_PER_WORD     64    ///< Input assignments packed into one uint64_t lane word
+#define ELEMENT_BIT_WORDS( slots ) ( ( ( slots ) + 63 ) / 64 )    ///< Words per packed per-element
+                                                                ///< bit array of that many slots
+#define SIGNAL_BLOCK_MAX_WORDS    8     ///< Widest lane block evaluated per pass (512 lanes)
+#define COMPACTION_MIN_FREE_SLOTS 1024  ///< Released element slots that make Server_Update compact
+                                        ///< the store, once they are also half of all slots.
+#define ELEMENT_ID_MAP_MIN_CAPACITY 128 ///< Smallest power-of-two bucket count of the element ID
+                                        ///< map; it grows to stay at least twice the element count.
+#define CAPABILITY_MAX_ORIGINS    20    ///< Most switches/buttons enumerated exhaustively (2^20 vectors)
+#define CAPABILITY_MAX_SENSORS    64    ///< Most sensors per output pattern (one uint64_t)
+#define CAPABILITY_CHUNK_WORDS    64    ///< Lane words per work chunk (4096 input vectors)
+#define CAPABILITY_MAX_ROW_WORDS  ( 1 << 20 )    ///< Most lane words one worker holds; larger canvases
+                                                ///< get narrower chunks
+#define CAPABILITY_MAX_THREADS    4     ///< Worker threads used by the capability engine
+#define BDD_MAX_NODES             ( 1 << 20 )    ///< Node budget of the symbolic capability engine
+#define BDD_CACHE_SIZE            ( 1 << 16 )    ///< Power-of-two entries in the BDD computed cache
+#define NATIVE_ENGINE_MIN_ELEMENTS 20000   ///< Canvas size from which propagation switches to a
+                                           ///< compiled native kernel
+#define NATIVE_ENGINE_QUIET_MS    2000   ///< Time the topology must stay unchanged before a native
+                                         ///< kernel is built for it
+#define NATIVE_KERNEL_CHUNK       256    ///< Instructions per function in a generated native kernel;
+                                         ///< register allocation time grows faster than function size
+#define NATIVE_KERNEL_UNIT_CHUNKS 16     ///< Functions per source file, each file compiled on its own
+#define NATIVE_KERNEL_MAX_JOBS    4      ///< Most compiler processes one native kernel build runs at once
+#define PARALLEL_MIN_ELEMENTS     100000 ///< Canvas size from which propagation runs on a thread pool
+#define PARALLEL_MIN_LEVEL_WIDTH  2048   ///< Fewest components in a level worth splitting across
+                                         ///< threads; narrower levels are fused and run serially
+#define PARALLEL_CHUNK_COMPONENTS 256    ///< Components per work chunk of a parallel level
+#define PARALLEL_MAX_THREADS      16     ///< Most threads, caller included, in the propagation pool
+#define SERVER_DEFAULT_TICK_RATE  60     ///< Simulation ticks per second of the server thread
+#define SERVER_MAX_CATCHUP_TICKS  5      ///< Most ticks run back to back after a stall before the
+                                         ///< schedule is reset
+#define SERVER_COMMAND_QUEUE_SIZE 256    ///< Power-of-two capacity of the client command queue
+#define SAT_MAX_CONFLICTS         100000         ///< Conflict budget of one specific-state query
+#define MAX_MODULE_DEFINITIONS    64     ///< Most module definitions a session can hold
+#define LUT_CONE_MAX_LEAVES       6      ///< Most inputs of a collapsed cone (a 64-bit truth table)
+#define MODULE_NAME_LENGTH        32     ///< Bytes of a module name, terminator included
+#define BLUEPRINT_MAX_CANDIDATES  16     ///< Newest elements the Blueprint card tries to save as a
+                                         ///< module
+#define MAX_CONE_SLICES           8      ///< Fan-in slices cached per simulator state
+#define CONDITION_MAX_TERMINALS   8      ///< Most terminal elements a scenario condition can name
 
 // --- Element Definitions ---
 
@@ -60,12 +108,16 @@ typedef enum ElementType {
     ELEMENT_FLIP_FLOP,        ///< Single input/output, toggles state on signal.
     ELEMENT_MUX,              ///< 5 inputs, single output, one input is "select".
     ELEMENT_TAPE,             ///< Like sequencer, but single input/output.
-    
+
+    // Modules
+    ELEMENT_MODULE,           ///< Instance of a ModuleDefinition; up to 5 inputs, single output.
+
     ELEMENT_TYPE_COUNT        ///< Total number of defined element types.
 } ElementType;
 
 /**
- * @brief Represents a single circuit element placed on the simulator canvas.
+ * @brief Snapshot of a single circuit element, assembled from ElementStore by Server_GetElement.
+ * The server does not store elements in this form; it is the read-only view handed to the client.
  */
 typedef struct CircuitElement {
     ElementType type;                    ///< The type of this element.
@@ -81,11 +133,68 @@ typedef struct CircuitElement {
                                                                ///< state received from
                                                                ///< inputElementIDs.
     int         connectedInputCount;                           ///< Number of connected inputs
-    // float timer;             ///< General purpose timer (seconds)
-    // bool timerActive;        ///< Whether the timer is currently running
-    // float timerDuration;     ///< How long the timer should run (seconds)
+    int         moduleIndex;             ///< ModuleDefinition of an ELEMENT_MODULE, -1 otherwise.
 } CircuitElement;
 
+/**
+ * @brief A reusable circuit, compiled once to a truth table and placed as ELEMENT_MODULE instances.
+ *
+ * Server_DefineModule captures a combinational selection of the canvas: its switches and
+ * buttons become the input pins in the order given, and one chosen element becomes the output.
+ * The selection is evaluated over every input assignment at once and only the resulting table is
+ * kept, so an instance costs one table read however large or deeply nested its definition is; a
+ * module containing other modules simply folds their tables into its own.
+ *
+ * An instance is a single element and has the element's MAX_INPUTS_PER_LOGIC_GATE input pins, so
+ * every definition fits in a 32-entry table. Bit i of truthTable is the output when input pin k
+ * carries bit k of i; unconnected pins read low.
+ */
+typedef struct ModuleDefinition {
+    char     name[MODULE_NAME_LENGTH];    ///< Display name.
+    int      inputCount;                  ///< Number of input pins.
+    int      elementCount;                ///< Elements in the captured selection.
+    uint32_t truthTable;                  ///< Output for each assignment of the input pins.
+} ModuleDefinition;
+
+/**
+ * @brief Struct-of-arrays storage for the elements on the canvas, indexed by slot.
+ *
+ * Arrays are grouped by access pattern. Propagation reads only the hot group: one type byte,
+ * one output bit, one input-state byte and the input table per element. Positions, IDs and
+ * default states are cold and never enter the cache during a sweep. Packed bit arrays hold bit
+ * (slot % 64) of word (slot / 64).
+ *
+ * The arrays are allocated from SimulatorState.storageArena and start empty. When a placement
+ * finds the store full, every array is copied into one twice as large, so an empty session costs
+ * nothing and placement stays amortized O(1).
+ *
+ * Removing an element releases its slot onto freeSlots, and the next placement takes it back.
+ * Every slot heads two lists of the connections that touch it, so a removal walks only its own
+ * wires. Server_CompactStorage closes the holes left by removals.
+ */
+typedef struct ElementStore {
+    // Hot: touched by every evaluation.
+    uint8_t  *types;                   ///< ElementType of each slot.
+    uint64_t *outputBits;              ///< Packed output states.
+    uint8_t  *inputStateBits;          ///< Bit k is the state seen on input k.
+    uint8_t  *connectedInputCounts;    ///< Number of connected inputs.
+    int ( *inputIds )[MAX_INPUTS_PER_LOGIC_GATE];    ///< Input element IDs, -1 if unconnected.
+    uint64_t *activeBits;              ///< Packed slot-in-use flags.
+    uint8_t  *oscillationPeriods;      ///< Period of the oscillation the element takes part in,
+                                       ///< 0 if stable.
+
+    // Cold: edited on placement, read by the client.
+    int      *ids;                     ///< Unique element IDs.
+    Vector2  *positions;               ///< Logical canvas positions.
+    uint64_t *defaultOutputBits;       ///< Packed default output states.
+    uint8_t  *modules;                 ///< ModuleDefinition index of each ELEMENT_MODULE slot.
+    int      *firstOutgoing;           ///< First connection driven by the slot, -1 if none.
+    int      *firstIncoming;           ///< First connection feeding the slot, -1 if none.
+    int      *freeSlots;               ///< Released slots, reused by the next placements.
+    int       freeSlotCount;           ///< Number of slots in freeSlots.
+    int       capacity;                ///< Slots allocated in each array.
+} ElementStore;
+
 /**
  * @brief Represents a connection between two elements.
  */
@@ -94,8 +203,262 @@ typedef struct Connection {
     int  toElementId;        ///< ID of the element receiving the signal.
     int  toInputSlot;        ///< Which input slot on the toElement (0, 1, etc.).
     bool isActive;           ///< Is this connection slot in use?
+    int  nextOutgoing;       ///< Next connection from the same source, -1 at the end. While
+                             ///< inactive, the next free connection.
+    int  previousOutgoing;   ///< Previous connection from the same source, -1 at the head.
+    int  nextIncoming;       ///< Next connection into the same target, -1 at the end.
+    int  previousIncoming;   ///< Previous connection into the same target, -1 at the head.
 } Connection;
 
+/**
+ * @brief Open-addressing hash map from element ID to its slot in the element store.
+ * Maintained by every server call that places or clears elements, so lookups by ID are O(1)
+ * instead of a scan over the canvas. Element IDs start at 1; a key of 0 marks an empty bucket.
+ * The buckets live in SimulatorState.storageArena and are rehashed into twice as many whenever
+ * the map would become more than half full.
+ */
+typedef struct ElementIdMap {
+    int *keys;        ///< Element ID stored in each bucket, 0 if empty.
+    int *slots;       ///< Slot index of the element stored in each bucket.
+    int  count;       ///< Occupied buckets.
+    int  capacity;    ///< Power-of-two bucket count, 0 before the first insertion.
+} ElementIdMap;
+
+/**
+ * @brief Selects how PropagateSignals walks the compiled evaluation plan.
+ */
+typedef enum PropagationMode {
+    PROPAGATION_EVENT_DRIVEN = 0,    ///< Re-evaluate only components downstream of a changed
+                                     ///< output (default).
+    PROPAGATION_FULL_SWEEP,          ///< Re-evaluate every component on every update.
+    PROPAGATION_MODE_COUNT           ///< Total number of propagation modes.
+} PropagationMode;
+
+/**
+ * @brief What the netlist reduction pass made of an element slot in the evaluation plan.
+ */
+typedef enum SlotReduction {
+    SLOT_SIMULATED = 0,    ///< Evaluated by every engine.
+    SLOT_CONSTANT,         ///< Output fixed by the wiring; written once when the plan is compiled.
+    SLOT_BYPASSED,         ///< Single-input OR or BUS; analysis sweeps read its driver instead.
+    SLOT_DEAD,             ///< No path to a sensor; skipped by analysis sweeps.
+    SLOT_REDUCTION_COUNT   ///< Total number of slot reductions.
+} SlotReduction;
+
+/**
+ * @brief And-Inverter Graph of the compiled netlist.
+ *
+ * Every element is lowered to two-input AND nodes and complemented edges. A literal is twice a
+ * node index plus one if complemented; node 0 is the constant, so literal 0 is low and literal 1
+ * is high. Switches, buttons and elements without combinational behaviour are input nodes, as is
+ * one gate on every cycle of a feedback loop, a state input whose function over the loop's inputs
+ * is kept as its next-state literal. Nodes are created through a structural hash table keyed by
+ * their ordered fan-in pair, after constant and trivial-operand folding, so identical logic over
+ * the same fan-ins is one node. Node indices are topological: every node comes after its fan-ins.
+ */
+typedef struct AndInverterGraph {
+    int ( *fanins )[2];        ///< Fan-in literals of each AND node, -1 for the constant and inputs.
+    int  *nodeSlots;           ///< Slot each input node stands for, -1 for other nodes.
+    int  *chain;               ///< Next node in the same hash bucket, -1 at the end.
+    int  *buckets;             ///< First node of each hash bucket, -1 if empty.
+    int   bucketMask;          ///< Bucket count minus one (a power of two).
+    int   nodeCount;           ///< Nodes, the constant and the inputs included.
+    int   inputCount;          ///< Input nodes.
+    int   andCount;            ///< AND nodes.
+    int   mergedCount;         ///< AND requests answered by an existing node of the hash table.
+    int   stateCount;          ///< State inputs, feedback-loop gates with a next-state literal.
+    int  *outputLiterals;      ///< Literal of each slot's output, -1 for empty slots.
+    int  *triggerLiterals;     ///< Literal of each sensor's trigger (OR of its inputs), -1 otherwise.
+    int  *nextLiterals;        ///< Next-state literal of each feedback-loop gate, -1 otherwise.
+} AndInverterGraph;
+
+/**
+ * @brief Compiled evaluation order for the elements on the canvas.
+ *
+ * Built from the element input wiring by a strongly-connected-component pass. Components are
+ * stored in topological order (every producer before its consumers), so acyclic logic settles
+ * in a single pass. Only components flagged as cyclic (genuine feedback loops) are iterated,
+ * bounded by MAX_FEEDBACK_ITERATIONS. The plan is rebuilt whenever the topology changes.
+ *
+ * A loop still changing after that keeps iterating while a hash of its outputs, updated with
+ * every flip, is compared against the earlier passes. A repeat gives the oscillation period.
+ * The loop is then recorded as oscillating and, for as long as the outputs feeding it from
+ * outside are unchanged, advances a single pass when evaluated instead of re-running detection.
+ *
+ * In PROPAGATION_EVENT_DRIVEN mode the plan also carries per-element fan-out lists and a
+ * worklist ordered by component index: an output change schedules only the components of its
+ * consumers, so a single toggle costs the size of its downstream cone rather than the canvas.
+ *
+ * Compiling also lowers the plan to signal bytecode: each combinational element becomes one
+ * instruction (for example AND dst, src0, src1) with operands already resolved to slot indices,
+ * laid out component by component. Propagation runs this program in a threaded interpreter
+ * instead of decoding element types and input tables on every pass.
+ *
+ * Components are numbered level by level, a component's level being one more than the deepest
+ * component feeding it, so the members of a level are independent and their code is contiguous.
+ * Levels are grouped into phases: a wide level is a phase of its own that large canvases split
+ * across threads, and runs of narrow levels are fused into one serial phase.
+ *
+ * The connection graph is indexed in compressed sparse row form in both directions: an offset
+ * array per slot and one contiguous array of neighbor slots, so walking an element's producers
+ * or consumers touches a single run of memory. Structural passes (components, levels, cones)
+ * use these rows; the positional inputSlots table remains for code generation.
+ *
+ * Compiling also partitions the acyclic gates into fan-out-free cones of at most
+ * LUT_CONE_MAX_LEAVES inputs: a gate whose only consumer is another gate joins that gate's cone
+ * while the leaf count allows. Each cone is reduced to a 64-bit truth table over its leaves.
+ * Lane sweeps that only need cone roots (the capability engine) evaluate a large enough cone as
+ * one table lookup instead of gate by gate, and equal (leaf count, table) pairs identify
+ * sub-circuits computing the same function. The scalar program keeps every gate, since each
+ * output is visible on the canvas.
+ *
+ * Before cones are formed, a reduction pass derives the simulated netlist. An acyclic element
+ * whose output the wiring fixes (a source, a sensor, a gate fed only by constants or decided by
+ * one constant input) is a constant: its output is written once at compile time, it gets no
+ * instruction, and constant operands are folded out of the instructions of its consumers. A
+ * single-input OR or BUS is bypassed, its consumers reading its driver directly, and an element
+ * with no path to a sensor is dead. Cones are formed over this netlist, and the capability
+ * sweep evaluates only its simulated slots; the scalar program still runs bypassed and dead
+ * elements, whose outputs are drawn on the canvas.
+ *
+ * Compiling finally lowers the netlist to an And-Inverter Graph with structural hashing (see
+ * AndInverterGraph). The formal engines (SAT and BDD) work on the graph's cone of the sensors
+ * instead of on elements, and so does the capability enumeration unless a feedback loop is in it.
+ *
+ * Every array is allocated from the plan's own arena, which each compile resets and refills.
+ */
+typedef struct EvaluationPlan {
+    Arena arena;               ///< Backing memory of the arrays below.
+    int  *order;               ///< Element slot indices grouped by component, in topological order.
+    int  *componentStart;      ///< Offset of each component in order; one extra entry marks the end.
+    bool *componentCyclic;     ///< True if the component is a feedback loop and must be iterated.
+    int   componentCount;      ///< Number of components in the plan.
+    int ( *inputSlots )[MAX_INPUTS_PER_LOGIC_GATE];    ///< Input element slot indices, -1 if
+                                                       ///< unresolved.
+    int  *componentOf;         ///< Component index of each element slot.
+    int  *faninStart;          ///< Offset of each slot's producers in faninSources; one extra end
+                               ///< entry.
+    int  *faninSources;        ///< Producer slot indices grouped by consumer slot, in pin order.
+    int  *fanoutStart;         ///< Offset of each slot's consumers in fanoutTargets; one extra end
+                               ///< entry.
+    int  *fanoutTargets;       ///< Consumer slot indices grouped by producer slot.
+    int  *worklist;            ///< Min-heap of pending component indices.
+    int   worklistCount;       ///< Number of components in the worklist.
+    bool *componentQueued;     ///< True while a component is in the worklist.
+    int32_t *code;             ///< Signal bytecode of every component, in plan order.
+    int  *componentCode;       ///< Offset of each component's bytecode in code; one extra end entry.
+    int   codeLength;          ///< Words of bytecode in code.
+    unsigned int generation;   ///< Incremented on every compile; identifies the program version.
+    int  *componentPeriod;     ///< Oscillation period of each component, 0 if it settles.
+    uint64_t *componentInputHash;    ///< Hash of a component's outside inputs when its period
+                                     ///< was found.
+    uint64_t *sweepOutputBits;       ///< Outputs before a native or parallel sweep, diffed after it
+                                     ///< to update the state hash.
+    int   levelCount;          ///< Number of distinct component levels.
+    int  *phaseStart;          ///< First component of each phase; one extra end entry.
+    bool *phaseParallel;       ///< True if the phase is one level of at least
+                               ///< PARALLEL_MIN_LEVEL_WIDTH components.
+    int   phaseCount;          ///< Number of phases.
+    uint8_t *slotReductions;   ///< SlotReduction of each slot.
+    int ( *simulatedInputs )[MAX_INPUTS_PER_LOGIC_GATE];    ///< inputSlots with every bypassed
+                                                            ///< buffer replaced by its driver.
+    int  *simulatedOrder;      ///< SLOT_SIMULATED slots outside collapsed cones, in plan order.
+    int  *simulatedStart;      ///< Offset of each component in simulatedOrder; one extra end entry.
+    int   constantCount;       ///< Slots marked SLOT_CONSTANT.
+    int   bypassedCount;       ///< Slots marked SLOT_BYPASSED.
+    int   deadCount;           ///< Slots marked SLOT_DEAD, not counting empty ones.
+    int  *sliceRows;           ///< Slice row of each slot while Server_SliceCone builds a slice,
+                               ///< -1 otherwise.
+    int  *sliceQueue;          ///< Slots reached by the fan-in walk of Server_SliceCone.
+    AndInverterGraph aig;      ///< The netlist as an And-Inverter Graph.
+    int  *coneRoot;            ///< Root slot of the cone each slot belongs to, -1 outside cones.
+    int ( *coneLeaves )[LUT_CONE_MAX_LEAVES];    ///< Leaf slots of each cone root, in truth-table
+                                                 ///< input order.
+    uint8_t  *coneLeafCounts;  ///< Number of leaves of each cone root.
+    uint64_t *coneTables;      ///< Truth table of each cone root; bit i is the output when leaf k
+                               ///< carries bit k of i.
+    bool *coneLookup;          ///< True if lane sweeps evaluate the root's cone by its table.
+    int   coneCount;           ///< Number of cones.
+    int   collapsedGateCount;  ///< Non-root gates of the cones with coneLookup set.
+    int   parallelPhaseCount;  ///< Number of phases with phaseParallel set.
+    int  compiledElementCount;       ///< elementCount the plan was compiled against.
+    int  compiledConnectionCount;    ///< connectionCount the plan was compiled against.
+    bool isValid;                    ///< False when the topology changed since the last compile.
+} EvaluationPlan;
+
+/**
+ * @brief Result of enumerating every origin assignment and counting distinct sensor patterns.
+ *
+ * Capability is the number of unique global terminal states: the patterns of triggered sensors
+ * reachable by some assignment of the switches and buttons. Efficiency divides it by the number
+ * of origin points (sources, switches and buttons). The report is cached on the simulator state
+ * and invalidated whenever the evaluation plan is recompiled.
+ */
+typedef struct CapabilityReport {
+    int      originCount;         ///< Switches and buttons enumerated.
+    int      sensorCount;         ///< Sensors forming each output pattern.
+    uint64_t vectorCount;         ///< Origin assignments simulated (2^originCount).
+    int      uniqueStateCount;    ///< Distinct sensor patterns observed (capability).
+    float    efficiency;          ///< uniqueStateCount per origin point, 0 without origins.
+    bool     isExact;             ///< False when neither enumeration nor the BDD engine could
+                                  ///< count the states.
+    bool     isSymbolic;          ///< True when the states were counted on BDDs, not simulated.
+    bool     isValid;             ///< False when the topology changed since the last analysis.
+} CapabilityReport;
+
+/**
+ * @brief Origin assignment that drives the sensors into a required pattern.
+ * Produced by the SAT-backed CONDITION_SPECIFIC_STATE check so the client can display it. The
+ * origin arrays are heap-allocated and grown by Server_SolveSpecificState: a witness must start
+ * zeroed, and one the caller owns is released with free() on both arrays.
+ */
+typedef struct StateWitness {
+    uint64_t sensorPattern;                            ///< Bit i set if sensor i (slot order) must
+                                                       ///< be triggered.
+    uint64_t terminalKey;                              ///< ConeSlice.terminalKey of the terminals
+                                                       ///< solved for, 0 for every sensor.
+    int      originCount;                              ///< Entries in originIds/originValues.
+    int      originCapacity;                           ///< Entries allocated in the arrays below.
+    int     *originIds;                                ///< Switch/button element IDs, in
+                                                       ///< Server_CollectOriginSlots order.
+    bool    *originValues;                             ///< Required output of each origin.
+    bool     isSatisfiable;                            ///< True if some assignment reaches the
+                                                       ///< pattern.
+    bool     isValid;                                  ///< False when the topology changed since
+                                                       ///< the last solve.
+} StateWitness;
+
+/**
+ * @brief Transitive fan-in of a set of terminal elements: everything that can affect them.
+ *
+ * Built by Server_SliceCone with one walk back from the terminals and cached on the simulator
+ * state until the topology changes. A slice holds whole components of the evaluation plan in plan
+ * order, with every input rewritten as a member row, so queries on it touch only the members
+ * however large the rest of the canvas is. Each terminal is one bit of a slice pattern: whether
+ * it is triggered for a sensor, its output for any other element.
+ */
+typedef struct ConeSlice {
+    Arena     arena;               ///< Backing memory of the arrays below, reused on rebuild.
+    uint64_t  terminalKey;         ///< Hash of the terminal slots in order, never 0.
+    int      *terminalSlots;       ///< Slot of each terminal, in the order requested.
+    int      *terminalRows;        ///< Member row of each terminal.
+    int       terminalCount;       ///< Number of terminals.
+    int      *members;             ///< Member slots in plan order (producers before consumers).
+    int ( *inputs )[MAX_INPUTS_PER_LOGIC_GATE];    ///< Member row driving each input of each member,
+                                                   ///< -1 if unconnected.
+    int      *originOfRow;         ///< Origin index of each switch or button member, -1 otherwise.
+    int       memberCount;         ///< Number of members.
+    int      *groupStart;          ///< First member of each plan component; one extra end entry.
+    bool     *groupCyclic;         ///< True if the component is a feedback loop.
+    int       groupCount;          ///< Number of plan components in the slice.
+    int      *originRows;          ///< Member rows of the switches and buttons, in slot order.
+    int       originCount;         ///< Number of switches and buttons in the slice.
+    int       sourceCount;         ///< Number of sources in the slice.
+    CapabilityReport capability;   ///< Cached Server_AnalyzeSliceCapability result.
+    unsigned int generation;       ///< EvaluationPlan.generation the slice was built against.
+    unsigned int lastUsed;         ///< Lookup clock of the last hit; the stalest entry is rebuilt.
+} ConeSlice;
+
 /**
  * @brief Defines different types of scenario conditions that can be checked.
  */
@@ -104,7 +467,9 @@ typedef enum ScenarioConditionType {
     CONDITION_MAX_ELEMENTS,          ///< Maximum number of specific element types
     CONDITION_MIN_UNIQUE_STATES,     ///< Minimum number of unique output states
     CONDITION_MAX_UNIQUE_STATES,     ///< Maximum number of unique output states
-    CONDITION_SPECIFIC_STATE,        ///< Require a specific output state pattern
+    CONDITION_SPECIFIC_STATE,        ///< Require a specific output state pattern (targetValue
+                                     ///< is a sensor bitmask, bit i = i-th sensor triggered,
+                                     ///< or a slice pattern over the condition's terminals)
     CONDITION_TYPE_COUNT             ///< Total number of condition types
 } ScenarioConditionType;
 
@@ -129,6 +494,9 @@ typedef struct ScenarioCondition {
     int                   targetValue;         ///< Target count or value for the condition
     bool                  isMet;               ///< Whether this condition is currently satisfied
     char                  description[128];    ///< Human-readable description of the condition
+    int                   terminalIds[CONDITION_MAX_TERMINALS];    ///< Elements a state condition
+                                                                   ///< is checked on
+    int                   terminalCount;       ///< Entries in terminalIds; 0 checks every sensor
 } ScenarioCondition;
 
 /**
@@ -141,6 +509,7 @@ typedef struct Scenario {
     int               conditionCount;      ///< Number of active conditions in this scenario
     bool              isCompleted;         ///< Whether all conditions have been met
     int               rewardScore;         ///< Score awarded for completing this scenario
+    uint32_t          dirtyConditions;     ///< Bit i is set while conditions[i] must be re-evaluated
 } Scenario;
 
 // --- Card System Definitions ---
@@ -165,8 +534,8 @@ typedef enum ActionCardType {
     ACTION_CONTINUOUS_IMPROVEMENT,  ///< Add input/output to element
     ACTION_END_OF_LIFE,             ///< Remove a card from hand permanently
     ACTION_PARTS_BIN,               ///< Duplicate an element in play
-    ACTION_BLUEPRINT,               ///< Copy and replay modules/nodes
-    ACTION_SCHEMATIC,               ///< Copy and replay modules/nodes
+    ACTION_BLUEPRINT,               ///< Save the fan-in of the newest element as a module
+    ACTION_SCHEMATIC,               ///< Place the newest saved module
     ACTION_TYPE_COUNT               ///< Total number of action types
 } ActionCardType;
 
@@ -187,12 +556,17 @@ typedef struct Card {
  * This structure is managed by the "server" module.
  */
 typedef struct SimulatorState {
-    CircuitElement   elementsOnCanvas[MAX_ELEMENTS_ON_CANVAS];    ///< Array of all elements on
-                                                                  ///< the canvas.
-    int              elementCount;       ///< Number of active elements currently on the canvas.
+    ElementStore     elements;           ///< All elements on the canvas, by slot.
+    int              elementCount;       ///< Element slots in use, including released slots
+                                         ///< awaiting reuse; see ElementStore.activeBits.
     int              nextElementId;      ///< Counter for assigning unique IDs to new elements.
-    Connection       connections[MAX_CONNECTIONS];     ///< Array of all connections.
-    int              connectionCount;                  ///< Number of active connections.
+    ElementIdMap     elementIdMap;       ///< Element ID to slot index lookup.
+    Connection      *connections;        ///< Array of all connections.
+    int              connectionCount;    ///< Connection slots in use, including inactive ones.
+    int              freeConnection;     ///< First released connection slot, -1 if none.
+    int              connectionCapacity; ///< Connections allocated in the array.
+    Arena            storageArena;       ///< Backing memory of elements, connections and the
+                                         ///< element ID map; released by Server_Shutdown.
     Card             userHand[MAX_CARDS_IN_HAND];      ///< Cards currently in the user's hand.
     int              handCardCount;                    ///< Number of cards in the user's hand.
     Card             userDeck[MAX_CARDS_IN_DECK];      ///< Cards currently in the user's draw
@@ -203,19 +577,96 @@ typedef struct SimulatorState {
     int              discardCardCount;                 ///< Number of cards in the discard pile.
     int              score;              ///< User's current score.
     bool             simulationComplete; ///< Flag indicating if the simulation has ended.
+    int              elementTypeCounts[ELEMENT_TYPE_COUNT];    ///< Active elements of each type.
     Scenario         currentScenario;    ///< The scenario the user is currently working on
     int              currentScenarioId;  ///< ID of the currently active scenario
     bool scenarioProgression[SCENARIO_COUNT];    ///< Track which scenarios have been completed
+    ModuleDefinition modules[MAX_MODULE_DEFINITIONS];    ///< Module definitions, kept across
+                                                         ///< scenarios.
+    int              moduleCount;        ///< Number of entries in modules.
+    EvaluationPlan   evaluationPlan;     ///< Compiled topological evaluation order.
+    PropagationMode  propagationMode;    ///< How signal propagation walks evaluationPlan.
+    struct NativeKernel *nativeKernel;   ///< Background-compiled evaluation kernel, NULL until
+                                         ///< the canvas reaches NATIVE_ENGINE_MIN_ELEMENTS.
+    struct PropagationPool *propagationPool;    ///< Level-parallel worker threads, NULL until
+                                                ///< the canvas reaches PARALLEL_MIN_ELEMENTS.
+    int              propagationThreads; ///< Server_SetPropagationThreads override, 0 for automatic.
+    CapabilityReport capability;         ///< Cached capability/efficiency of the canvas.
+    StateWitness     stateWitness;       ///< Cached solution of the last specific-state check.
+    ConeSlice        coneSlices[MAX_CONE_SLICES];    ///< Cached fan-in slices, emptied by every
+                                                     ///< compile.
+    int              coneSliceCount;     ///< Entries of coneSlices built against the current plan.
+    unsigned int     coneSliceClock;     ///< Bumped by every Server_SliceCone lookup.
+    uint64_t         stateHash;          ///< Zobrist hash of the elements, connections, high
+                                         ///< outputs and card piles, updated with every change.
+    uint64_t         changeGeneration;   ///< Bumped by every server call that mutates the state.
+    uint64_t         updatedGeneration;  ///< changeGeneration when Server_Update last did work;
+                                         ///< an update with nothing newer returns at once.
+    unsigned int     analyzedGeneration; ///< Plan generation whose capability Server_Update last
+                                         ///< analyzed.
 } SimulatorState;
 
+/**
+ * @brief Kinds of client request carried by a ServerCommand.
+ */
+typedef enum ServerCommandType {
+    SERVER_COMMAND_DRAW_CARD = 0,        ///< Server_UserDrawCard.
+    SERVER_COMMAND_USE_CARD,             ///< Server_UseCardFromHand with handIndex.
+    SERVER_COMMAND_PLACE_CARD,           ///< Place the element card at handIndex on position,
+                                         ///< then use the card if placement succeeded.
+    SERVER_COMMAND_CONNECT,              ///< Server_CreateConnection from elementId to
+                                         ///< targetElementId's inputSlot.
+    SERVER_COMMAND_INTERACT,             ///< Server_InteractWithElement on elementId.
+    SERVER_COMMAND_RELEASE,              ///< Server_ReleaseElementInteraction on elementId.
+    SERVER_COMMAND_REMOVE_ELEMENT,       ///< Server_RemoveElement on elementId.
+    SERVER_COMMAND_REMOVE_CONNECTION,    ///< Server_RemoveConnection into targetElementId's
+                                         ///< inputSlot.
+    SERVER_COMMAND_PLACE_MODULE,         ///< Server_PlaceModule of moduleIndex on position.
+    SERVER_COMMAND_COUNT                 ///< Total number of command types.
+} ServerCommandType;
+
+/**
+ * @brief One client request, queued to the server thread and applied before its next tick.
+ */
+typedef struct ServerCommand {
+    ServerCommandType type;
+    int               handIndex;          ///< Hand card, for USE_CARD and PLACE_CARD.
+    int               elementId;          ///< Subject element, or the source of CONNECT.
+    int               targetElementId;    ///< Destination element of CONNECT.
+    int               inputSlot;          ///< Destination input of CONNECT.
+    Vector2           position;           ///< Canvas cell of PLACE_CARD and PLACE_MODULE.
+    int               moduleIndex;        ///< Module definition of PLACE_MODULE.
+} ServerCommand;
+
+/**
+ * @brief Simulation thread that owns a SimulatorState and ticks it at a fixed rate.
+ *
+ * The client never touches the owned state while the thread runs. Its requests go through a
+ * single-producer command queue, and it draws from snapshots the thread publishes through a
+ * lock-free triple buffer after every tick, so neither side waits for the other. Where threads
+ * are unavailable (web builds) commands apply immediately and each snapshot acquisition runs one
+ * tick on the caller.
+ */
+typedef struct ServerThread ServerThread;
+
 /**
  * @brief Initializes the simulator state to its starting conditions.
  * @param simulatorState Pointer to the SimulatorState struct to be initialized.
  */
 void Server_Init( SimulatorState *simulatorState );
 
+/**
+ * @brief Releases the element, connection and plan storage owned by the simulator state.
+ * @param simulatorState Pointer to a SimulatorState initialized by Server_Init.
+ */
+void Server_Shutdown( SimulatorState *simulatorState );
+
 /**
  * @brief Updates the simulator state based on elapsed time and internal logic.
+ *
+ * An update after a change propagates signals. The capability analysis and the scenario
+ * conditions wait for the first update that finds nothing changed, so a burst of edits over
+ * several frames is analyzed once, and the capability only when the plan generation moved on.
  * @param simulatorState Pointer to the SimulatorState struct to be updated.
  * @param deltaTime Time elapsed since the last frame, in seconds.
  */
@@ -230,6 +681,351 @@ void Server_Update( SimulatorState *simulatorState, float deltaTime );
  */
 bool Server_UseCardFromHand( SimulatorState *simulatorState, int handIndex );
 
+/**
+ * @brief Places a new element on the canvas.
+ * @param simulatorState Pointer to the SimulatorState struct.
+ * @param type The type of element to place.
+ * @param canvasPosition Logical grid position of the new element.
+ * @return The unique ID of the new element, or -1 on invalid arguments. ELEMENT_MODULE is rejected;
+ *         instances are placed with Server_PlaceModule.
+ */
+int Server_PlaceElement( SimulatorState *simulatorState, ElementType type, Vector2 canvasPosition );
+
+/**
+ * @brief Compiles a selection of the canvas into a module definition.
+ * The selection must be combinational and closed: every input of a selected element other than a
+ * switch or button must come from another selected element. The selected switches and buttons
+ * become the input pins in the order given. A sensor as output exports whether it is triggered.
+ * The selection stays on the canvas; instances placed later share the compiled definition.
+ * @param simulatorState Pointer to the SimulatorState struct.
+ * @param name Display name of the module.
+ * @param elementIds IDs of the selected elements.
+ * @param elementCount Number of entries in elementIds.
+ * @param outputElementId Selected element whose output becomes the module output.
+ * @return Index of the new definition, or -1 if the selection cannot form a module.
+ */
+int Server_DefineModule(
+  SimulatorState *simulatorState, const char *name, const int *elementIds, int elementCount, int outputElementId
+);
+
+/**
+ * @brief Places an instance of a module definition on the canvas.
+ * @param simulatorState Pointer to the SimulatorState struct.
+ * @param moduleIndex Definition returned by Server_DefineModule.
+ * @param canvasPosition Logical grid position of the new instance.
+ * @return The unique ID of the new element, or -1 on invalid arguments.
+ */
+int Server_PlaceModule( SimulatorState *simulatorState, int moduleIndex, Vector2 canvasPosition );
+
+/**
+ * @brief Looks up the slot index of an element by its unique ID in O(1).
+ * @param simulatorState Pointer to the SimulatorState struct.
+ * @param elementId The unique ID of the element.
+ * @return Element slot index, or -1 if no active element has that ID.
+ */
+int Server_FindElementSlot( const SimulatorState *simulatorState, int elementId );
+
+/**
+ * @brief Assembles a CircuitElement snapshot of the element in a slot.
+ * @param simulatorState Pointer to the SimulatorState struct.
+ * @param slot Element slot index, 0 <= slot < elementCount.
+ * @return The element's fields gathered from the struct-of-arrays store.
+ */
+CircuitElement Server_GetElement( const SimulatorState *simulatorState, int slot );
+
+/**
+ * @brief Gets the slots feeding an element from the plan's fan-in index.
+ * Compiles the evaluation plan first if the topology changed. The returned array is owned by the
+ * plan and stays valid until the next topology change.
+ * @param simulatorState Pointer to the SimulatorState struct.
+ * @param slot Element slot index, 0 <= slot < elementCount.
+ * @param sources Receives a pointer to the producer slots, in input pin order.
+ * @return Number of producers, or -1 on invalid arguments.
+ */
+int Server_GetFanin( SimulatorState *simulatorState, int slot, const int **sources );
+
+/**
+ * @brief Gets the slots an element drives from the plan's fan-out index.
+ * Compiles the evaluation plan first if the topology changed. The returned array is owned by the
+ * plan and stays valid until the next topology change.
+ * @param simulatorState Pointer to the SimulatorState struct.
+ * @param slot Element slot index, 0 <= slot < elementCount.
+ * @param targets Receives a pointer to the consumer slots, one entry per connection.
+ * @return Number of consumers, or -1 on invalid arguments.
+ */
+int Server_GetFanout( SimulatorState *simulatorState, int slot, const int **targets );
+
+/**
+ * @brief Gets the fan-out-free cone rooted at an element and its truth table.
+ * Compiles the evaluation plan first if the topology changed. Cones are formed over the simulated
+ * netlist, so constants are folded into the table and a bypassed buffer's driver stands in for it.
+ * Two cones with the same leaf count and table compute the same function of their leaves in
+ * order, whatever gates they are built of.
+ * @param simulatorState Pointer to the SimulatorState struct.
+ * @param slot Element slot index, 0 <= slot < elementCount.
+ * @param leaves Receives a pointer to the leaf slots, owned by the plan.
+ * @param table Receives the truth table; bit i is the output when leaf k carries bit k of i.
+ * @return Number of leaves, or -1 if the slot is not the root of a cone.
+ */
+int Server_GetLutCone( SimulatorState *simulatorState, int slot, const int **leaves, uint64_t *table );
+
+/**
+ * @brief Gets what the netlist reduction pass made of an element.
+ * Compiles the evaluation plan first if the topology changed.
+ * @param simulatorState Pointer to the SimulatorState struct.
+ * @param slot Element slot index, 0 <= slot < elementCount.
+ * @return The element's SlotReduction, or -1 on invalid arguments.
+ */
+int Server_GetSlotReduction( SimulatorState *simulatorState, int slot );
+
+/**
+ * @brief Gets the And-Inverter Graph the netlist was lowered to.
+ * Compiles the evaluation plan first if the topology changed. Each slot's output, sensor trigger
+ * and next-state literal are indexed by slot; mergedCount tells how much logic structural hashing
+ * found duplicated. The graph is owned by the plan and stays valid until the next topology change.
+ * @param simulatorState Pointer to the SimulatorState struct.
+ * @return The graph, or NULL on invalid arguments.
+ */
+const AndInverterGraph *Server_GetAndInverterGraph( SimulatorState *simulatorState );
+
+/**
+ * @brief Returns true if the slot holds an element on the canvas.
+ */
+bool Server_IsElementActive( const SimulatorState *simulatorState, int slot );
+
+/**
+ * @brief Returns the current output state of the element in a slot.
+ */
+bool Server_GetElementOutput( const SimulatorState *simulatorState, int slot );
+
+/**
+ * @brief Returns the period, in evaluation passes, of the oscillation the element in a slot
+ * takes part in.
+ * @return 0 if the element is stable, OSCILLATION_PERIOD_UNKNOWN if its feedback loop did not
+ * repeat within OSCILLATION_MAX_ITERATIONS passes, otherwise the period (2 or more).
+ */
+int Server_GetOscillationPeriod( const SimulatorState *simulatorState, int slot );
+
+/**
+ * @brief Recomputes the state hash from scratch.
+ *
+ * Every element placement, connection, output flip and card move updates
+ * simulatorState->stateHash in constant time; this full recompute must always agree with it.
+ * DEBUG builds compare the two after each propagation.
+ */
+uint64_t Server_ComputeStateHash( const SimulatorState *simulatorState );
+
+/**
+ * @brief Returns the logical canvas position of the element in a slot.
+ */
+Vector2 Server_GetElementPosition( const SimulatorState *simulatorState, int slot );
+
+/**
+ * @brief Returns true if propagation currently runs the native kernel instead of the interpreter.
+ *
+ * Canvases of NATIVE_ENGINE_MIN_ELEMENTS or more elements are emitted as a C function with one
+ * straight-line statement per gate, working on the outputs unpacked to bytes and packed back
+ * into outputBits on return. Once the topology has stayed unchanged for NATIVE_ENGINE_QUIET_MS,
+ * the source files are compiled at -Og by the system C compiler ($CC, default cc), up to
+ * NATIVE_KERNEL_MAX_JOBS child processes at a time, linked into a shared object and loaded with
+ * dlopen. Until it is ready, and whenever the build fails, the bytecode interpreter runs. A
+ * topology change kills the compilers of a build in flight, so a simulator state never runs more
+ * than one build. Not available on the web or on Windows.
+ */
+bool Server_IsNativeEngineActive( const SimulatorState *simulatorState );
+
+/**
+ * @brief Returns how many threads propagation uses for the current plan, 1 when it runs serially.
+ *
+ * Canvases of PARALLEL_MIN_ELEMENTS or more whose plan has a level at least
+ * PARALLEL_MIN_LEVEL_WIDTH components wide are swept level by level on a pool of one thread per
+ * core, capped at PARALLEL_MAX_THREADS. This takes precedence over the native kernel. Threads
+ * wait for each other between levels on a condition variable.
+ */
+int Server_GetPropagationThreadCount( const SimulatorState *simulatorState );
+
+/**
+ * @brief Overrides how many threads level-parallel propagation uses.
+ *
+ * 0 restores the default of one thread per core from PARALLEL_MIN_ELEMENTS on. 1 keeps
+ * propagation serial. 2 or more, capped at PARALLEL_MAX_THREADS, runs that many threads on
+ * every canvas with a level at least PARALLEL_MIN_LEVEL_WIDTH wide, whatever its size or the
+ * number of cores, so the parallel path can be checked against the serial one.
+ * @param simulatorState Pointer to the SimulatorState struct.
+ * @param threadCount Threads to use, or 0 for automatic.
+ */
+void Server_SetPropagationThreads( SimulatorState *simulatorState, int threadCount );
+
+/**
+ * @brief Collects the user-controllable origins (switches and buttons) in slot order.
+ * This order defines the origin index used by the lane-parallel and analysis APIs.
+ * @param simulatorState Pointer to the SimulatorState struct.
+ * @param originSlots Output array receiving element slot indices (may be NULL to only count).
+ * @param maxOrigins Capacity of originSlots.
+ * @return Total number of origins on the canvas (may exceed maxOrigins).
+ */
+int Server_CollectOriginSlots( const SimulatorState *simulatorState, int *originSlots, int maxOrigins );
+
+/**
+ * @brief Returns the lane block width, in 64-bit words, best suited to this CPU.
+ * 1 for the portable kernel, 4 when AVX2 is available, 8 when AVX-512 is available. Callers
+ * of Server_SimulateLanes get the most throughput with laneWords a multiple of this value.
+ */
+int Server_GetPreferredLaneWords( void );
+
+/**
+ * @brief Bit-parallel evaluation of the circuit against many origin assignments at once.
+ *
+ * Every element state is a row of laneWords 64-bit words; bit b of word w is the element's
+ * output for input vector w * 64 + b. One pass over the compiled evaluation plan evaluates all
+ * vectors with plain AND/OR/NOT word operations, using AVX2/AVX-512 wide variants when the CPU
+ * supports them. The live canvas state is not modified; feedback loops start from the current
+ * element outputs and elements without combinational behaviour hold their current output.
+ *
+ * @param simulatorState Pointer to the SimulatorState struct.
+ * @param originWords Origin lane rows, laneWords words per origin, in Server_CollectOriginSlots
+ * order.
+ * @param laneWords Number of 64-bit words per row.
+ * @param elementWords Output rows, laneWords words per element slot (elementCount rows).
+ * @return True on success, false on invalid arguments.
+ */
+bool Server_SimulateLanes(
+  SimulatorState *simulatorState, const uint64_t *originWords, int laneWords, uint64_t *elementWords
+);
+
+/**
+ * @brief Simulates a batch of origin assignments and packs the terminal outputs of each.
+ *
+ * The vectors are streamed in chunks of CAPABILITY_CHUNK_WORDS lane words (4096 vectors) that up
+ * to CAPABILITY_MAX_THREADS workers claim in turn, so working memory does not grow with
+ * vectorCount. Each chunk is transposed into lane words, 64 vectors by 64 origins at a time, and
+ * evaluated over the compiled And-Inverter Graph's cone of the terminals, or over their fan-in
+ * slice when a feedback loop is in that cone. As with Server_SimulateLanes the live canvas state
+ * is not modified.
+ *
+ * @param simulatorState Pointer to the SimulatorState struct.
+ * @param terminalIds IDs of the terminal elements, in pattern bit order, or NULL for every sensor
+ * in slot order.
+ * @param terminalCount Number of terminals, 1 to CAPABILITY_MAX_SENSORS; ignored when terminalIds
+ * is NULL.
+ * @param originBits One row of ELEMENT_BIT_WORDS(originCount) words per vector; bit o of a row is
+ * origin o in Server_CollectOriginSlots order. May be NULL without origins.
+ * @param vectorCount Number of vectors.
+ * @param patterns Receives one word per vector: bit t is set if terminal t is high (triggered, for
+ * a sensor).
+ * @return True on success, false on invalid arguments, a missing terminal, more than
+ * CAPABILITY_MAX_SENSORS sensors or when memory ran out.
+ */
+bool Server_SimulateVectors(
+  SimulatorState *simulatorState, const int *terminalIds, int terminalCount, const uint64_t *originBits,
+  size_t vectorCount, uint64_t *patterns
+);
+
+/**
+ * @brief Computes the capability and efficiency of the circuit on the canvas.
+ *
+ * Enumerates all 2^n assignments of the n switches/buttons with the lane-parallel kernel and
+ * collects the distinct patterns of triggered sensors (a sensor is triggered when any input is
+ * high) in a hash set. The input space is split into chunks of CAPABILITY_CHUNK_WORDS lane words
+ * that up to CAPABILITY_MAX_THREADS workers claim in turn. Circuits with more than
+ * CAPABILITY_MAX_ORIGINS origins or CAPABILITY_MAX_SENSORS sensors are handed to
+ * Server_AnalyzeCapabilitySymbolic instead. The result is cached in simulatorState->capability
+ * until the topology changes.
+ *
+ * @param simulatorState Pointer to the SimulatorState struct.
+ * @return Pointer to the up-to-date report, or NULL if simulatorState is NULL.
+ */
+const CapabilityReport *Server_AnalyzeCapability( SimulatorState *simulatorState );
+
+/**
+ * @brief Counts the capability of the circuit symbolically with reduced ordered BDDs.
+ *
+ * Works on the compiled And-Inverter Graph's cone of the sensor triggers (compiling the evaluation
+ * plan first if the topology changed), orders the BDD variables by a depth-first walk of each
+ * trigger's cone (origins first, then the sensor's output variable), and builds every node's
+ * function in graph order. The set of reachable sensor patterns is the image
+ * exists(origins) of AND(sensor_i == f_i); its model count is the capability, so no input vector
+ * is ever simulated. Fails when a feedback loop is in the cone or the diagram exceeds
+ * BDD_MAX_NODES nodes.
+ * Counts above INT_MAX saturate.
+ *
+ * @param simulatorState Pointer to the SimulatorState struct.
+ * @param report Receives the capability report; isExact is false on failure.
+ * @return True if the capability was counted, false otherwise.
+ */
+bool Server_AnalyzeCapabilitySymbolic( SimulatorState *simulatorState, CapabilityReport *report );
+
+/**
+ * @brief Decides whether some origin assignment produces the given sensor pattern.
+ *
+ * Tseitin-encodes the compiled And-Inverter Graph's cone of the sensor triggers into CNF, three
+ * clauses per AND node, compiling the evaluation plan first if the topology changed, and runs a
+ * built-in CDCL solver (two watched literals, first-UIP clause learning, activity-based decisions
+ * and restarts). Logic outside the cone is not encoded; its origins are reported low. Sensor i
+ * must be triggered exactly when bit i of sensorPattern is set; sensors past bit 63 must stay off.
+ * Feedback loops are encoded as fixed points, so a witness is a steady state of the loop.
+ *
+ * @param simulatorState Pointer to the SimulatorState struct.
+ * @param sensorPattern Required trigger pattern over the sensors in slot order.
+ * @param witness Receives the satisfying origin assignment, if any; its arrays grow as needed.
+ * @return True if the pattern is reachable, false if unreachable or SAT_MAX_CONFLICTS was hit.
+ */
+bool Server_SolveSpecificState( SimulatorState *simulatorState, uint64_t sensorPattern, StateWitness *witness );
+
+/**
+ * @brief Returns the fan-in slice of a set of terminal elements, building it on first use.
+ *
+ * Walks the compiled fan-in rows back from the terminals once and keeps every plan component
+ * reached, in plan order. The slice is cached under the ordered terminal list and reused until
+ * the topology changes; up to MAX_CONE_SLICES slices are kept, the least recently used being
+ * rebuilt first. The pointer stays valid until the next compile or Server_SliceCone call.
+ *
+ * @param simulatorState Pointer to the SimulatorState struct.
+ * @param terminalIds IDs of the terminal elements, in pattern bit order.
+ * @param terminalCount Number of terminals, 1 to CAPABILITY_MAX_SENSORS.
+ * @return The slice, or NULL if an ID does not exist or memory ran out.
+ */
+ConeSlice *Server_SliceCone( SimulatorState *simulatorState, const int *terminalIds, int terminalCount );
+
+/**
+ * @brief Bit-parallel evaluation of a slice against many assignments of its origins.
+ * Works as Server_SimulateLanes, over the slice members only.
+ * @param simulatorState Pointer to the SimulatorState struct.
+ * @param slice Slice returned by Server_SliceCone since the last topology change.
+ * @param originWords Origin lane rows, laneWords words per slice origin, in originRows order.
+ * @param laneWords Number of 64-bit words per row.
+ * @param memberWords Output rows, laneWords words per member (memberCount rows).
+ * @return True on success, false on invalid arguments or a stale slice.
+ */
+bool Server_SimulateSliceLanes(
+  SimulatorState *simulatorState, ConeSlice *slice, const uint64_t *originWords, int laneWords, uint64_t *memberWords
+);
+
+/**
+ * @brief Counts the distinct terminal patterns a slice can produce.
+ * Enumerates the slice's origins with the lane kernel as Server_AnalyzeCapability does, falling
+ * back to the BDD engine over the slice past CAPABILITY_MAX_ORIGINS origins. Efficiency divides
+ * by the origin points inside the slice. The report is cached on the slice.
+ * @param simulatorState Pointer to the SimulatorState struct.
+ * @param slice Slice returned by Server_SliceCone since the last topology change.
+ * @return The report, or NULL on invalid arguments or a stale slice.
+ */
+const CapabilityReport *Server_AnalyzeSliceCapability( SimulatorState *simulatorState, ConeSlice *slice );
+
+/**
+ * @brief Decides whether some origin assignment drives a slice's terminals into a pattern.
+ * Works as Server_SolveSpecificState with only the slice members encoded; origins outside the
+ * slice cannot affect the terminals and are left out of the witness.
+ * @param simulatorState Pointer to the SimulatorState struct.
+ * @param slice Slice returned by Server_SliceCone since the last topology change.
+ * @param terminalPattern Bit i set if terminal i must be high (triggered, for a sensor).
+ * @param witness Receives the assignment of the slice origins, if any.
+ * @return True if the pattern is reachable.
+ */
+bool Server_SolveSliceState(
+  SimulatorState *simulatorState, ConeSlice *slice, uint64_t terminalPattern, StateWitness *witness
+);
+
 /**
  * @brief Handles user interaction with an element on the canvas.
  * For example, toggling a switch.
@@ -240,6 +1036,14 @@ void Server_InteractWithElement( SimulatorState *simulatorState, int elementId )
 
 void Server_ReleaseElementInteraction( SimulatorState *simulatorState, int elementId );
 
+/**
+ * @brief Selects the signal propagation strategy used by Server_Update.
+ * Switching modes forces one full re-evaluation on the next update.
+ * @param simulatorState Pointer to the SimulatorState struct.
+ * @param mode The propagation mode to use.
+ */
+void Server_SetPropagationMode( SimulatorState *simulatorState, PropagationMode mode );
+
 /**
  * @brief Allows the user to attempt to draw a card from their deck.
  * If the deck is empty, it will attempt to reshuffle the discard pile.
@@ -260,6 +1064,33 @@ bool Server_CreateConnection(
   SimulatorState *simulatorState, int fromElementId, int toElementId, int toInputSlot
 );
 
+/**
+ * @brief Removes an element together with every connection into or out of it.
+ * Costs O(degree): only the element's own connection lists are walked. The slot is reused by a
+ * later placement.
+ * @param simulatorState Pointer to the SimulatorState.
+ * @param elementId ID of the element to remove.
+ * @return True if the element existed and was removed.
+ */
+bool Server_RemoveElement( SimulatorState *simulatorState, int elementId );
+
+/**
+ * @brief Removes the connection feeding an input of an element.
+ * @param simulatorState Pointer to the SimulatorState.
+ * @param toElementId ID of the target element.
+ * @param toInputSlot The input slot on the target element to disconnect.
+ * @return True if the input was connected and the connection was removed.
+ */
+bool Server_RemoveConnection( SimulatorState *simulatorState, int toElementId, int toInputSlot );
+
+/**
+ * @brief Moves the remaining elements and connections down over released slots.
+ * Element IDs are kept; slots change, so slot indices held across this call are invalid. Called
+ * by Server_Update once COMPACTION_MIN_FREE_SLOTS slots, and half of all slots, are free.
+ * @param simulatorState Pointer to the SimulatorState.
+ */
+void Server_CompactStorage( SimulatorState *simulatorState );
+
 /**
  * @brief Initializes a scenario with specific conditions.
  * @param scenario Pointer to the scenario to initialize
@@ -283,6 +1114,20 @@ bool Server_AddScenarioCondition(
   const char *description
 );
 
+/**
+ * @brief Restricts a unique-states or specific-state condition to a set of terminal elements.
+ * The condition is then checked on the fan-in slice of the terminals instead of every sensor,
+ * and re-evaluated by the next updates even if nothing else changed.
+ * @param simulatorState Pointer to the simulator state whose current scenario holds the condition
+ * @param conditionIndex Index of the condition in the current scenario
+ * @param terminalIds IDs of the terminal elements, in pattern bit order
+ * @param terminalCount Number of terminals, at most CONDITION_MAX_TERMINALS; 0 restores every sensor
+ * @return True if the terminals were set
+ */
+bool Server_SetConditionTerminals(
+  SimulatorState *simulatorState, int conditionIndex, const int *terminalIds, int terminalCount
+);
+
 /**
  * @brief Evaluates all conditions in the current scenario and updates completion status.
  * @param simulatorState Pointer to the simulator state
@@ -326,10 +1171,52 @@ Card Server_CreateActionCard( int id, const char *name, ActionCardType actionTyp
 
 /**
  * @brief Executes the effect of an action card.
+ *
+ * Blueprint saves the fan-in of the newest element that forms a module, trying up to
+ * BLUEPRINT_MAX_CANDIDATES elements, newest first. Schematic places the newest module definition
+ * two cells right of the rightmost element, on the newest element's row.
  * @param simulatorState Pointer to the simulator state
  * @param actionType The type of action to execute
  * @return True if the action was executed successfully, false otherwise
  */
 bool Server_ExecuteActionCard( SimulatorState *simulatorState, ActionCardType actionType );
 
+/**
+ * @brief Applies one client command to the simulator state.
+ * @param simulatorState Pointer to the simulator state
+ * @param command The command to apply
+ * @return True if the underlying server call succeeded
+ */
+bool Server_ExecuteCommand( SimulatorState *simulatorState, const ServerCommand *command );
+
+/**
+ * @brief Starts the simulation thread for simulatorState, which it owns until Server_StopThread.
+ * @param simulatorState Initialized simulator state
+ * @param tickRate Ticks per second; values below 1 use SERVER_DEFAULT_TICK_RATE
+ * @return The running thread, or NULL on failure
+ */
+ServerThread *Server_StartThread( SimulatorState *simulatorState, int tickRate );
+
+/**
+ * @brief Stops the thread and hands simulatorState back to the caller. Safe on NULL.
+ */
+void Server_StopThread( ServerThread *serverThread );
+
+/**
+ * @brief Enables or disables ticking; queued commands are applied either way.
+ */
+void Server_SetThreadRunning( ServerThread *serverThread, bool running );
+
+/**
+ * @brief Queues a command from the client thread without blocking.
+ * @return False if the queue is full and the command was dropped
+ */
+bool Server_SubmitCommand( ServerThread *serverThread, const ServerCommand *command );
+
+/**
+ * @brief Returns the most recently published snapshot of the simulator state.
+ * The snapshot stays valid and unchanged until the next call; it must only be read.
+ */
+const SimulatorState *Server_AcquireSnapshot( ServerThread *serverThread );
+
 #endif    // SERVER_H
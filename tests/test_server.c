@@ -0,0 +1,819 @@
+/**
+ * Server tests. Each test builds its circuit through the public server API and drives it with
+ * Server_Update the way the client does. Build and run from the repository root:
+ *
+ *   cc -std=c11 -Isrc -Ilib -Ilib/raylib-5.5_linux_amd64/include tests/test_server.c src/server.c \
+ *      -lm -ldl -lpthread -o test_server && ./test_server
+ *
+ * raylib is not linked; the server only needs TraceLog, which is stubbed below.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "server.h"
+
+static int checkCount;
+static int failureCount;
+
+#define CHECK( condition )                                                            \
+    do {                                                                              \
+        checkCount++;                                                                 \
+        if ( !( condition ) ) {                                                       \
+            failureCount++;                                                           \
+            fprintf( stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition ); \
+        }                                                                             \
+    } while ( 0 )
+
+void TraceLog( int logLevel, const char *text, ... ) {
+    (void) logLevel;
+    (void) text;
+}
+
+/** Updates until an update finds nothing to do, so every deferred analysis has run. */
+static void SettleUpdates( SimulatorState *simulatorState ) {
+    for ( int i = 0; i < 8; ++i ) {
+        uint64_t updated = simulatorState->updatedGeneration;
+        Server_Update( simulatorState, 0.0f );
+        if ( simulatorState->updatedGeneration == updated ) return;
+    }
+}
+
+/** Terminals changed while the simulator is idle still re-evaluate the specific-state condition. */
+static void TestConditionTerminalsWhileIdle( void ) {
+    static SimulatorState simulatorState;
+    Server_Init( &simulatorState );
+
+    // Sensors, in slot order: first follows a, second its inverse, third follows b.
+    int a        = Server_PlaceElement( &simulatorState, ELEMENT_SWITCH, (Vector2) { 0, 0 } );
+    int b        = Server_PlaceElement( &simulatorState, ELEMENT_SWITCH, (Vector2) { 0, 40 } );
+    int inverter = Server_PlaceElement( &simulatorState, ELEMENT_NOT, (Vector2) { 40, 0 } );
+    int first    = Server_PlaceElement( &simulatorState, ELEMENT_SENSOR, (Vector2) { 80, 0 } );
+    int second   = Server_PlaceElement( &simulatorState, ELEMENT_SENSOR, (Vector2) { 80, 20 } );
+    int third    = Server_PlaceElement( &simulatorState, ELEMENT_SENSOR, (Vector2) { 80, 40 } );
+    CHECK( Server_CreateConnection( &simulatorState, a, first, 0 ) );
+    CHECK( Server_CreateConnection( &simulatorState, a, inverter, 0 ) );
+    CHECK( Server_CreateConnection( &simulatorState, inverter, second, 0 ) );
+    CHECK( Server_CreateConnection( &simulatorState, b, third, 0 ) );
+
+    // Pattern 0b11: over every sensor a and its inverse, which no input reaches. The second
+    // condition is never met, so the scenario does not complete and advance under the test.
+    Scenario *scenario = &simulatorState.currentScenario;
+    Server_InitScenario( scenario, "Terminals", "Specific state over chosen terminals" );
+    Server_AddScenarioCondition( scenario, CONDITION_SPECIFIC_STATE, ELEMENT_NONE, 3, "Reach 0b11" );
+    Server_AddScenarioCondition( scenario, CONDITION_MIN_ELEMENTS, ELEMENT_AND, 1000, "Unreachable" );
+    SettleUpdates( &simulatorState );
+    CHECK( !scenario->conditions[0].isMet );
+    CHECK( simulatorState.stateWitness.isValid && !simulatorState.stateWitness.isSatisfiable );
+
+    // Over the first and third sensors the same pattern needs a and b both on.
+    int terminals[] = { first, third };
+    CHECK( Server_SetConditionTerminals( &simulatorState, 0, terminals, 2 ) );
+    SettleUpdates( &simulatorState );
+    CHECK( scenario->conditions[0].isMet );
+    CHECK( simulatorState.stateWitness.terminalKey != 0 );
+    CHECK( simulatorState.stateWitness.isSatisfiable );
+    CHECK( simulatorState.stateWitness.originCount == 2 );
+    for ( int i = 0; i < simulatorState.stateWitness.originCount; ++i ) {
+        CHECK( simulatorState.stateWitness.originValues[i] );
+    }
+
+    // Restoring every sensor makes the pattern unreachable again.
+    CHECK( Server_SetConditionTerminals( &simulatorState, 0, NULL, 0 ) );
+    SettleUpdates( &simulatorState );
+    CHECK( !scenario->conditions[0].isMet );
+    CHECK( simulatorState.stateWitness.terminalKey == 0 && !simulatorState.stateWitness.isSatisfiable );
+
+    CHECK( !Server_SetConditionTerminals( &simulatorState, 2, terminals, 2 ) );
+    Server_Shutdown( &simulatorState );
+}
+
+/** Small xorshift generator, so both canvases of a comparison are wired identically. */
+static int NextRandom( uint64_t *state, int bound ) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return (int) ( *state % (uint64_t) bound );
+}
+
+/**
+ * Places layers of random gates wider than PARALLEL_MIN_LEVEL_WIDTH, each fed by the layer
+ * before, with cross-coupled NOR latches along the way so the sweep also settles feedback loops.
+ * Writes the switch IDs to switches.
+ */
+static void BuildWideCanvas( SimulatorState *simulatorState, int *switches, int switchCount, int layerCount ) {
+    static int  previous[PARALLEL_MIN_LEVEL_WIDTH + 64];
+    static int  current[PARALLEL_MIN_LEVEL_WIDTH + 64];
+    const int   width   = PARALLEL_MIN_LEVEL_WIDTH + 64;
+    uint64_t    random  = 0x9E3779B97F4A7C15ull;
+    ElementType kinds[] = { ELEMENT_AND, ELEMENT_OR, ELEMENT_NOT };
+
+    for ( int i = 0; i < switchCount; ++i ) {
+        switches[i] = Server_PlaceElement( simulatorState, ELEMENT_SWITCH, (Vector2) { 0, (float) i } );
+    }
+    for ( int i = 0; i < width; ++i ) { previous[i] = switches[i % switchCount]; }
+
+    for ( int layer = 0; layer < layerCount; ++layer ) {
+        for ( int i = 0; i < width; ++i ) {
+            ElementType kind = kinds[NextRandom( &random, 3 )];
+            current[i]       = Server_PlaceElement( simulatorState, kind, (Vector2) { (float) layer, (float) i } );
+            for ( int input = 0; input < ( kind == ELEMENT_NOT ? 1 : 2 ); ++input ) {
+                Server_CreateConnection( simulatorState, previous[NextRandom( &random, width )], current[i], input );
+            }
+        }
+        // Every 64th gate of the layer drives a NOR latch whose output replaces it downstream.
+        for ( int i = 0; i < width; i += 64 ) {
+            int setGate   = Server_PlaceElement( simulatorState, ELEMENT_OR, (Vector2) { 0, 0 } );
+            int resetGate = Server_PlaceElement( simulatorState, ELEMENT_OR, (Vector2) { 0, 0 } );
+            int q         = Server_PlaceElement( simulatorState, ELEMENT_NOT, (Vector2) { 0, 0 } );
+            int qBar      = Server_PlaceElement( simulatorState, ELEMENT_NOT, (Vector2) { 0, 0 } );
+            Server_CreateConnection( simulatorState, current[i], setGate, 0 );
+            Server_CreateConnection( simulatorState, qBar, setGate, 1 );
+            Server_CreateConnection( simulatorState, current[( i + 1 ) % width], resetGate, 0 );
+            Server_CreateConnection( simulatorState, q, resetGate, 1 );
+            Server_CreateConnection( simulatorState, setGate, qBar, 0 );
+            Server_CreateConnection( simulatorState, resetGate, q, 0 );
+            current[i] = q;
+        }
+        memcpy( previous, current, sizeof( previous ) );
+    }
+    for ( int i = 0; i < width; ++i ) {
+        int sensor = Server_PlaceElement( simulatorState, ELEMENT_SENSOR, (Vector2) { (float) layerCount, (float) i } );
+        Server_CreateConnection( simulatorState, previous[i], sensor, 0 );
+    }
+}
+
+/**
+ * A forced pool sweeps the same outputs and state hash as the serial interpreter. Both run full
+ * sweeps: a latch released from set and reset at once oscillates, and where it stops depends on
+ * the order components are visited, which event-driven propagation changes.
+ */
+static void TestParallelPropagationMatchesSerial( void ) {
+    static SimulatorState serial;
+    static SimulatorState parallel;
+    int                   serialSwitches[64];
+    int                   parallelSwitches[64];
+
+    Server_Init( &serial );
+    Server_Init( &parallel );
+    BuildWideCanvas( &serial, serialSwitches, 64, 6 );
+    BuildWideCanvas( &parallel, parallelSwitches, 64, 6 );
+    Server_SetPropagationThreads( &serial, 1 );
+    Server_SetPropagationThreads( &parallel, 4 );
+    Server_SetPropagationMode( &serial, PROPAGATION_FULL_SWEEP );
+    Server_SetPropagationMode( &parallel, PROPAGATION_FULL_SWEEP );
+
+    uint64_t random = 12345;
+    for ( int step = 0; step < 24; ++step ) {
+        Server_Update( &serial, 0.0f );
+        Server_Update( &parallel, 0.0f );
+        CHECK( Server_GetPropagationThreadCount( &serial ) == 1 );
+        CHECK( Server_GetPropagationThreadCount( &parallel ) == 4 );
+        CHECK( serial.elementCount == parallel.elementCount );
+
+        int mismatches = 0;
+        for ( int slot = 0; slot < serial.elementCount; ++slot ) {
+            mismatches += Server_GetElementOutput( &serial, slot ) != Server_GetElementOutput( &parallel, slot );
+        }
+        CHECK( mismatches == 0 );
+        CHECK( parallel.stateHash == serial.stateHash );
+        CHECK( parallel.stateHash == Server_ComputeStateHash( &parallel ) );
+
+        // Flip a few inputs, the same ones on both canvases.
+        for ( int flip = 0; flip < 1 + step % 4; ++flip ) {
+            int which = NextRandom( &random, 64 );
+            Server_InteractWithElement( &serial, serialSwitches[which] );
+            Server_InteractWithElement( &parallel, parallelSwitches[which] );
+        }
+    }
+
+    // Back to automatic: this canvas is below PARALLEL_MIN_ELEMENTS, so the pool is not used.
+    Server_SetPropagationThreads( &parallel, 0 );
+    Server_Update( &parallel, 0.0f );
+    CHECK( Server_GetPropagationThreadCount( &parallel ) == 1 );
+
+    Server_Shutdown( &serial );
+    Server_Shutdown( &parallel );
+}
+
+/** Blueprint saves the newest element's fan-in as a module; Schematic places it, working alike. */
+static void TestBlueprintAndSchematicCards( void ) {
+    static SimulatorState simulatorState;
+    Server_Init( &simulatorState );
+
+    CHECK( !Server_ExecuteActionCard( &simulatorState, ACTION_SCHEMATIC ) );
+    int a = Server_PlaceElement( &simulatorState, ELEMENT_SWITCH, (Vector2) { 0, 0 } );
+    int b = Server_PlaceElement( &simulatorState, ELEMENT_SWITCH, (Vector2) { 0, 2 } );
+    CHECK( !Server_ExecuteActionCard( &simulatorState, ACTION_BLUEPRINT ) );
+
+    int gate   = Server_PlaceElement( &simulatorState, ELEMENT_AND, (Vector2) { 2, 1 } );
+    int sensor = Server_PlaceElement( &simulatorState, ELEMENT_SENSOR, (Vector2) { 4, 1 } );
+    CHECK( Server_CreateConnection( &simulatorState, a, gate, 0 ) );
+    CHECK( Server_CreateConnection( &simulatorState, b, gate, 1 ) );
+    CHECK( Server_CreateConnection( &simulatorState, gate, sensor, 0 ) );
+    CHECK( Server_ExecuteActionCard( &simulatorState, ACTION_BLUEPRINT ) );
+    CHECK( simulatorState.moduleCount == 1 );
+    CHECK( simulatorState.modules[0].inputCount == 2 && simulatorState.modules[0].elementCount == 4 );
+
+    CHECK( Server_ExecuteActionCard( &simulatorState, ACTION_SCHEMATIC ) );
+    int instanceSlot = simulatorState.elementCount - 1;
+    int instance     = simulatorState.elements.ids[instanceSlot];
+    CHECK( simulatorState.elements.types[instanceSlot] == ELEMENT_MODULE );
+    CHECK( Server_GetElementPosition( &simulatorState, instanceSlot ).x == 6 );
+    CHECK( Server_CreateConnection( &simulatorState, a, instance, 0 ) );
+    CHECK( Server_CreateConnection( &simulatorState, b, instance, 1 ) );
+
+    // The instance follows the gate the sensor watches; a sensor has no output of its own.
+    int gateSlot = Server_FindElementSlot( &simulatorState, gate );
+    for ( int step = 0; step < 4; ++step ) {
+        SettleUpdates( &simulatorState );
+        CHECK( Server_GetElementOutput( &simulatorState, instanceSlot ) ==
+               Server_GetElementOutput( &simulatorState, gateSlot ) );
+        Server_InteractWithElement( &simulatorState, step % 2 == 0 ? a : b );
+    }
+    SettleUpdates( &simulatorState );
+    CHECK( !Server_GetElementOutput( &simulatorState, instanceSlot ) );
+
+    Server_Shutdown( &simulatorState );
+}
+
+/**
+ * A constant input that dominates a gate inside a feedback loop holds the loop: the OR and the
+ * NOT (NOR) below are held by a SOURCE, the AND by an inverted one. Loops are never folded, so
+ * the bytecode has to apply the constant itself.
+ */
+static void TestConstantInputsInFeedbackLoops( void ) {
+    static SimulatorState simulatorState;
+    Server_Init( &simulatorState );
+
+    int source  = Server_PlaceElement( &simulatorState, ELEMENT_SOURCE, (Vector2) { 0, 0 } );
+    int low     = Server_PlaceElement( &simulatorState, ELEMENT_NOT, (Vector2) { 2, 0 } );
+    int orGate  = Server_PlaceElement( &simulatorState, ELEMENT_OR, (Vector2) { 4, 0 } );
+    int orLoop  = Server_PlaceElement( &simulatorState, ELEMENT_NOT, (Vector2) { 6, 0 } );
+    int andGate = Server_PlaceElement( &simulatorState, ELEMENT_AND, (Vector2) { 4, 4 } );
+    int andLoop = Server_PlaceElement( &simulatorState, ELEMENT_NOT, (Vector2) { 6, 4 } );
+    int norGate = Server_PlaceElement( &simulatorState, ELEMENT_NOT, (Vector2) { 4, 8 } );
+    int norLoop = Server_PlaceElement( &simulatorState, ELEMENT_NOT, (Vector2) { 6, 8 } );
+    int gates[] = { orGate, andGate, norGate };
+    CHECK( Server_CreateConnection( &simulatorState, source, low, 0 ) );
+    CHECK( Server_CreateConnection( &simulatorState, source, orGate, 0 ) );
+    CHECK( Server_CreateConnection( &simulatorState, orLoop, orGate, 1 ) );
+    CHECK( Server_CreateConnection( &simulatorState, orGate, orLoop, 0 ) );
+    CHECK( Server_CreateConnection( &simulatorState, low, andGate, 0 ) );
+    CHECK( Server_CreateConnection( &simulatorState, andLoop, andGate, 1 ) );
+    CHECK( Server_CreateConnection( &simulatorState, andGate, andLoop, 0 ) );
+    CHECK( Server_CreateConnection( &simulatorState, source, norGate, 0 ) );
+    CHECK( Server_CreateConnection( &simulatorState, norLoop, norGate, 1 ) );
+    CHECK( Server_CreateConnection( &simulatorState, norGate, norLoop, 0 ) );
+    for ( int i = 0; i < 3; ++i ) {
+        int sensor = Server_PlaceElement( &simulatorState, ELEMENT_SENSOR, (Vector2) { 8, (float) ( 4 * i ) } );
+        CHECK( Server_CreateConnection( &simulatorState, gates[i], sensor, 0 ) );
+    }
+
+    bool expected[] = { true, false, false };
+    for ( int pass = 0; pass < 2; ++pass ) {
+        if ( pass == 1 ) Server_SetPropagationMode( &simulatorState, PROPAGATION_FULL_SWEEP );
+        SettleUpdates( &simulatorState );
+        for ( int i = 0; i < 3; ++i ) {
+            int slot = Server_FindElementSlot( &simulatorState, gates[i] );
+            CHECK( Server_GetSlotReduction( &simulatorState, slot ) == SLOT_SIMULATED );
+            CHECK( Server_GetElementOutput( &simulatorState, slot ) == expected[i] );
+            CHECK( Server_GetOscillationPeriod( &simulatorState, slot ) == 0 );
+        }
+        CHECK( Server_GetElementOutput( &simulatorState, Server_FindElementSlot( &simulatorState, orLoop ) ) == false );
+        CHECK( Server_GetElementOutput( &simulatorState, Server_FindElementSlot( &simulatorState, andLoop ) ) == true );
+        CHECK( Server_GetElementOutput( &simulatorState, Server_FindElementSlot( &simulatorState, norLoop ) ) == true );
+    }
+
+    Server_Shutdown( &simulatorState );
+}
+
+/**
+ * Output of a gate over the current outputs of its drivers, the element IDs of inputs[k] in ids;
+ * inputs[k] < 0 leaves pin k unconnected.
+ */
+static bool ReferenceGateOutput( const SimulatorState *simulatorState, ElementType type, const int *inputs, const int *ids ) {
+    int wired = 0;
+    int high  = 0;
+    for ( int k = 0; k < 3; ++k ) {
+        if ( inputs[k] < 0 ) continue;
+        wired++;
+        high += Server_GetElementOutput( simulatorState, Server_FindElementSlot( simulatorState, ids[inputs[k]] ) );
+    }
+    switch ( type ) {
+        case ELEMENT_SOURCE: return true;
+        case ELEMENT_AND: return wired >= 2 && high == wired;
+        case ELEMENT_OR: return high > 0;
+        case ELEMENT_NOT: return wired > 0 && high == 0;
+        default: return false;
+    }
+}
+
+/**
+ * Folded, bypassed and dead slots still settle to what the unreduced netlist computes: after
+ * every input vector each gate's output is its function over all of its original drivers. Loops
+ * are held by dominating constants or keep a non-dominating one among their inputs.
+ */
+static void TestNetlistReductionMatchesUnreduced( void ) {
+    static SimulatorState simulatorState;
+    static const struct {
+        ElementType type;
+        int         inputs[3];    ///< Table rows driving each pin, -1 when unconnected.
+        int         reduction;
+    } rows[] = {
+        { ELEMENT_SWITCH, { -1, -1, -1 }, SLOT_SIMULATED },     // 0: a
+        { ELEMENT_SWITCH, { -1, -1, -1 }, SLOT_SIMULATED },     // 1: b
+        { ELEMENT_SOURCE, { -1, -1, -1 }, SLOT_CONSTANT },      // 2: high
+        { ELEMENT_NOT, { 2, -1, -1 }, SLOT_CONSTANT },          // 3: low
+        { ELEMENT_AND, { 0, 2, -1 }, SLOT_SIMULATED },          // 4: a, high pin folded out
+        { ELEMENT_OR, { 1, 2, -1 }, SLOT_CONSTANT },            // 5: held high
+        { ELEMENT_AND, { 0, 3, -1 }, SLOT_CONSTANT },           // 6: held low
+        { ELEMENT_OR, { 4, -1, -1 }, SLOT_BYPASSED },           // 7: buffer
+        { ELEMENT_NOT, { 7, -1, -1 }, SLOT_SIMULATED },         // 8
+        { ELEMENT_OR, { 8, 1, 3 }, SLOT_SIMULATED },            // 9: low pin folded out
+        { ELEMENT_AND, { 0, 1, -1 }, SLOT_DEAD },               // 10: reaches no sensor
+        { ELEMENT_NOT, { 10, -1, -1 }, SLOT_DEAD },             // 11
+        { ELEMENT_OR, { 2, 13, -1 }, SLOT_SIMULATED },          // 12: loop held high
+        { ELEMENT_NOT, { 12, -1, -1 }, SLOT_SIMULATED },        // 13
+        { ELEMENT_AND, { 3, 15, 0 }, SLOT_SIMULATED },          // 14: loop held low
+        { ELEMENT_NOT, { 14, -1, -1 }, SLOT_SIMULATED },        // 15
+        { ELEMENT_OR, { 2, 17, -1 }, SLOT_DEAD },               // 16: held loop reaching no sensor
+        { ELEMENT_NOT, { 16, -1, -1 }, SLOT_DEAD },             // 17
+        { ELEMENT_OR, { 3, 0, 19 }, SLOT_SIMULATED },           // 18: loop with a low pin, holds b
+        { ELEMENT_AND, { 18, 1, -1 }, SLOT_SIMULATED },         // 19
+        { ELEMENT_NOT, { 2, 21, -1 }, SLOT_SIMULATED },         // 20: NOR loop held low
+        { ELEMENT_NOT, { 20, -1, -1 }, SLOT_SIMULATED },        // 21
+    };
+    static const int watched[] = { 5, 6, 9, 12, 14, 18, 20 };
+    enum { ROW_COUNT = sizeof( rows ) / sizeof( rows[0] ) };
+    int ids[ROW_COUNT];
+
+    Server_Init( &simulatorState );
+    for ( int i = 0; i < ROW_COUNT; ++i ) {
+        ids[i] = Server_PlaceElement( &simulatorState, rows[i].type, (Vector2) { (float) ( 2 * i ), 0 } );
+    }
+    for ( int i = 0; i < ROW_COUNT; ++i ) {
+        for ( int k = 0; k < 3; ++k ) {
+            if ( rows[i].inputs[k] >= 0 ) CHECK( Server_CreateConnection( &simulatorState, ids[rows[i].inputs[k]], ids[i], k ) );
+        }
+    }
+    for ( int i = 0; i < (int) ( sizeof( watched ) / sizeof( watched[0] ) ); ++i ) {
+        int sensor = Server_PlaceElement( &simulatorState, ELEMENT_SENSOR, (Vector2) { (float) ( 2 * i ), 4 } );
+        CHECK( Server_CreateConnection( &simulatorState, ids[watched[i]], sensor, 0 ) );
+    }
+
+    // a and b walk through every vector and back, so the b loop is both set and held.
+    static const int toggles[] = { -1, 0, 1, 0, 1, 0, 1 };
+    for ( int pass = 0; pass < 2; ++pass ) {
+        if ( pass == 1 ) Server_SetPropagationMode( &simulatorState, PROPAGATION_FULL_SWEEP );
+        for ( int step = 0; step < (int) ( sizeof( toggles ) / sizeof( toggles[0] ) ); ++step ) {
+            if ( toggles[step] >= 0 ) Server_InteractWithElement( &simulatorState, ids[toggles[step]] );
+            SettleUpdates( &simulatorState );
+
+            int mismatches = 0;
+            for ( int i = 0; i < ROW_COUNT; ++i ) {
+                int slot = Server_FindElementSlot( &simulatorState, ids[i] );
+                CHECK( Server_GetSlotReduction( &simulatorState, slot ) == rows[i].reduction );
+                if ( rows[i].type == ELEMENT_SWITCH ) continue;
+                mismatches += Server_GetElementOutput( &simulatorState, slot ) !=
+                              ReferenceGateOutput( &simulatorState, rows[i].type, rows[i].inputs, ids );
+            }
+            CHECK( mismatches == 0 );
+            CHECK( simulatorState.stateHash == Server_ComputeStateHash( &simulatorState ) );
+        }
+    }
+
+    Server_Shutdown( &simulatorState );
+}
+
+/** Value of an AIG literal given the value of every node before it. */
+static bool AigLiteralValue( const bool *nodeValues, int literal ) {
+    return nodeValues[literal >> 1] != ( literal & 1 );
+}
+
+/**
+ * The And-Inverter Graph computes every element output and sensor trigger of a netlist mixing
+ * AND, OR, NOR (a multi-input NOT) and a module instance, for every vector of its switches.
+ */
+static void TestAndInverterGraphMatchesElements( void ) {
+    static SimulatorState simulatorState;
+    static bool           nodeValues[256];
+    Server_Init( &simulatorState );
+
+    // The module is the XOR of x and y; its selection stays on the canvas and is evaluated too.
+    int x       = Server_PlaceElement( &simulatorState, ELEMENT_SWITCH, (Vector2) { 0, 20 } );
+    int y       = Server_PlaceElement( &simulatorState, ELEMENT_SWITCH, (Vector2) { 0, 22 } );
+    int both    = Server_PlaceElement( &simulatorState, ELEMENT_AND, (Vector2) { 2, 20 } );
+    int either  = Server_PlaceElement( &simulatorState, ELEMENT_OR, (Vector2) { 2, 22 } );
+    int notBoth = Server_PlaceElement( &simulatorState, ELEMENT_NOT, (Vector2) { 4, 20 } );
+    int exactly = Server_PlaceElement( &simulatorState, ELEMENT_AND, (Vector2) { 6, 21 } );
+    CHECK( Server_CreateConnection( &simulatorState, x, both, 0 ) );
+    CHECK( Server_CreateConnection( &simulatorState, y, both, 1 ) );
+    CHECK( Server_CreateConnection( &simulatorState, x, either, 0 ) );
+    CHECK( Server_CreateConnection( &simulatorState, y, either, 1 ) );
+    CHECK( Server_CreateConnection( &simulatorState, both, notBoth, 0 ) );
+    CHECK( Server_CreateConnection( &simulatorState, notBoth, exactly, 0 ) );
+    CHECK( Server_CreateConnection( &simulatorState, either, exactly, 1 ) );
+    int selection[] = { x, y, both, either, notBoth, exactly };
+    int module      = Server_DefineModule( &simulatorState, "Xor", selection, 6, exactly );
+    CHECK( module >= 0 );
+
+    int switches[3];
+    for ( int i = 0; i < 3; ++i ) {
+        switches[i] = Server_PlaceElement( &simulatorState, ELEMENT_SWITCH, (Vector2) { 0, (float) ( 2 * i ) } );
+    }
+    int andGate  = Server_PlaceElement( &simulatorState, ELEMENT_AND, (Vector2) { 2, 0 } );
+    int orGate   = Server_PlaceElement( &simulatorState, ELEMENT_OR, (Vector2) { 2, 4 } );
+    int norGate  = Server_PlaceElement( &simulatorState, ELEMENT_NOT, (Vector2) { 2, 8 } );
+    int instance = Server_PlaceModule( &simulatorState, module, (Vector2) { 4, 4 } );
+    int mixed    = Server_PlaceElement( &simulatorState, ELEMENT_OR, (Vector2) { 6, 4 } );
+    CHECK( Server_CreateConnection( &simulatorState, switches[0], andGate, 0 ) );
+    CHECK( Server_CreateConnection( &simulatorState, switches[1], andGate, 1 ) );
+    CHECK( Server_CreateConnection( &simulatorState, switches[2], andGate, 2 ) );
+    CHECK( Server_CreateConnection( &simulatorState, switches[0], orGate, 0 ) );
+    CHECK( Server_CreateConnection( &simulatorState, switches[2], orGate, 1 ) );
+    CHECK( Server_CreateConnection( &simulatorState, switches[1], norGate, 0 ) );
+    CHECK( Server_CreateConnection( &simulatorState, switches[2], norGate, 1 ) );
+    CHECK( Server_CreateConnection( &simulatorState, orGate, instance, 0 ) );
+    CHECK( Server_CreateConnection( &simulatorState, switches[1], instance, 1 ) );
+    CHECK( Server_CreateConnection( &simulatorState, andGate, mixed, 0 ) );
+    CHECK( Server_CreateConnection( &simulatorState, norGate, mixed, 1 ) );
+    int watched[] = { exactly, andGate, instance, mixed };
+    for ( int i = 0; i < 4; ++i ) {
+        int sensor = Server_PlaceElement( &simulatorState, ELEMENT_SENSOR, (Vector2) { 8, (float) ( 2 * i ) } );
+        CHECK( Server_CreateConnection( &simulatorState, watched[i], sensor, 0 ) );
+    }
+
+    // Gray-code walk over the five switches, so each step flips one of them.
+    int inputs[] = { x, y, switches[0], switches[1], switches[2] };
+    for ( int vector = 0; vector < 32; ++vector ) {
+        if ( vector > 0 ) {
+            Server_InteractWithElement( &simulatorState, inputs[__builtin_ctz( (unsigned) vector )] );
+        }
+        SettleUpdates( &simulatorState );
+
+        const AndInverterGraph *graph = Server_GetAndInverterGraph( &simulatorState );
+        CHECK( graph != NULL && graph->nodeCount <= 256 );
+        if ( graph == NULL || graph->nodeCount > 256 ) break;
+        CHECK( graph->stateCount == 0 && graph->andCount > 0 );
+        for ( int node = 0; node < graph->nodeCount; ++node ) {
+            if ( node == 0 ) nodeValues[node] = false;
+            else if ( graph->nodeSlots[node] >= 0 ) nodeValues[node] = Server_GetElementOutput( &simulatorState, graph->nodeSlots[node] );
+            else nodeValues[node] = AigLiteralValue( nodeValues, graph->fanins[node][0] ) &&
+                                    AigLiteralValue( nodeValues, graph->fanins[node][1] );
+        }
+
+        int mismatches = 0;
+        for ( int slot = 0; slot < simulatorState.elementCount; ++slot ) {
+            if ( simulatorState.elements.types[slot] == ELEMENT_SENSOR ) {
+                const int *sources = NULL;
+                CHECK( Server_GetFanin( &simulatorState, slot, &sources ) == 1 );
+                mismatches += AigLiteralValue( nodeValues, graph->triggerLiterals[slot] ) !=
+                              Server_GetElementOutput( &simulatorState, sources[0] );
+            } else {
+                mismatches += AigLiteralValue( nodeValues, graph->outputLiterals[slot] ) !=
+                              Server_GetElementOutput( &simulatorState, slot );
+            }
+        }
+        CHECK( mismatches == 0 );
+    }
+
+    Server_Shutdown( &simulatorState );
+}
+
+/** Pattern of the terminals on the live canvas: bit t is set if terminal t is high. */
+static uint64_t ScalarTerminalPattern( SimulatorState *simulatorState, const int *terminalIds, int terminalCount ) {
+    uint64_t pattern = 0;
+    for ( int t = 0; t < terminalCount; ++t ) {
+        int        slot    = Server_FindElementSlot( simulatorState, terminalIds[t] );
+        const int *sources = NULL;
+        if ( simulatorState->elements.types[slot] == ELEMENT_SENSOR ) {
+            if ( Server_GetFanin( simulatorState, slot, &sources ) == 1 ) slot = sources[0];
+            else continue;
+        }
+        if ( Server_GetElementOutput( simulatorState, slot ) ) pattern |= 1ull << t;
+    }
+    return pattern;
+}
+
+/**
+ * Each vector of a batch gets the terminal pattern the live canvas shows for the same inputs.
+ * There are more than 64 origins and the vector count is not a multiple of 64, so every block of
+ * the 64 by 64 transpose, partial ones included, carries distinct per-lane inputs. Both the graph
+ * path and, with a feedback loop in the cone, the slice path are covered.
+ */
+static void TestSimulateVectorsMatchesScalar( void ) {
+    enum { ORIGINS = 70, SENSORS = 24, VECTORS = 150, WORDS = ELEMENT_BIT_WORDS( ORIGINS ) };
+    static SimulatorState simulatorState;
+    static uint64_t       originBits[VECTORS][WORDS];
+    static uint64_t       patterns[VECTORS];
+    int                   switches[ORIGINS];
+    int                   sensors[SENSORS + 1];
+    uint64_t              random = 0xD1B54A32D192ED03ull;
+    ElementType           kinds[] = { ELEMENT_AND, ELEMENT_OR, ELEMENT_NOT };
+
+    Server_Init( &simulatorState );
+    for ( int i = 0; i < ORIGINS; ++i ) {
+        switches[i] = Server_PlaceElement( &simulatorState, ELEMENT_SWITCH, (Vector2) { 0, (float) i } );
+    }
+    for ( int i = 0; i < SENSORS; ++i ) {
+        ElementType kind = kinds[i % 3];
+        int         gate = Server_PlaceElement( &simulatorState, kind, (Vector2) { 2, (float) i } );
+        for ( int k = 0; k < 3; ++k ) {
+            // The first gates read the origins from bit 64 on, which sit in a row's second word.
+            int origin = i < 4 ? 64 + ( i + k ) % ( ORIGINS - 64 ) : NextRandom( &random, ORIGINS );
+            CHECK( Server_CreateConnection( &simulatorState, switches[origin], gate, k ) );
+        }
+        sensors[i] = Server_PlaceElement( &simulatorState, ELEMENT_SENSOR, (Vector2) { 4, (float) i } );
+        CHECK( Server_CreateConnection( &simulatorState, gate, sensors[i], 0 ) );
+    }
+
+    // A loop held high by a SOURCE, gated by an origin.
+    int source  = Server_PlaceElement( &simulatorState, ELEMENT_SOURCE, (Vector2) { 0, -2 } );
+    int loop    = Server_PlaceElement( &simulatorState, ELEMENT_OR, (Vector2) { 2, -2 } );
+    int inverse = Server_PlaceElement( &simulatorState, ELEMENT_NOT, (Vector2) { 2, -4 } );
+    int gated   = Server_PlaceElement( &simulatorState, ELEMENT_AND, (Vector2) { 4, -2 } );
+    CHECK( Server_CreateConnection( &simulatorState, source, loop, 0 ) );
+    CHECK( Server_CreateConnection( &simulatorState, inverse, loop, 1 ) );
+    CHECK( Server_CreateConnection( &simulatorState, loop, inverse, 0 ) );
+    CHECK( Server_CreateConnection( &simulatorState, loop, gated, 0 ) );
+    CHECK( Server_CreateConnection( &simulatorState, switches[ORIGINS - 1], gated, 1 ) );
+    sensors[SENSORS] = Server_PlaceElement( &simulatorState, ELEMENT_SENSOR, (Vector2) { 6, -2 } );
+    CHECK( Server_CreateConnection( &simulatorState, gated, sensors[SENSORS], 0 ) );
+    SettleUpdates( &simulatorState );
+
+    int originSlots[ORIGINS];
+    CHECK( Server_CollectOriginSlots( &simulatorState, originSlots, ORIGINS ) == ORIGINS );
+    for ( int v = 0; v < VECTORS; ++v ) {
+        for ( int w = 0; w < WORDS; ++w ) {
+            originBits[v][w] = 0;
+            for ( int b = 0; b < 64 && w * 64 + b < ORIGINS; ++b ) {
+                originBits[v][w] |= (uint64_t) NextRandom( &random, 2 ) << b;
+            }
+        }
+    }
+
+    // Sensors in slot order with NULL, which puts the loop in the cone; the gates alone without.
+    for ( int pass = 0; pass < 2; ++pass ) {
+        const int *terminals = pass == 0 ? NULL : sensors;
+        CHECK( Server_SimulateVectors( &simulatorState, terminals, SENSORS, &originBits[0][0], VECTORS, patterns ) );
+
+        int mismatches = 0;
+        for ( int v = 0; v < VECTORS; ++v ) {
+            for ( int o = 0; o < ORIGINS; ++o ) {
+                bool wanted = ( originBits[v][o / 64] >> ( o % 64 ) ) & 1;
+                if ( Server_GetElementOutput( &simulatorState, originSlots[o] ) != wanted ) {
+                    Server_InteractWithElement( &simulatorState, simulatorState.elements.ids[originSlots[o]] );
+                }
+            }
+            SettleUpdates( &simulatorState );
+            uint64_t expected = pass == 0 ? ScalarTerminalPattern( &simulatorState, sensors, SENSORS + 1 )
+                                          : ScalarTerminalPattern( &simulatorState, sensors, SENSORS );
+            mismatches += patterns[v] != expected;
+        }
+        CHECK( mismatches == 0 );
+    }
+
+    Server_Shutdown( &simulatorState );
+}
+
+/** Places a XOR of two elements built from AND, OR and NOT; returns the ID of its output gate. */
+static int PlaceXor( SimulatorState *simulatorState, int a, int b, float y ) {
+    int either  = Server_PlaceElement( simulatorState, ELEMENT_OR, (Vector2) { 2, y } );
+    int both    = Server_PlaceElement( simulatorState, ELEMENT_AND, (Vector2) { 2, y + 2 } );
+    int notBoth = Server_PlaceElement( simulatorState, ELEMENT_NOT, (Vector2) { 4, y + 2 } );
+    int output  = Server_PlaceElement( simulatorState, ELEMENT_AND, (Vector2) { 6, y } );
+    Server_CreateConnection( simulatorState, a, either, 0 );
+    Server_CreateConnection( simulatorState, b, either, 1 );
+    Server_CreateConnection( simulatorState, a, both, 0 );
+    Server_CreateConnection( simulatorState, b, both, 1 );
+    Server_CreateConnection( simulatorState, both, notBoth, 0 );
+    Server_CreateConnection( simulatorState, either, output, 0 );
+    Server_CreateConnection( simulatorState, notBoth, output, 1 );
+    return output;
+}
+
+/**
+ * Specific-state queries on a ring of five XORs, sensor i watching x[i] ^ x[i + 1]. Around the
+ * ring the sensors always hold an even number of differences, so a pattern is reachable exactly
+ * when its popcount is even. Every sensor high is odd and unreachable, yet no trigger value fixes
+ * an input on its own: unit propagation alone cannot refute it, and the solver only gets there by
+ * deciding, hitting conflicts and learning from them. Across all 32 patterns the SAT answers must
+ * agree with the BDD engine's count.
+ */
+static void TestSolveSpecificStateAgreesWithBdd( void ) {
+    enum { RING = 5 };
+    static SimulatorState simulatorState;
+    StateWitness          witness = { 0 };
+    int                   switches[RING];
+
+    Server_Init( &simulatorState );
+    for ( int i = 0; i < RING; ++i ) {
+        switches[i] = Server_PlaceElement( &simulatorState, ELEMENT_SWITCH, (Vector2) { 0, (float) ( 8 * i ) } );
+    }
+    for ( int i = 0; i < RING; ++i ) {
+        int difference = PlaceXor( &simulatorState, switches[i], switches[( i + 1 ) % RING], (float) ( 8 * i ) );
+        int sensor     = Server_PlaceElement( &simulatorState, ELEMENT_SENSOR, (Vector2) { 8, (float) ( 8 * i ) } );
+        CHECK( Server_CreateConnection( &simulatorState, difference, sensor, 0 ) );
+    }
+    SettleUpdates( &simulatorState );
+
+    CHECK( !Server_SolveSpecificState( &simulatorState, ( 1u << RING ) - 1, &witness ) );
+    CHECK( witness.isValid && !witness.isSatisfiable );
+
+    // A reachable pattern: its witness, applied to the canvas, must produce it.
+    uint64_t pattern = 0x5;
+    CHECK( Server_SolveSpecificState( &simulatorState, pattern, &witness ) );
+    CHECK( witness.isSatisfiable && witness.originCount == RING );
+    for ( int o = 0; o < witness.originCount; ++o ) {
+        int slot = Server_FindElementSlot( &simulatorState, witness.originIds[o] );
+        if ( Server_GetElementOutput( &simulatorState, slot ) != witness.originValues[o] ) {
+            Server_InteractWithElement( &simulatorState, witness.originIds[o] );
+        }
+    }
+    SettleUpdates( &simulatorState );
+    int sensorIds[RING];
+    for ( int slot = 0, t = 0; slot < simulatorState.elementCount; ++slot ) {
+        if ( simulatorState.elements.types[slot] == ELEMENT_SENSOR ) sensorIds[t++] = simulatorState.elements.ids[slot];
+    }
+    CHECK( ScalarTerminalPattern( &simulatorState, sensorIds, RING ) == pattern );
+
+    int reachable = 0;
+    for ( uint64_t p = 0; p < 1u << RING; ++p ) {
+        bool satisfiable = Server_SolveSpecificState( &simulatorState, p, &witness );
+        CHECK( satisfiable == ( __builtin_popcountll( p ) % 2 == 0 ) );
+        reachable += satisfiable;
+    }
+    CapabilityReport symbolic = { 0 };
+    CHECK( Server_AnalyzeCapabilitySymbolic( &simulatorState, &symbolic ) );
+    CHECK( symbolic.isExact && symbolic.uniqueStateCount == reachable );
+    CHECK( reachable == 1 << ( RING - 1 ) );
+
+    free( witness.originIds );
+    free( witness.originValues );
+    Server_Shutdown( &simulatorState );
+}
+
+/**
+ * The BDD engine counts the same capability as the brute-force origin sweep on random acyclic
+ * netlists below CAPABILITY_MAX_ORIGINS origins, sources and single-input buffers included.
+ */
+static void TestSymbolicCapabilityMatchesSweep( void ) {
+    enum { ORIGINS = 9, GATES = 48, SENSORS = 7 };
+    static SimulatorState simulatorState;
+    uint64_t              random  = 0x2545F4914F6CDD1Dull;
+    ElementType           kinds[] = { ELEMENT_AND, ELEMENT_OR, ELEMENT_NOT, ELEMENT_OR };
+
+    for ( int round = 0; round < 6; ++round ) {
+        int ids[ORIGINS + 1 + GATES];
+        int count = 0;
+
+        Server_Init( &simulatorState );
+        for ( int i = 0; i < ORIGINS; ++i ) {
+            ids[count++] = Server_PlaceElement( &simulatorState, ELEMENT_SWITCH, (Vector2) { 0, (float) i } );
+        }
+        ids[count++] = Server_PlaceElement( &simulatorState, ELEMENT_SOURCE, (Vector2) { 0, -2 } );
+        for ( int i = 0; i < GATES; ++i ) {
+            ElementType kind   = kinds[NextRandom( &random, 4 )];
+            int         inputs = kind == ELEMENT_NOT || NextRandom( &random, 8 ) == 0 ? 1 : 2;
+            int         gate   = Server_PlaceElement( &simulatorState, kind, (Vector2) { 2, (float) i } );
+            for ( int k = 0; k < inputs; ++k ) {
+                // Half the time a recent element, so the logic nests instead of staying one level deep.
+                int driver = NextRandom( &random, 2 ) ? count - 1 - NextRandom( &random, count < 8 ? count : 8 )
+                                                      : NextRandom( &random, count );
+                Server_CreateConnection( &simulatorState, ids[driver], gate, k );
+            }
+            ids[count++] = gate;
+        }
+        for ( int i = 0; i < SENSORS; ++i ) {
+            int sensor = Server_PlaceElement( &simulatorState, ELEMENT_SENSOR, (Vector2) { 4, (float) i } );
+            CHECK( Server_CreateConnection( &simulatorState, ids[count - 1 - NextRandom( &random, GATES )], sensor, 0 ) );
+        }
+        SettleUpdates( &simulatorState );
+
+        const CapabilityReport *sweep    = Server_AnalyzeCapability( &simulatorState );
+        CapabilityReport        symbolic = { 0 };
+        CHECK( sweep != NULL && sweep->isValid && sweep->isExact && !sweep->isSymbolic );
+        CHECK( sweep->originCount == ORIGINS && sweep->vectorCount == 1u << ORIGINS );
+        CHECK( Server_AnalyzeCapabilitySymbolic( &simulatorState, &symbolic ) );
+        CHECK( symbolic.isExact && symbolic.isSymbolic );
+        CHECK( symbolic.uniqueStateCount == sweep->uniqueStateCount );
+        CHECK( symbolic.sensorCount == sweep->sensorCount );
+        Server_Shutdown( &simulatorState );
+    }
+}
+
+/** Row of the element with an ID in a slice, or -1 if it is not a member. */
+static int FindSliceRow( const SimulatorState *simulatorState, const ConeSlice *slice, int elementId ) {
+    for ( int r = 0; r < slice->memberCount; ++r ) {
+        if ( slice->members[r] == Server_FindElementSlot( simulatorState, elementId ) ) return r;
+    }
+    return -1;
+}
+
+/**
+ * A sensor's slice holds exactly its fan-in, loop included, in plan order with every input
+ * rewritten as a member row. The returned pointer is the cache entry: it is handed out again on a
+ * hit, may be rebuilt for other terminals by a later Server_SliceCone call, and goes stale at the
+ * next compile.
+ */
+static void TestSliceConeMembersAndLifetime( void ) {
+    static SimulatorState simulatorState;
+    Server_Init( &simulatorState );
+
+    // The first sensor sees AND(a, b) | loop, the loop holding c until it is released; the
+    // second sees NOT d, outside the first sensor's cone.
+    int a        = Server_PlaceElement( &simulatorState, ELEMENT_SWITCH, (Vector2) { 0, 0 } );
+    int b        = Server_PlaceElement( &simulatorState, ELEMENT_SWITCH, (Vector2) { 0, 2 } );
+    int c        = Server_PlaceElement( &simulatorState, ELEMENT_SWITCH, (Vector2) { 0, 4 } );
+    int d        = Server_PlaceElement( &simulatorState, ELEMENT_SWITCH, (Vector2) { 0, 6 } );
+    int both     = Server_PlaceElement( &simulatorState, ELEMENT_AND, (Vector2) { 2, 0 } );
+    int hold     = Server_PlaceElement( &simulatorState, ELEMENT_OR, (Vector2) { 2, 4 } );
+    int feedback = Server_PlaceElement( &simulatorState, ELEMENT_AND, (Vector2) { 4, 4 } );
+    int merged   = Server_PlaceElement( &simulatorState, ELEMENT_OR, (Vector2) { 4, 0 } );
+    int inverse  = Server_PlaceElement( &simulatorState, ELEMENT_NOT, (Vector2) { 2, 6 } );
+    int first    = Server_PlaceElement( &simulatorState, ELEMENT_SENSOR, (Vector2) { 6, 0 } );
+    int second   = Server_PlaceElement( &simulatorState, ELEMENT_SENSOR, (Vector2) { 6, 6 } );
+    static const int wiring[][3] = {
+        { 0, 4, 0 }, { 1, 4, 1 }, { 2, 5, 0 }, { 6, 5, 1 }, { 5, 6, 0 }, { 0, 6, 1 },
+        { 4, 7, 0 }, { 5, 7, 1 }, { 3, 8, 0 }, { 7, 9, 0 }, { 8, 10, 0 },
+    };    // Driver, consumer, pin, as indices into ids.
+    int ids[] = { a, b, c, d, both, hold, feedback, merged, inverse, first, second };
+    for ( int i = 0; i < (int) ( sizeof( wiring ) / sizeof( wiring[0] ) ); ++i ) {
+        CHECK( Server_CreateConnection( &simulatorState, ids[wiring[i][0]], ids[wiring[i][1]], wiring[i][2] ) );
+    }
+    SettleUpdates( &simulatorState );
+
+    ConeSlice *slice = Server_SliceCone( &simulatorState, &first, 1 );
+    CHECK( slice != NULL );
+    if ( slice == NULL ) return;
+    CHECK( slice->memberCount == 8 && slice->terminalCount == 1 );
+    CHECK( FindSliceRow( &simulatorState, slice, d ) == -1 && FindSliceRow( &simulatorState, slice, inverse ) == -1 );
+    CHECK( FindSliceRow( &simulatorState, slice, second ) == -1 );
+    CHECK( slice->terminalRows[0] == FindSliceRow( &simulatorState, slice, first ) );
+
+    // Every wire into a member is its input row; acyclic members come after their drivers.
+    for ( int i = 0; i < (int) ( sizeof( wiring ) / sizeof( wiring[0] ) ); ++i ) {
+        int row = FindSliceRow( &simulatorState, slice, ids[wiring[i][1]] );
+        if ( row < 0 ) continue;
+        CHECK( slice->inputs[row][wiring[i][2]] == FindSliceRow( &simulatorState, slice, ids[wiring[i][0]] ) );
+    }
+    int cyclicGroups = 0;
+    for ( int g = 0; g < slice->groupCount; ++g ) {
+        cyclicGroups += slice->groupCyclic[g];
+        for ( int r = slice->groupStart[g]; r < slice->groupStart[g + 1]; ++r ) {
+            for ( int k = 0; k < MAX_INPUTS_PER_LOGIC_GATE; ++k ) {
+                CHECK( slice->groupCyclic[g] || slice->inputs[r][k] < slice->groupStart[g] );
+            }
+        }
+    }
+    CHECK( cyclicGroups == 1 );
+    CHECK( slice->groupStart[slice->groupCount] == slice->memberCount );
+
+    // The origins are a, b and c, in slot order.
+    CHECK( slice->originCount == 3 );
+    for ( int o = 0; o < slice->originCount && o < 3; ++o ) {
+        CHECK( slice->originRows[o] == FindSliceRow( &simulatorState, slice, ids[o] ) );
+        CHECK( slice->originOfRow[slice->originRows[o]] == o );
+    }
+
+    // A hit hands out the same entry. Slicing MAX_CONE_SLICES other terminal lists evicts it, so
+    // the old pointer now describes other terminals; slicing again rebuilds the same members.
+    unsigned int generation = slice->generation;
+    CHECK( Server_SliceCone( &simulatorState, &first, 1 ) == slice );
+    for ( int i = 0; i < MAX_CONE_SLICES; ++i ) {
+        int terminals[] = { ids[i], second };
+        CHECK( Server_SliceCone( &simulatorState, terminals, 1 + i % 2 ) != NULL );
+    }
+    CHECK( slice->terminalSlots[0] != Server_FindElementSlot( &simulatorState, first ) || slice->terminalCount != 1 );
+    slice = Server_SliceCone( &simulatorState, &first, 1 );
+    CHECK( slice != NULL && slice->memberCount == 8 && slice->generation == generation );
+
+    // A compile leaves every slice stale; queries refuse it until it is sliced again.
+    CHECK( Server_CreateConnection( &simulatorState, d, merged, 2 ) );
+    Server_Update( &simulatorState, 0.0f );
+    CHECK( slice->generation != simulatorState.evaluationPlan.generation );
+    CHECK( Server_AnalyzeSliceCapability( &simulatorState, slice ) == NULL );
+    slice = Server_SliceCone( &simulatorState, &first, 1 );
+    CHECK( slice != NULL && slice->memberCount == 9 && slice->generation == simulatorState.evaluationPlan.generation );
+    CHECK( Server_AnalyzeSliceCapability( &simulatorState, slice ) != NULL );
+
+    Server_Shutdown( &simulatorState );
+}
+
+int main( void ) {
+    TestConditionTerminalsWhileIdle();
+    TestParallelPropagationMatchesSerial();
+    TestBlueprintAndSchematicCards();
+    TestConstantInputsInFeedbackLoops();
+    TestNetlistReductionMatchesUnreduced();
+    TestAndInverterGraphMatchesElements();
+    TestSimulateVectorsMatchesScalar();
+    TestSolveSpecificStateAgreesWithBdd();
+    TestSymbolicCapabilityMatchesSweep();
+    TestSliceConeMembersAndLifetime();
+
+    printf( "%d checks, %d failed\n", checkCount, failureCount );
+    return failureCount == 0 ? 0 : 1;
+}